@@ -0,0 +1,367 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include "hw1.h"
+#include "block_matrix.h"
+#include "dense_matrix.h"
+#include "factorization_cache.h"
+#include "fixed_matrix.h"
+#include "format.h"
+#include "gemm.h"
+#include "matrix_batch.h"
+#include "matrix_file.h"
+#include "out_of_core.h"
+#include "solve.h"
+#include "strassen.h"
+#include "structure.h"
+
+// One benchmark per algebra function, on square matrices from 2x2 to 4096x4096.
+// Run a subset with --benchmark_filter, e.g. --benchmark_filter='BM_multiply/256'.
+
+namespace {
+    // Sizes 2, 4, 16, 64, 256, 1024 and 4096
+    void sizes(benchmark::internal::Benchmark* b) {
+        b->RangeMultiplier(4)->Range(2, 4096)->Unit(benchmark::kMicrosecond);
+    }
+
+    Matrix input(benchmark::State& state) {
+        size_t n = state.range(0);
+        return algebra::random(n, n, -1, 1);
+    }
+
+    void BM_zeros(benchmark::State& state) {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::zeros(state.range(0), state.range(0)));
+    }
+
+    void BM_ones(benchmark::State& state) {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::ones(state.range(0), state.range(0)));
+    }
+
+    void BM_random(benchmark::State& state) {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::random(state.range(0), state.range(0), -1, 1));
+    }
+
+    void BM_multiply_scalar(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::multiply(matrix, 1.5));
+    }
+
+    void BM_multiply(benchmark::State& state) {
+        Matrix matrix1 = input(state);
+        Matrix matrix2 = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::multiply(matrix1, matrix2));
+    }
+
+    void BM_sum_scalar(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::sum(matrix, 1.5));
+    }
+
+    void BM_sum(benchmark::State& state) {
+        Matrix matrix1 = input(state);
+        Matrix matrix2 = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::sum(matrix1, matrix2));
+    }
+
+    void BM_transpose(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::transpose(matrix));
+    }
+
+    void BM_minor(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::minor(matrix, 0, 0));
+    }
+
+    void BM_determinant(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::determinant(matrix));
+    }
+
+    void BM_inverse(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::inverse(matrix));
+    }
+
+    void BM_concatenate_rows(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::concatenate(matrix, matrix, 0));
+    }
+
+    void BM_concatenate_cols(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::concatenate(matrix, matrix, 1));
+    }
+
+    void BM_ero_swap(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::ero_swap(matrix, 0, 1));
+    }
+
+    void BM_ero_multiply(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::ero_multiply(matrix, 0, 1.5));
+    }
+
+    void BM_ero_sum(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::ero_sum(matrix, 0, 1.5, 1));
+    }
+
+    void BM_upper_triangular(benchmark::State& state) {
+        Matrix matrix = input(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::upper_triangular(matrix));
+    }
+
+    // A x = b for one right-hand side, to compare with BM_inverse
+    void BM_solve(benchmark::State& state) {
+        Matrix matrix = input(state);
+        Vector b(matrix.size(), 1.0);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::solve(matrix, b));
+    }
+
+    // Repeated determinants of one unchanged matrix, a hash and compare instead of a factorization
+    void BM_cached_determinant(benchmark::State& state) {
+        Matrix matrix = input(state);
+        algebra::FactorizationCache cache;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(cache.determinant(matrix));
+    }
+
+    // A covariance matrix, symmetric positive definite: probed and routed to Cholesky, against
+    // BM_determinant and BM_inverse on the dense LU. The probe is timed too.
+    Matrix covariance(benchmark::State& state) {
+        size_t n = state.range(0);
+        algebra::DenseMatrix samples(algebra::random(n, n, -1, 1));
+        algebra::DenseMatrix product = algebra::multiply(samples, algebra::transpose(samples));
+        for (size_t i = 0; i < n; ++i)
+            product(i, i) += n;
+        return product.to_matrix();
+    }
+
+    void BM_symmetric_determinant(benchmark::State& state) {
+        Matrix matrix = covariance(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::determinant(matrix, algebra::probe(matrix)));
+    }
+
+    void BM_symmetric_inverse(benchmark::State& state) {
+        Matrix matrix = covariance(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::inverse(matrix, algebra::probe(matrix)));
+    }
+
+    // The text of show, into a string so the terminal is not timed
+    void BM_print(benchmark::State& state) {
+        Matrix matrix = input(state);
+        std::string text;
+        for (auto _ : state) {
+            text.clear();
+            algebra::print(matrix, algebra::string_sink(text));
+            benchmark::DoNotOptimize(text.data());
+        }
+        state.SetBytesProcessed(state.iterations() * text.size());
+    }
+
+    // 4x4 matrices with the size in the type, for comparison with the dynamic versions at size 4
+    void BM_fixed_multiply(benchmark::State& state) {
+        auto matrix = algebra::to_fixed<4, 4>(algebra::random(4, 4, -1, 1));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(matrix);
+            benchmark::DoNotOptimize(algebra::multiply(matrix, matrix));
+        }
+    }
+
+    void BM_fixed_inverse(benchmark::State& state) {
+        auto matrix = algebra::to_fixed<4, 4>(algebra::random(4, 4, -1, 1));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(matrix);
+            benchmark::DoNotOptimize(algebra::inverse(matrix));
+        }
+    }
+
+    // Products of contiguous matrices in each precision, from 64x64 to 1024x1024
+    void precision_sizes(benchmark::internal::Benchmark* b) {
+        b->RangeMultiplier(4)->Range(64, 1024)->Unit(benchmark::kMicrosecond);
+    }
+
+    template <typename T>
+    algebra::BasicDenseMatrix<T> dense_input(benchmark::State& state) {
+        size_t n = state.range(0);
+        return algebra::dense::random<T>(n, n, -1, 1);
+    }
+
+    void BM_dense_multiply_double(benchmark::State& state) {
+        algebra::DenseMatrix matrix = dense_input<double>(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::multiply(matrix, matrix));
+    }
+
+    void BM_dense_multiply_float(benchmark::State& state) {
+        algebra::FloatDenseMatrix matrix = dense_input<float>(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::multiply(matrix, matrix));
+    }
+
+    void BM_dense_multiply_mixed(benchmark::State& state) {
+        algebra::FloatDenseMatrix matrix = dense_input<float>(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::multiply_mixed(matrix, matrix));
+    }
+
+    // Tiled transposes of contiguous matrices, into a new matrix and in place
+    void BM_dense_transpose(benchmark::State& state) {
+        algebra::DenseMatrix matrix = dense_input<double>(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::transpose(matrix));
+    }
+
+    void BM_transpose_inplace(benchmark::State& state) {
+        algebra::DenseMatrix matrix = dense_input<double>(state);
+        for (auto _ : state) {
+            algebra::transpose_inplace(matrix);
+            benchmark::DoNotOptimize(matrix.data());
+        }
+    }
+
+    // An n x n matrix assembled from 16 column strips, by repeated concatenation or lazily
+    // with one copy at the end
+    std::vector<Matrix> strips(benchmark::State& state) {
+        size_t n = state.range(0);
+        return std::vector<Matrix>(16, algebra::random(n, n / 16, -1, 1));
+    }
+
+    void BM_concatenate(benchmark::State& state) {
+        std::vector<Matrix> parts = strips(state);
+        for (auto _ : state) {
+            Matrix result = parts[0];
+            for (size_t p = 1; p < parts.size(); ++p)
+                result = algebra::concatenate(result, parts[p], 1);
+            benchmark::DoNotOptimize(result);
+        }
+    }
+
+    void BM_block_concatenate(benchmark::State& state) {
+        std::vector<Matrix> parts = strips(state);
+        for (auto _ : state) {
+            algebra::BlockMatrix result{parts[0]};
+            for (size_t p = 1; p < parts.size(); ++p)
+                result = algebra::concatenate(result, algebra::BlockMatrix{parts[p]}, 1);
+            benchmark::DoNotOptimize(result.to_dense());
+        }
+    }
+
+    // The blocked gemm alone against Strassen-Winograd with the default cutoff, 1024 to 4096
+    void strassen_sizes(benchmark::internal::Benchmark* b) {
+        b->RangeMultiplier(2)->Range(1024, 4096)->Unit(benchmark::kMillisecond);
+    }
+
+    void BM_gemm(benchmark::State& state) {
+        algebra::DenseMatrix matrix = dense_input<double>(state);
+        size_t n = matrix.rows();
+        for (auto _ : state) {
+            algebra::DenseMatrix result(n, n);
+            algebra::gemm(n, n, n, matrix.data(), matrix.stride(), matrix.data(), matrix.stride(),
+                          result.data(), result.stride());
+            benchmark::DoNotOptimize(result.data());
+        }
+    }
+
+    void BM_strassen(benchmark::State& state) {
+        algebra::DenseMatrix matrix = dense_input<double>(state);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::multiply_strassen(matrix, matrix));
+    }
+
+    // Product of two files through 8 MiB of tiles, to compare with BM_dense_multiply_double
+    void BM_multiply_files(benchmark::State& state) {
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+        std::string a = (dir / "algebra_bench_a.mat").string();
+        std::string c = (dir / "algebra_bench_c.mat").string();
+        algebra::save(dense_input<double>(state), a);
+        for (auto _ : state)
+            algebra::multiply_files(a, a, c, 8 << 20);
+        std::remove(a.c_str());
+        std::remove(c.c_str());
+    }
+
+    // A million 4x4 matrices in structure-of-arrays layout, the items are matrices
+    algebra::MatrixBatch batch(size_t count) {
+        algebra::MatrixBatch result(count, 4, 4);
+        for (size_t b = 0; b < count; ++b)
+            result.set(b, algebra::random(4, 4, -1, 1));
+        return result;
+    }
+
+    void BM_batch_multiply(benchmark::State& state) {
+        algebra::MatrixBatch matrix = batch(state.range(0));
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::batch_multiply(matrix, matrix));
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    void BM_batch_inverse(benchmark::State& state) {
+        algebra::MatrixBatch matrix = batch(state.range(0));
+        for (auto _ : state)
+            benchmark::DoNotOptimize(algebra::batch_inverse(matrix));
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+}
+
+BENCHMARK(BM_zeros)->Apply(sizes);
+BENCHMARK(BM_ones)->Apply(sizes);
+BENCHMARK(BM_random)->Apply(sizes);
+BENCHMARK(BM_multiply_scalar)->Apply(sizes);
+BENCHMARK(BM_multiply)->Apply(sizes);
+BENCHMARK(BM_sum_scalar)->Apply(sizes);
+BENCHMARK(BM_sum)->Apply(sizes);
+BENCHMARK(BM_transpose)->Apply(sizes);
+BENCHMARK(BM_minor)->Apply(sizes);
+BENCHMARK(BM_determinant)->Apply(sizes);
+BENCHMARK(BM_inverse)->Apply(sizes);
+BENCHMARK(BM_concatenate_rows)->Apply(sizes);
+BENCHMARK(BM_concatenate_cols)->Apply(sizes);
+BENCHMARK(BM_ero_swap)->Apply(sizes);
+BENCHMARK(BM_ero_multiply)->Apply(sizes);
+BENCHMARK(BM_ero_sum)->Apply(sizes);
+BENCHMARK(BM_upper_triangular)->Apply(sizes);
+BENCHMARK(BM_print)->Apply(sizes);
+BENCHMARK(BM_solve)->Apply(sizes);
+BENCHMARK(BM_cached_determinant)->Apply(sizes);
+BENCHMARK(BM_symmetric_determinant)->Apply(sizes);
+BENCHMARK(BM_symmetric_inverse)->Apply(sizes);
+BENCHMARK(BM_dense_multiply_double)->Apply(precision_sizes);
+BENCHMARK(BM_dense_multiply_float)->Apply(precision_sizes);
+BENCHMARK(BM_dense_multiply_mixed)->Apply(precision_sizes);
+BENCHMARK(BM_multiply_files)->Apply(precision_sizes);
+BENCHMARK(BM_dense_transpose)->Apply(precision_sizes);
+BENCHMARK(BM_transpose_inplace)->Apply(precision_sizes);
+BENCHMARK(BM_concatenate)->Apply(precision_sizes);
+BENCHMARK(BM_block_concatenate)->Apply(precision_sizes);
+BENCHMARK(BM_gemm)->Apply(strassen_sizes);
+BENCHMARK(BM_strassen)->Apply(strassen_sizes);
+BENCHMARK(BM_fixed_multiply);
+BENCHMARK(BM_fixed_inverse);
+BENCHMARK(BM_batch_multiply)->Arg(1 << 12)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_batch_inverse)->Arg(1 << 12)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
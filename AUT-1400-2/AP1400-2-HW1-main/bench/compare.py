@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Compare two Google Benchmark JSON files and fail on regressions.
+
+    ./bench --benchmark_out=current.json --benchmark_out_format=json
+    python3 bench/compare.py baseline.json current.json --threshold 10
+
+Exits with 1 when any benchmark of the baseline got slower by more than
+threshold percent, and when a benchmark of the baseline is missing from the
+current run (renamed, deleted or filtered out) unless --allow-missing is given.
+When the runs were repeated (--benchmark_repetitions), the medians are compared.
+"""
+
+import argparse
+import json
+import sys
+
+# Time units of the JSON output, in nanoseconds
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path, metric):
+    with open(path) as f:
+        report = json.load(f)
+    times = {}
+    medians = {}
+    for entry in report["benchmarks"]:
+        if entry.get("error_occurred"):
+            continue
+        name = entry.get("run_name", entry["name"])
+        value = entry[metric] * UNITS[entry.get("time_unit", "ns")]
+        if entry.get("run_type") == "aggregate":
+            if entry.get("aggregate_name") == "median":
+                medians[name] = value
+        else:
+            # Without a median, the fastest repetition is the least noisy
+            times[name] = min(value, times.get(name, value))
+    times.update(medians)
+    return times
+
+
+def format_time(ns):
+    for unit in ("s", "ms", "us"):
+        if ns >= UNITS[unit]:
+            return "%.3f %s" % (ns / UNITS[unit], unit)
+    return "%.1f ns" % ns
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed slowdown in percent (default 10)")
+    parser.add_argument("--metric", choices=("real_time", "cpu_time"), default="real_time")
+    parser.add_argument("--allow-missing", action="store_true",
+                        help="only report baseline benchmarks missing from the current run")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    current = load(args.current, args.metric)
+
+    regressions = []
+    missing = []
+    width = max((len(name) for name in baseline), default=0)
+    for name, before in baseline.items():
+        if name not in current:
+            missing.append(name)
+            print("%-*s  missing from %s" % (width, name, args.current))
+            continue
+        after = current[name]
+        change = (after - before) / before * 100 if before > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        print("%-*s  %12s -> %12s  %+7.1f%%%s" % (width, name, format_time(before), format_time(after), change, flag))
+
+    failed = False
+    if regressions:
+        print("\n%d benchmark(s) regressed by more than %.1f%%" % (len(regressions), args.threshold))
+        failed = True
+    if missing and not args.allow_missing:
+        print("\n%d benchmark(s) of the baseline missing from the current run" % len(missing))
+        failed = True
+    if failed:
+        return 1
+    print("\nno regression above %.1f%%" % args.threshold)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
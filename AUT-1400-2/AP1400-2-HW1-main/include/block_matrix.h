@@ -0,0 +1,70 @@
+#ifndef AP_BLOCK_MATRIX_H
+#define AP_BLOCK_MATRIX_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "hw1.h"
+#include "dense_matrix.h"
+#include "matrix_view.h"
+
+namespace algebra {
+    // Matrix assembled from parts by concatenation without copying them: a tree whose leaves
+    // are views into the parts and whose inner nodes put two blocks one on top of the other
+    // (axis 0) or side by side (axis 1). Concatenating is O(1) whatever the sizes; to_dense
+    // copies every element exactly once into a single allocation, to_matrix into rows allocated
+    // once at their final size.
+    // Like a view, the block matrix must not outlive its parts, which must keep their size.
+    class BlockMatrix {
+    public:
+        // A leaf and where it sits: rows [row, row + view.rows()) and columns
+        // [col, col + view.cols()) of the whole matrix
+        struct Block {
+            size_t row;
+            size_t col;
+            ConstMatrixView view;
+        };
+
+        BlockMatrix() = default;
+        explicit BlockMatrix(ConstMatrixView matrix);
+        explicit BlockMatrix(const Matrix& matrix) : BlockMatrix(view(matrix)) {}
+        explicit BlockMatrix(const DenseMatrix& matrix) : BlockMatrix(view(matrix)) {}
+
+        size_t rows() const;
+        size_t cols() const;
+        bool empty() const { return rows() == 0 || cols() == 0; }
+
+        // Walks down the tree, use blocks() to read many elements
+        double operator()(size_t i, size_t j) const;
+
+        // The non-empty leaves, top to bottom and left to right within every concatenation
+        std::vector<Block> blocks() const;
+
+        Matrix to_matrix() const;
+        DenseMatrix to_dense() const;
+
+    private:
+        struct Node;
+
+        explicit BlockMatrix(std::shared_ptr<const Node> root) : root_(std::move(root)) {}
+
+        friend BlockMatrix concatenate(const BlockMatrix& matrix1, const BlockMatrix& matrix2, size_t axis);
+
+        // Shared by every block matrix built on it, so a part can be used in several of them
+        std::shared_ptr<const Node> root_;
+    };
+
+    // Lazy concatenation, same checks as the Matrix version: throws std::logic_error when the
+    // sizes along the other axis differ, and gives an empty matrix for an axis other than 0 or 1
+    BlockMatrix concatenate(const BlockMatrix& matrix1, const BlockMatrix& matrix2, size_t axis);
+
+    // Kernels that consume a block matrix block by block. The product runs one gemm per pair of
+    // overlapping blocks straight from the parts, copying only the parts that are not contiguous
+    // (nested-vector or strided ones); the transpose writes every block to its place.
+    // Throws std::logic_error for a product of matrices with wrong dimensions.
+    DenseMatrix multiply(const BlockMatrix& matrix1, const BlockMatrix& matrix2);
+    DenseMatrix transpose(const BlockMatrix& matrix);
+}
+
+#endif //AP_BLOCK_MATRIX_H
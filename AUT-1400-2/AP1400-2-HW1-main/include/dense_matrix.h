@@ -0,0 +1,173 @@
+#ifndef AP_DENSE_MATRIX_H
+#define AP_DENSE_MATRIX_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "hw1.h"
+
+namespace algebra {
+    // Allocator that hands out storage aligned to Alignment bytes, so every row of a
+    // DenseMatrix can be loaded with aligned SIMD instructions
+    template <typename T, size_t Alignment = 64>
+    struct AlignedAllocator {
+        using value_type = T;
+
+        template <typename U>
+        struct rebind {
+            using other = AlignedAllocator<U, Alignment>;
+        };
+
+        AlignedAllocator() noexcept = default;
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+        T* allocate(size_t n) {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        void deallocate(T* p, size_t) noexcept {
+            ::operator delete(p, std::align_val_t(Alignment));
+        }
+
+        template <typename U>
+        bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+        template <typename U>
+        bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+    };
+
+    // Row-major matrix of T stored in a single aligned buffer.
+    // Every row starts on a 64 byte boundary: stride() is cols() rounded up to a
+    // whole cache line and the padding elements are kept at zero.
+    // T is float or double, the library is compiled for both (DenseMatrix and FloatDenseMatrix).
+    template <typename T>
+    class BasicDenseMatrix {
+    public:
+        using value_type = T;
+
+        // Alignment of the buffer and of every row, in bytes
+        static constexpr size_t alignment = 64;
+
+        BasicDenseMatrix() = default;
+        BasicDenseMatrix(size_t rows, size_t cols, T value = 0);
+        // Copy a nested-vector matrix into contiguous storage, rows must all have the same size
+        explicit BasicDenseMatrix(const BasicMatrix<T>& matrix);
+
+        // Copy back into the nested-vector layout used by the rest of the library
+        BasicMatrix<T> to_matrix() const;
+
+        size_t rows() const { return rows_; }
+        size_t cols() const { return cols_; }
+        // Distance in elements between the starts of two consecutive rows
+        size_t stride() const { return stride_; }
+        bool empty() const { return rows_ == 0 || cols_ == 0; }
+
+        T* data() { return data_.data(); }
+        const T* data() const { return data_.data(); }
+        T* row(size_t i) { return data_.data() + i * stride_; }
+        const T* row(size_t i) const { return data_.data() + i * stride_; }
+
+        T& operator()(size_t i, size_t j) { return data_[i * stride_ + j]; }
+        T operator()(size_t i, size_t j) const { return data_[i * stride_ + j]; }
+
+        // Swap two whole rows without touching any other row
+        void swap_rows(size_t r1, size_t r2);
+
+    private:
+        size_t rows_{};
+        size_t cols_{};
+        size_t stride_{};
+        std::vector<T, AlignedAllocator<T>> data_;
+    };
+
+    using DenseMatrix = BasicDenseMatrix<double>;
+    using FloatDenseMatrix = BasicDenseMatrix<float>;
+
+    // The members and the functions below are compiled once in dense_matrix.cpp
+    extern template class BasicDenseMatrix<double>;
+    extern template class BasicDenseMatrix<float>;
+
+    // Copy with every element converted to U
+    template <typename U, typename T>
+    BasicDenseMatrix<U> matrix_cast(const BasicDenseMatrix<T>& matrix) {
+        if constexpr (std::is_same<U, T>::value)
+            return matrix;
+        BasicDenseMatrix<U> result(matrix.rows(), matrix.cols());
+        for (size_t i = 0; i < matrix.rows(); ++i)
+            for (size_t j = 0; j < matrix.cols(); ++j)
+                result(i, j) = static_cast<U>(matrix(i, j));
+        return result;
+    }
+
+    // Element-wise comparison of the logical contents, the padding is ignored
+    template <typename T>
+    bool operator==(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2);
+    template <typename T>
+    bool operator!=(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2);
+
+    // Factories returning contiguous matrices, the counterparts of algebra::zeros, ones and random.
+    // dense::zeros(n, m) is a DenseMatrix, dense::zeros<float>(n, m) a FloatDenseMatrix.
+    namespace dense {
+        template <typename T = double>
+        BasicDenseMatrix<T> zeros(size_t n, size_t m);
+        template <typename T = double>
+        BasicDenseMatrix<T> ones(size_t n, size_t m);
+        template <typename T = double>
+        BasicDenseMatrix<T> random(size_t n, size_t m, double min, double max);
+        // Same elements as algebra::random(n, m, min, max, seed) for double
+        template <typename T = double>
+        BasicDenseMatrix<T> random(size_t n, size_t m, double min, double max, uint64_t seed);
+    }
+
+    // Overloads of the algebra API for the contiguous layout, same semantics and errors as the Matrix versions.
+    // Scalars take the element type of the matrix, so multiply(matrix, 2) works for both.
+    template <typename T>
+    using Scalar = typename BasicDenseMatrix<T>::value_type;
+
+    template <typename T>
+    void show(const BasicDenseMatrix<T>& matrix);
+    template <typename T>
+    BasicDenseMatrix<T> multiply(const BasicDenseMatrix<T>& matrix, Scalar<T> c);
+    // Products whose three dimensions all reach kStrassenThreshold (strassen.h) use the
+    // Strassen-Winograd recursion, smaller ones the blocked gemm
+    template <typename T>
+    BasicDenseMatrix<T> multiply(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2);
+    // Product of float matrices accumulated in double, for inputs stored in single precision
+    // that need double precision sums
+    DenseMatrix multiply_mixed(const FloatDenseMatrix& matrix1, const FloatDenseMatrix& matrix2);
+    template <typename T>
+    BasicDenseMatrix<T> sum(const BasicDenseMatrix<T>& matrix, Scalar<T> c);
+    template <typename T>
+    BasicDenseMatrix<T> sum(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2);
+    template <typename T>
+    BasicDenseMatrix<T> transpose(const BasicDenseMatrix<T>& matrix);
+    // Transpose a square matrix in place, without a second buffer
+    template <typename T>
+    void transpose_inplace(BasicDenseMatrix<T>& matrix);
+    template <typename T>
+    BasicDenseMatrix<T> minor(const BasicDenseMatrix<T>& matrix, size_t row, size_t col);
+    // Float matrices are factored in double precision
+    template <typename T>
+    T determinant(const BasicDenseMatrix<T>& matrix);
+    template <typename T>
+    BasicDenseMatrix<T> inverse(const BasicDenseMatrix<T>& matrix);
+    template <typename T>
+    BasicDenseMatrix<T> concatenate(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2, size_t axis);
+    template <typename T>
+    BasicDenseMatrix<T> ero_swap(const BasicDenseMatrix<T>& matrix, size_t r1, size_t r2);
+    template <typename T>
+    BasicDenseMatrix<T> ero_multiply(const BasicDenseMatrix<T>& matrix, size_t r, Scalar<T> c);
+    template <typename T>
+    BasicDenseMatrix<T> ero_sum(const BasicDenseMatrix<T>& matrix, size_t r1, Scalar<T> c, size_t r2);
+    template <typename T>
+    void ero_swap_inplace(BasicDenseMatrix<T>& matrix, size_t r1, size_t r2);
+    template <typename T>
+    void ero_multiply_inplace(BasicDenseMatrix<T>& matrix, size_t r, Scalar<T> c);
+    template <typename T>
+    void ero_sum_inplace(BasicDenseMatrix<T>& matrix, size_t r1, Scalar<T> c, size_t r2);
+    template <typename T>
+    BasicDenseMatrix<T> upper_triangular(const BasicDenseMatrix<T>& matrix, Pivoting pivoting = Pivoting::first_nonzero);
+}
+
+#endif //AP_DENSE_MATRIX_H
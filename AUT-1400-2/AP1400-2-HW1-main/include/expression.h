@@ -0,0 +1,236 @@
+#ifndef AP_EXPRESSION_H
+#define AP_EXPRESSION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "dense_matrix.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace algebra {
+    // Lazy element-wise arithmetic.
+    // lazy(A) * 2.0 + lazy(B) * 3.0 builds a small tree of nodes that only reference A and B;
+    // nothing is computed until the tree is assigned, and then every element of the
+    // destination is produced in one pass, without temporary matrices.
+    // Every node has the value_type of its elements: float only when all the leaves are float.
+    namespace expr {
+        // Base of every node, E is the node type itself
+        template <typename E>
+        struct Expression {
+            const E& self() const { return static_cast<const E&>(*this); }
+        };
+
+        // Reads the elements of one row of a stored matrix
+        template <typename T>
+        struct RowCursor {
+            const T* row;
+            T operator[](size_t j) const { return row[j]; }
+        };
+
+        template <typename T>
+        class DenseLeaf : public Expression<DenseLeaf<T>> {
+        public:
+            using value_type = T;
+            using Cursor = RowCursor<T>;
+            explicit DenseLeaf(const BasicDenseMatrix<T>& matrix) : matrix_(matrix) {}
+            size_t rows() const { return matrix_.rows(); }
+            size_t cols() const { return matrix_.cols(); }
+            Cursor cursor(size_t i) const { return {matrix_.row(i)}; }
+
+        private:
+            const BasicDenseMatrix<T>& matrix_;
+        };
+
+        class MatrixLeaf : public Expression<MatrixLeaf> {
+        public:
+            using value_type = double;
+            using Cursor = RowCursor<double>;
+            // Every row is read cols() elements long, as in a dense matrix
+            explicit MatrixLeaf(const Matrix& matrix) : matrix_(matrix) {
+                for (const Vector& row : matrix)
+                    if (row.size() != cols())
+                        throw std::logic_error("rows of a matrix must all have the same size");
+            }
+            size_t rows() const { return matrix_.size(); }
+            size_t cols() const { return matrix_.empty() ? 0 : matrix_[0].size(); }
+            Cursor cursor(size_t i) const { return {matrix_[i].data()}; }
+
+        private:
+            const Matrix& matrix_;
+        };
+
+        // Each operation names itself in the error for operands of different sizes
+        struct Plus {
+            static constexpr const char* verb = "summed";
+            template <typename T>
+            static T apply(T a, T b) { return a + b; }
+        };
+
+        struct Minus {
+            static constexpr const char* verb = "subtracted";
+            template <typename T>
+            static T apply(T a, T b) { return a - b; }
+        };
+
+        struct Times {
+            static constexpr const char* verb = "multiplied element-wise";
+            template <typename T>
+            static T apply(T a, T b) { return a * b; }
+        };
+
+        // Element-wise combination of two expressions of the same size
+        template <typename L, typename R, typename Op>
+        class Binary : public Expression<Binary<L, R, Op>> {
+        public:
+            using value_type = std::common_type_t<typename L::value_type, typename R::value_type>;
+
+            struct Cursor {
+                typename L::Cursor left;
+                typename R::Cursor right;
+                value_type operator[](size_t j) const {
+                    return Op::apply(static_cast<value_type>(left[j]), static_cast<value_type>(right[j]));
+                }
+            };
+
+            Binary(const L& left, const R& right) : left_(left), right_(right) {
+                if (left.rows() != right.rows() || left.cols() != right.cols())
+                    throw std::logic_error(std::string("matrices with different dimensions cannot be ") + Op::verb);
+            }
+            size_t rows() const { return left_.rows(); }
+            size_t cols() const { return left_.cols(); }
+            Cursor cursor(size_t i) const { return {left_.cursor(i), right_.cursor(i)}; }
+
+        private:
+            // Nodes are held by value, they are only a few references and scalars each
+            L left_;
+            R right_;
+        };
+
+        // Combination of every element of an expression with a scalar
+        template <typename E, typename Op>
+        class WithScalar : public Expression<WithScalar<E, Op>> {
+        public:
+            // The scalar takes the type of the elements, so float expressions stay in float
+            using value_type = typename E::value_type;
+
+            struct Cursor {
+                typename E::Cursor inner;
+                value_type c;
+                value_type operator[](size_t j) const { return Op::apply(inner[j], c); }
+            };
+
+            WithScalar(const E& inner, double c) : inner_(inner), c_(static_cast<value_type>(c)) {}
+            size_t rows() const { return inner_.rows(); }
+            size_t cols() const { return inner_.cols(); }
+            Cursor cursor(size_t i) const { return {inner_.cursor(i), c_}; }
+
+        private:
+            E inner_;
+            value_type c_;
+        };
+
+        template <typename L, typename R>
+        Binary<L, R, Plus> operator+(const Expression<L>& left, const Expression<R>& right) {
+            return {left.self(), right.self()};
+        }
+
+        template <typename L, typename R>
+        Binary<L, R, Minus> operator-(const Expression<L>& left, const Expression<R>& right) {
+            return {left.self(), right.self()};
+        }
+
+        template <typename E>
+        WithScalar<E, Times> operator*(const Expression<E>& e, double c) {
+            return {e.self(), c};
+        }
+
+        template <typename E>
+        WithScalar<E, Times> operator*(double c, const Expression<E>& e) {
+            return {e.self(), c};
+        }
+
+        template <typename E>
+        WithScalar<E, Plus> operator+(const Expression<E>& e, double c) {
+            return {e.self(), c};
+        }
+
+        template <typename E>
+        WithScalar<E, Plus> operator+(double c, const Expression<E>& e) {
+            return {e.self(), c};
+        }
+
+        template <typename E>
+        WithScalar<E, Plus> operator-(const Expression<E>& e, double c) {
+            return {e.self(), -c};
+        }
+
+        template <typename E>
+        WithScalar<E, Times> operator-(const Expression<E>& e) {
+            return {e.self(), -1};
+        }
+
+        // The row loop is compiled once per instruction set tier by dispatch(), so the compiler
+        // vectorizes the fused expression with the widest registers the CPU has
+        template <typename Cursor, typename T>
+        inline ALGEBRA_ALWAYS_INLINE void evaluate_row(const Cursor& cursor, T* dst, size_t n) {
+            for (size_t j = 0; j < n; ++j)
+                dst[j] = cursor[j];
+        }
+
+        // Evaluate rows [lo, hi) of an expression, row(i) gives the destination of row i
+        template <typename E, typename RowOf>
+        void evaluate_rows(const E& e, size_t lo, size_t hi, RowOf row) {
+            dispatch([&]() ALGEBRA_ALWAYS_INLINE {
+                for (size_t i = lo; i < hi; ++i)
+                    evaluate_row(e.cursor(i), row(i), e.cols());
+            });
+        }
+    }
+
+    template <typename T>
+    expr::DenseLeaf<T> lazy(const BasicDenseMatrix<T>& matrix) {
+        return expr::DenseLeaf<T>(matrix);
+    }
+
+    inline expr::MatrixLeaf lazy(const Matrix& matrix) {
+        return expr::MatrixLeaf(matrix);
+    }
+
+    // Evaluate an expression into dst in one pass over its elements, rows split across threads.
+    // dst is resized when needed and may be one of the operands of the expression.
+    template <typename T, typename E>
+    void assign(BasicDenseMatrix<T>& dst, const expr::Expression<E>& expression) {
+        const E& e = expression.self();
+        if (dst.rows() != e.rows() || dst.cols() != e.cols())
+            dst = BasicDenseMatrix<T>(e.rows(), e.cols());
+        parallel_for(0, e.rows(), e.cols(), [&](size_t lo, size_t hi) {
+            expr::evaluate_rows(e, lo, hi, [&](size_t i) { return dst.row(i); });
+        });
+    }
+
+    template <typename E>
+    void assign(Matrix& dst, const expr::Expression<E>& expression) {
+        const E& e = expression.self();
+        // Reshaped unless every row already has the size of the result
+        bool shaped = dst.size() == e.rows() &&
+                      std::all_of(dst.begin(), dst.end(), [&](const Vector& row) { return row.size() == e.cols(); });
+        if (!shaped)
+            dst.assign(e.rows(), Vector(e.cols()));
+        parallel_for(0, e.rows(), e.cols(), [&](size_t lo, size_t hi) {
+            expr::evaluate_rows(e, lo, hi, [&](size_t i) { return dst[i].data(); });
+        });
+    }
+
+    // The result has the value_type of the expression
+    template <typename E>
+    BasicDenseMatrix<typename E::value_type> evaluate(const expr::Expression<E>& expression) {
+        BasicDenseMatrix<typename E::value_type> result;
+        assign(result, expression);
+        return result;
+    }
+}
+
+#endif //AP_EXPRESSION_H
@@ -0,0 +1,88 @@
+#ifndef AP_FACTORIZATION_CACHE_H
+#define AP_FACTORIZATION_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "hw1.h"
+#include "dense_matrix.h"
+#include "solve.h"
+
+namespace algebra {
+    // Default memory for the entries of a FactorizationCache, in bytes
+    constexpr size_t kFactorizationCacheBudget = size_t(256) << 20;
+
+    // Opt-in memo of LU factorizations, for code that asks for the determinant, inverse or
+    // solution of the same unchanged matrix again and again. A hit costs O(n^2) for a matrix
+    // found by its contents and O(1) for one found by a caller-maintained version, instead of
+    // the O(n^3) factorization. Inverses are kept next to their factorization once asked for.
+    // The least recently used entries are dropped to stay within the memory budget.
+    // All members may be called from several threads.
+    class FactorizationCache {
+    public:
+        struct Stats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+            size_t entries = 0;
+            // Memory held by the entries
+            size_t bytes = 0;
+        };
+
+        explicit FactorizationCache(size_t memory_budget = kFactorizationCacheBudget);
+        ~FactorizationCache();
+        FactorizationCache(const FactorizationCache&) = delete;
+        FactorizationCache& operator=(const FactorizationCache&) = delete;
+
+        // Found by a hash of the contents, then compared element by element: a copy of the
+        // matrix is kept with its factorization
+        std::shared_ptr<const Factorization> factorization(const Matrix& matrix);
+        std::shared_ptr<const Factorization> factorization(const DenseMatrix& matrix);
+        // Found by id alone: the caller bumps version whenever the matrix changes, and the entry
+        // of an older version is replaced. The contents are never read on a hit.
+        std::shared_ptr<const Factorization> factorization(const DenseMatrix& matrix, uint64_t id, uint64_t version);
+
+        // Same results and errors as algebra::determinant and algebra::inverse
+        double determinant(const Matrix& matrix);
+        Matrix inverse(const Matrix& matrix);
+
+        Stats stats() const;
+        size_t memory_budget() const { return budget_; }
+        void clear();
+
+    private:
+        struct Entry;
+        using Entries = std::list<Entry>;
+
+        // Content hashes and ids are kept apart
+        struct Key {
+            uint64_t value;
+            bool versioned;
+
+            bool operator==(const Key& other) const { return value == other.value && versioned == other.versioned; }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const { return static_cast<size_t>(key.value * 2 + key.versioned); }
+        };
+
+        // The entry for key, moved to the front, or nullptr when it is missing or stale
+        Entry* find(const Key& key, const DenseMatrix& matrix, uint64_t version);
+        std::shared_ptr<const Factorization> lookup(const Key& key, const DenseMatrix& matrix, uint64_t version,
+                                                    std::shared_ptr<const Matrix>* inverse);
+        void insert(const Key& key, DenseMatrix copy, uint64_t version, std::shared_ptr<const Factorization> factorization);
+        void erase(Entries::iterator entry);
+        void evict_to_budget();
+
+        size_t budget_;
+        mutable std::mutex mutex_;
+        Entries entries_;
+        std::unordered_map<Key, Entries::iterator, KeyHash> index_;
+        Stats stats_;
+    };
+}
+
+#endif //AP_FACTORIZATION_CACHE_H
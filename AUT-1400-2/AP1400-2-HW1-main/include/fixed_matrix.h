@@ -0,0 +1,281 @@
+#ifndef AP_FIXED_MATRIX_H
+#define AP_FIXED_MATRIX_H
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include "hw1.h"
+
+namespace algebra {
+    // N x M matrix with its size in the type, stored row-major in a std::array.
+    // It lives on the stack, never allocates, and every operation below is constexpr;
+    // 2x2, 3x3 and 4x4 determinants and inverses are written out in closed form.
+    template <typename T, size_t N, size_t M>
+    struct FixedMatrix {
+        using value_type = T;
+
+        std::array<T, N * M> elements{};
+
+        static constexpr size_t rows() { return N; }
+        static constexpr size_t cols() { return M; }
+
+        constexpr T& operator()(size_t i, size_t j) { return elements[i * M + j]; }
+        constexpr const T& operator()(size_t i, size_t j) const { return elements[i * M + j]; }
+
+        static constexpr FixedMatrix filled(T value) {
+            FixedMatrix result;
+            for (size_t i = 0; i < N * M; ++i)
+                result.elements[i] = value;
+            return result;
+        }
+
+        static constexpr FixedMatrix identity() {
+            static_assert(N == M, "the identity is square");
+            FixedMatrix result;
+            for (size_t i = 0; i < N; ++i)
+                result(i, i) = 1;
+            return result;
+        }
+
+        // Copy into the dynamic layout
+        Matrix to_matrix() const {
+            Matrix result(N, Vector(M));
+            for (size_t i = 0; i < N; ++i)
+                for (size_t j = 0; j < M; ++j)
+                    result[i][j] = static_cast<double>((*this)(i, j));
+            return result;
+        }
+    };
+
+    // Copy a dynamic matrix of exactly N x M elements.
+    // Throws std::logic_error when the sizes differ.
+    template <size_t N, size_t M, typename T = double>
+    FixedMatrix<T, N, M> to_fixed(const Matrix& matrix) {
+        if (matrix.size() != N)
+            throw std::logic_error("matrix does not have the size of the fixed matrix");
+        FixedMatrix<T, N, M> result;
+        for (size_t i = 0; i < N; ++i) {
+            if (matrix[i].size() != M)
+                throw std::logic_error("matrix does not have the size of the fixed matrix");
+            for (size_t j = 0; j < M; ++j)
+                result(i, j) = static_cast<T>(matrix[i][j]);
+        }
+        return result;
+    }
+
+    template <typename T, size_t N, size_t M>
+    constexpr bool operator==(const FixedMatrix<T, N, M>& matrix1, const FixedMatrix<T, N, M>& matrix2) {
+        for (size_t i = 0; i < N * M; ++i)
+            if (matrix1.elements[i] != matrix2.elements[i])
+                return false;
+        return true;
+    }
+
+    template <typename T, size_t N, size_t M>
+    constexpr bool operator!=(const FixedMatrix<T, N, M>& matrix1, const FixedMatrix<T, N, M>& matrix2) {
+        return !(matrix1 == matrix2);
+    }
+
+    // The loop bounds are constants, so the compiler unrolls the small cases completely
+    template <typename T, size_t N, size_t K, size_t M>
+    constexpr FixedMatrix<T, N, M> multiply(const FixedMatrix<T, N, K>& matrix1, const FixedMatrix<T, K, M>& matrix2) {
+        FixedMatrix<T, N, M> result;
+        for (size_t i = 0; i < N; ++i)
+            for (size_t k = 0; k < K; ++k)
+                for (size_t j = 0; j < M; ++j)
+                    result(i, j) += matrix1(i, k) * matrix2(k, j);
+        return result;
+    }
+
+    template <typename T, size_t N, size_t M>
+    constexpr FixedMatrix<T, N, M> multiply(const FixedMatrix<T, N, M>& matrix, typename FixedMatrix<T, N, M>::value_type c) {
+        FixedMatrix<T, N, M> result = matrix;
+        for (T& element : result.elements)
+            element *= c;
+        return result;
+    }
+
+    template <typename T, size_t N, size_t M>
+    constexpr FixedMatrix<T, N, M> sum(const FixedMatrix<T, N, M>& matrix, typename FixedMatrix<T, N, M>::value_type c) {
+        FixedMatrix<T, N, M> result = matrix;
+        for (T& element : result.elements)
+            element += c;
+        return result;
+    }
+
+    template <typename T, size_t N, size_t M>
+    constexpr FixedMatrix<T, N, M> sum(const FixedMatrix<T, N, M>& matrix1, const FixedMatrix<T, N, M>& matrix2) {
+        FixedMatrix<T, N, M> result = matrix1;
+        for (size_t i = 0; i < N * M; ++i)
+            result.elements[i] += matrix2.elements[i];
+        return result;
+    }
+
+    template <typename T, size_t N, size_t M>
+    constexpr FixedMatrix<T, M, N> transpose(const FixedMatrix<T, N, M>& matrix) {
+        FixedMatrix<T, M, N> result;
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < M; ++j)
+                result(j, i) = matrix(i, j);
+        return result;
+    }
+
+    namespace fixed {
+        template <typename T>
+        constexpr T abs(T x) { return x < 0 ? -x : x; }
+
+        // The 2x2 minors of rows 0-1 (s) and rows 2-3 (c) of a 4x4 matrix, the building
+        // blocks of its determinant and adjugate
+        template <typename T>
+        struct Minors4 {
+            T s0, s1, s2, s3, s4, s5;
+            T c0, c1, c2, c3, c4, c5;
+
+            constexpr explicit Minors4(const FixedMatrix<T, 4, 4>& a)
+                : s0(a(0, 0) * a(1, 1) - a(1, 0) * a(0, 1)), s1(a(0, 0) * a(1, 2) - a(1, 0) * a(0, 2)),
+                  s2(a(0, 0) * a(1, 3) - a(1, 0) * a(0, 3)), s3(a(0, 1) * a(1, 2) - a(1, 1) * a(0, 2)),
+                  s4(a(0, 1) * a(1, 3) - a(1, 1) * a(0, 3)), s5(a(0, 2) * a(1, 3) - a(1, 2) * a(0, 3)),
+                  c0(a(2, 0) * a(3, 1) - a(3, 0) * a(2, 1)), c1(a(2, 0) * a(3, 2) - a(3, 0) * a(2, 2)),
+                  c2(a(2, 0) * a(3, 3) - a(3, 0) * a(2, 3)), c3(a(2, 1) * a(3, 2) - a(3, 1) * a(2, 2)),
+                  c4(a(2, 1) * a(3, 3) - a(3, 1) * a(2, 3)), c5(a(2, 2) * a(3, 3) - a(3, 2) * a(2, 3)) {}
+
+            constexpr T determinant() const {
+                return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+            }
+        };
+
+        // Gauss-Jordan elimination with partial pivoting on [matrix | rhs]; returns the
+        // determinant of matrix and leaves matrix^-1 * rhs in rhs when it is not zero
+        template <typename T, size_t N, size_t R>
+        constexpr T eliminate(FixedMatrix<T, N, N> matrix, FixedMatrix<T, N, R>& rhs) {
+            T det = 1;
+            for (size_t col = 0; col < N; ++col) {
+                size_t pivot = col;
+                for (size_t i = col + 1; i < N; ++i)
+                    if (abs(matrix(i, col)) > abs(matrix(pivot, col)))
+                        pivot = i;
+                if (matrix(pivot, col) == 0)
+                    return 0;
+                if (pivot != col) {
+                    for (size_t j = 0; j < N; ++j) {
+                        T t = matrix(col, j);
+                        matrix(col, j) = matrix(pivot, j);
+                        matrix(pivot, j) = t;
+                    }
+                    for (size_t j = 0; j < R; ++j) {
+                        T t = rhs(col, j);
+                        rhs(col, j) = rhs(pivot, j);
+                        rhs(pivot, j) = t;
+                    }
+                    det = -det;
+                }
+                T p = matrix(col, col);
+                det *= p;
+                for (size_t j = 0; j < N; ++j)
+                    matrix(col, j) /= p;
+                for (size_t j = 0; j < R; ++j)
+                    rhs(col, j) /= p;
+                for (size_t i = 0; i < N; ++i) {
+                    if (i == col || matrix(i, col) == 0)
+                        continue;
+                    T f = matrix(i, col);
+                    for (size_t j = 0; j < N; ++j)
+                        matrix(i, j) -= f * matrix(col, j);
+                    for (size_t j = 0; j < R; ++j)
+                        rhs(i, j) -= f * rhs(col, j);
+                }
+            }
+            return det;
+        }
+    }
+
+    template <typename T, size_t N>
+    constexpr T determinant(const FixedMatrix<T, N, N>& m) {
+        if constexpr (N == 0) {
+            return 1;
+        } else if constexpr (N == 1) {
+            return m(0, 0);
+        } else if constexpr (N == 2) {
+            return m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+        } else if constexpr (N == 3) {
+            return m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) -
+                   m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0)) +
+                   m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+        } else if constexpr (N == 4) {
+            return fixed::Minors4<T>(m).determinant();
+        } else {
+            FixedMatrix<T, N, 0> none;
+            return fixed::eliminate(m, none);
+        }
+    }
+
+    // Transposed matrix of cofactors, inverse(m) * determinant(m) for N up to 4.
+    // Straight-line code without branches, so it also vectorizes across a batch of matrices.
+    template <typename T, size_t N>
+    constexpr FixedMatrix<T, N, N> adjugate(const FixedMatrix<T, N, N>& m) {
+        static_assert(N >= 1 && N <= 4, "closed forms exist up to 4x4");
+        FixedMatrix<T, N, N> result;
+        if constexpr (N == 1) {
+            result(0, 0) = 1;
+        } else if constexpr (N == 2) {
+            result(0, 0) = m(1, 1);
+            result(0, 1) = -m(0, 1);
+            result(1, 0) = -m(1, 0);
+            result(1, 1) = m(0, 0);
+        } else if constexpr (N == 3) {
+            result(0, 0) = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+            result(1, 0) = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+            result(2, 0) = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+            result(0, 1) = m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2);
+            result(1, 1) = m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0);
+            result(2, 1) = m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1);
+            result(0, 2) = m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1);
+            result(1, 2) = m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2);
+            result(2, 2) = m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+        } else {
+            fixed::Minors4<T> k(m);
+            result(0, 0) = m(1, 1) * k.c5 - m(1, 2) * k.c4 + m(1, 3) * k.c3;
+            result(0, 1) = -m(0, 1) * k.c5 + m(0, 2) * k.c4 - m(0, 3) * k.c3;
+            result(0, 2) = m(3, 1) * k.s5 - m(3, 2) * k.s4 + m(3, 3) * k.s3;
+            result(0, 3) = -m(2, 1) * k.s5 + m(2, 2) * k.s4 - m(2, 3) * k.s3;
+            result(1, 0) = -m(1, 0) * k.c5 + m(1, 2) * k.c2 - m(1, 3) * k.c1;
+            result(1, 1) = m(0, 0) * k.c5 - m(0, 2) * k.c2 + m(0, 3) * k.c1;
+            result(1, 2) = -m(3, 0) * k.s5 + m(3, 2) * k.s2 - m(3, 3) * k.s1;
+            result(1, 3) = m(2, 0) * k.s5 - m(2, 2) * k.s2 + m(2, 3) * k.s1;
+            result(2, 0) = m(1, 0) * k.c4 - m(1, 1) * k.c2 + m(1, 3) * k.c0;
+            result(2, 1) = -m(0, 0) * k.c4 + m(0, 1) * k.c2 - m(0, 3) * k.c0;
+            result(2, 2) = m(3, 0) * k.s4 - m(3, 1) * k.s2 + m(3, 3) * k.s0;
+            result(2, 3) = -m(2, 0) * k.s4 + m(2, 1) * k.s2 - m(2, 3) * k.s0;
+            result(3, 0) = -m(1, 0) * k.c3 + m(1, 1) * k.c1 - m(1, 2) * k.c0;
+            result(3, 1) = m(0, 0) * k.c3 - m(0, 1) * k.c1 + m(0, 2) * k.c0;
+            result(3, 2) = -m(3, 0) * k.s3 + m(3, 1) * k.s1 - m(3, 2) * k.s0;
+            result(3, 3) = m(2, 0) * k.s3 - m(2, 1) * k.s1 + m(2, 2) * k.s0;
+        }
+        return result;
+    }
+
+    // Throws std::logic_error for a singular matrix
+    template <typename T, size_t N>
+    constexpr FixedMatrix<T, N, N> inverse(const FixedMatrix<T, N, N>& m) {
+        if constexpr (N == 0) {
+            return m;
+        } else if constexpr (N <= 4) {
+            T det = determinant(m);
+            if (det == 0)
+                throw std::logic_error("matrix is singular, cannot be inverted");
+            // Divided element by element, a reciprocal multiply would round differently
+            FixedMatrix<T, N, N> result = adjugate(m);
+            for (size_t i = 0; i < N; ++i)
+                for (size_t j = 0; j < N; ++j)
+                    result(i, j) /= det;
+            return result;
+        } else {
+            FixedMatrix<T, N, N> result = FixedMatrix<T, N, N>::identity();
+            if (fixed::eliminate(m, result) == 0)
+                throw std::logic_error("matrix is singular, cannot be inverted");
+            return result;
+        }
+    }
+}
+
+#endif //AP_FIXED_MATRIX_H
@@ -0,0 +1,37 @@
+#ifndef AP_FORMAT_H
+#define AP_FORMAT_H
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <ostream>
+#include <string>
+#include "hw1.h"
+#include "dense_matrix.h"
+#include "matrix_view.h"
+
+namespace algebra {
+    // Destination of formatted text, called with one large chunk at a time.
+    // Sinks throw std::runtime_error when they cannot write.
+    using Sink = std::function<void(const char* data, size_t size)>;
+
+    // Write to a file descriptor with write(2), retrying short writes
+    Sink fd_sink(int fd);
+    // Write to a C stream with fwrite
+    Sink file_sink(std::FILE* file);
+    // Write to a C++ stream, in order with whatever else goes to it
+    Sink stream_sink(std::ostream& out);
+    // Append to a string, which must outlive the sink
+    Sink string_sink(std::string& out);
+
+    // Write the text of algebra::show to sink, byte for byte: every element with three decimals
+    // as std::fixed << std::setprecision(3) prints it, separated by spaces, one line per row,
+    // and a single newline for an empty matrix. Numbers are formatted with std::to_chars into
+    // reusable buffers, blocks of rows in parallel, and every block reaches the sink in one call.
+    void print(const Matrix& matrix, const Sink& sink);
+    template <typename T>
+    void print(const BasicDenseMatrix<T>& matrix, const Sink& sink);
+    void print(ConstMatrixView matrix, const Sink& sink);
+}
+
+#endif //AP_FORMAT_H
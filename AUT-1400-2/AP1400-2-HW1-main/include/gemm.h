@@ -0,0 +1,47 @@
+#ifndef AP_GEMM_H
+#define AP_GEMM_H
+
+#include <cstddef>
+
+namespace algebra {
+    // Below this many multiply-adds (m * n * k) the plain loops win over packing
+    constexpr size_t kGemmThreshold = 64 * 64 * 64;
+
+    // Blocked matrix product C += A * B on row-major operands.
+    // A is m x k with row stride lda, B is k x n with row stride ldb, C is m x n with row stride ldc.
+    // The operands are split into panels that fit the L1, L2 and L3 caches, packed into
+    // contiguous buffers, and multiplied by a register-blocked micro-kernel.
+    void gemm(size_t m, size_t n, size_t k,
+              const double* a, size_t lda,
+              const double* b, size_t ldb,
+              double* c, size_t ldc);
+
+    // Scaled product C += alpha * A * B, alpha is applied while A is packed
+    void gemm(size_t m, size_t n, size_t k, double alpha,
+              const double* a, size_t lda,
+              const double* b, size_t ldb,
+              double* c, size_t ldc);
+
+    // Single precision product, twice the elements per register and half the memory traffic
+    void gemm(size_t m, size_t n, size_t k,
+              const float* a, size_t lda,
+              const float* b, size_t ldb,
+              float* c, size_t ldc);
+    void gemm(size_t m, size_t n, size_t k, float alpha,
+              const float* a, size_t lda,
+              const float* b, size_t ldb,
+              float* c, size_t ldc);
+
+    // Mixed precision: float operands, accumulated in double. The panels are widened to
+    // double while they are packed and then multiplied by the double micro-kernel.
+    void gemm(size_t m, size_t n, size_t k,
+              const float* a, size_t lda,
+              const float* b, size_t ldb,
+              double* c, size_t ldc);
+    void gemm(size_t m, size_t n, size_t k, double alpha,
+              const float* a, size_t lda,
+              const float* b, size_t ldb,
+              double* c, size_t ldc);
+}
+
+#endif //AP_GEMM_H
@@ -1,25 +1,41 @@
 #ifndef AP_HW1_H
 #define AP_HW1_H
 
+#include <cstdint>
 #include <vector>
 #include <random>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 
-using Matrix = std::vector<std::vector<double>>;
-using Vector = std::vector<double>;
+// Nested-vector matrix and vector of any element type, Matrix and Vector are the double ones
+template <typename T>
+using BasicMatrix = std::vector<std::vector<T>>;
+template <typename T>
+using BasicVector = std::vector<T>;
+
+using Matrix = BasicMatrix<double>;
+using Vector = BasicVector<double>;
 
 namespace algebra {
+    // Choice of the pivot in a column during elimination: the first non-zero element, the rule
+    // of the original homework, or the largest in magnitude (partial pivoting), which keeps every
+    // multiplier at most 1 and the rounding errors small
+    enum class Pivoting { first_nonzero, partial };
+
     Matrix zeros(size_t n, size_t m);
     Matrix ones(size_t n, size_t m);
     Matrix random(size_t n, size_t m, double min, double max);
+    // Reproducible version: the same seed gives the same matrix, whatever the thread count
+    Matrix random(size_t n, size_t m, double min, double max, uint64_t seed);
     void show(const Matrix& matrix);
     Matrix multiply(const Matrix& matrix, double c);
     Matrix multiply(const Matrix& matrix1, const Matrix& matrix2);
     Matrix sum(const Matrix& matrix, double c);
     Matrix sum(const Matrix& matrix1, const Matrix& matrix2);
     Matrix transpose(const Matrix& matrix);
+    // Transpose a square matrix in place, without a second buffer
+    void transpose_inplace(Matrix& matrix);
     Matrix minor(const Matrix& matrix, size_t row, size_t col);
     double determinant(const Matrix& matrix);
     Matrix inverse(const Matrix& matrix);
@@ -27,7 +43,13 @@ namespace algebra {
     Matrix ero_swap(const Matrix& matrix, size_t r1, size_t r2);
     Matrix ero_multiply(const Matrix& matrix, size_t r, double c);
     Matrix ero_sum(const Matrix& matrix, size_t r1,  double c, size_t r2);
-    Matrix upper_triangular(const Matrix& matrix);
+    // In-place elementary row operations, the ero_* functions above return modified copies
+    void ero_swap_inplace(Matrix& matrix, size_t r1, size_t r2);
+    void ero_multiply_inplace(Matrix& matrix, size_t r, double c);
+    void ero_sum_inplace(Matrix& matrix, size_t r1, double c, size_t r2);
+    Matrix upper_triangular(const Matrix& matrix, Pivoting pivoting = Pivoting::first_nonzero);
+    // Reduce a square matrix to upper triangular form in place
+    void upper_triangular_inplace(Matrix& matrix, Pivoting pivoting = Pivoting::first_nonzero);
 }
 
 #endif //AP_HW1_H
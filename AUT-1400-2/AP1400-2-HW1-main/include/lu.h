@@ -0,0 +1,77 @@
+#ifndef AP_LU_H
+#define AP_LU_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "dense_matrix.h"
+
+namespace algebra {
+    // Matrices from this size on are factored block by block
+    constexpr size_t kLuBlockThreshold = 128;
+    // Width of the panels of the blocked factorization
+    constexpr size_t kLuBlockSize = 64;
+
+    // P * A = L * U, with partial pivoting unless asked otherwise
+    struct LuDecomposition {
+        // L below the diagonal (its unit diagonal is not stored) and U on and above it
+        DenseMatrix lu;
+        // At step i, row i was swapped with row pivots[i]
+        std::vector<size_t> pivots;
+        // Determinant of the permutation, +1 or -1
+        int sign = 1;
+        // Set when a whole pivot column was zero, U then has a zero on its diagonal
+        bool singular = false;
+    };
+
+    // Row of the pivot among rows [first, end) of a column read through value(i), or end when
+    // the column is zero there
+    template <typename Value>
+    size_t find_pivot(size_t first, size_t end, Pivoting pivoting, Value value) {
+        if (pivoting == Pivoting::first_nonzero) {
+            size_t pivot = first;
+            while (pivot < end && value(pivot) == 0)
+                ++pivot;
+            return pivot;
+        }
+        size_t pivot = first;
+        double largest = std::abs(static_cast<double>(value(first)));
+        for (size_t i = first + 1; i < end; ++i) {
+            double magnitude = std::abs(static_cast<double>(value(i)));
+            if (magnitude > largest) {
+                largest = magnitude;
+                pivot = i;
+            }
+        }
+        return largest == 0 ? end : pivot;
+    }
+
+    // Factor a square matrix. Small matrices use the unblocked right-looking algorithm; from
+    // kLuBlockThreshold on, panels of kLuBlockSize columns are factored and the trailing matrix
+    // is updated with one triangular solve and one GEMM per panel. With look-ahead: the columns
+    // of the next panel are updated first, then one thread factors that panel while the others
+    // update the columns right of it.
+    // The partial pivoting default is the one determinant, inverse and solve rely on.
+    // Throws std::logic_error for non-square matrices.
+    LuDecomposition lu_factor(DenseMatrix matrix, Pivoting pivoting = Pivoting::partial);
+    // Same factorization, always with the unblocked algorithm
+    LuDecomposition lu_factor_unblocked(DenseMatrix matrix, Pivoting pivoting = Pivoting::partial);
+    // Same factorization of a band matrix, zero more than lower rows below and upper columns
+    // above the diagonal: every step eliminates at most lower rows over lower + upper + 1
+    // columns (the row swaps widen the upper band by lower), O(n * lower * (lower + upper))
+    // instead of O(n^3).
+    LuDecomposition lu_factor_banded(DenseMatrix matrix, size_t lower, size_t upper,
+                                     Pivoting pivoting = Pivoting::partial);
+
+    // U alone, zero below the diagonal
+    DenseMatrix upper(const LuDecomposition& lu);
+
+    // Product of the diagonal of U times the sign of the permutation
+    double determinant(const LuDecomposition& lu);
+    // Inverse from the factorization: blocked forward and back substitutions (trsm.h) on the
+    // permuted identity.
+    // Throws std::logic_error when the factorization found a zero pivot.
+    DenseMatrix inverse(const LuDecomposition& lu);
+}
+
+#endif //AP_LU_H
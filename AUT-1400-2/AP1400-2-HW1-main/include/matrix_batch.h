@@ -0,0 +1,55 @@
+#ifndef AP_MATRIX_BATCH_H
+#define AP_MATRIX_BATCH_H
+
+#include <cstddef>
+#include <vector>
+#include "dense_matrix.h"
+
+namespace algebra {
+    // Many small matrices of the same size stored as a structure of arrays: element (i, j) of
+    // every matrix is one contiguous, aligned lane, so a vector register processes as many
+    // matrices at once as it holds doubles.
+    class MatrixBatch {
+    public:
+        MatrixBatch() = default;
+        // count zero matrices of rows x cols
+        MatrixBatch(size_t count, size_t rows, size_t cols);
+
+        size_t size() const { return count_; }
+        size_t rows() const { return rows_; }
+        size_t cols() const { return cols_; }
+        // Distance in elements between two lanes, size() rounded up to a whole cache line
+        size_t stride() const { return stride_; }
+
+        // Element (i, j) of every matrix, lane(i, j)[b] belongs to matrix b
+        double* lane(size_t i, size_t j) { return data_.data() + (i * cols_ + j) * stride_; }
+        const double* lane(size_t i, size_t j) const { return data_.data() + (i * cols_ + j) * stride_; }
+
+        double& operator()(size_t b, size_t i, size_t j) { return lane(i, j)[b]; }
+        double operator()(size_t b, size_t i, size_t j) const { return lane(i, j)[b]; }
+
+        // Copy matrix b out of or into the batch.
+        // Throws std::out_of_range for b >= size() and std::logic_error for a matrix of another size.
+        Matrix get(size_t b) const;
+        void set(size_t b, const Matrix& matrix);
+
+    private:
+        size_t count_{};
+        size_t rows_{};
+        size_t cols_{};
+        size_t stride_{};
+        std::vector<double, AlignedAllocator<double>> data_;
+    };
+
+    // Product of every pair of matrices, result b is matrix1[b] * matrix2[b].
+    // Throws std::logic_error when the batches differ in size or the matrices cannot be multiplied.
+    MatrixBatch batch_multiply(const MatrixBatch& matrix1, const MatrixBatch& matrix2);
+    // Determinant of every matrix. Up to 4x4 the closed forms run across the lanes,
+    // larger matrices go one by one through the LU factorization.
+    Vector batch_determinant(const MatrixBatch& matrix);
+    // Inverse of every matrix, computed like batch_determinant.
+    // Throws std::logic_error for non-square matrices or when any of them is singular.
+    MatrixBatch batch_inverse(const MatrixBatch& matrix);
+}
+
+#endif //AP_MATRIX_BATCH_H
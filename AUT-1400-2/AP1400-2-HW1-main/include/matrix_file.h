@@ -0,0 +1,148 @@
+#ifndef AP_MATRIX_FILE_H
+#define AP_MATRIX_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "dense_matrix.h"
+#include "matrix_view.h"
+
+namespace algebra {
+    // Binary matrix files: a 64 byte header followed by the raw row-major payload.
+    // Every row starts on a multiple of the header's alignment and is padded with zeros up to
+    // stride elements, which is exactly the layout of a BasicDenseMatrix, so a file can be mapped
+    // and used in place. Numbers in the header and the payload are in the byte order of the writer.
+
+    // Element type of the payload
+    enum class DType : uint32_t { float32 = 1, float64 = 2 };
+
+    template <typename T>
+    constexpr DType dtype_of();
+    template <>
+    constexpr DType dtype_of<float>() { return DType::float32; }
+    template <>
+    constexpr DType dtype_of<double>() { return DType::float64; }
+
+    struct MatrixFileHeader {
+        // "ALGEBRA" followed by a zero byte
+        char magic[8];
+        uint32_t version;
+        // A DType
+        uint32_t dtype;
+        // kByteOrderMark as the writer stores it, reads back byte-swapped on the other byte order
+        uint32_t byte_order;
+        // Alignment of the payload and of every row, in bytes
+        uint32_t alignment;
+        uint64_t rows;
+        uint64_t cols;
+        // Elements from the start of one row to the start of the next
+        uint64_t stride;
+        uint8_t reserved[16];
+
+        static constexpr uint32_t kVersion = 1;
+        static constexpr uint32_t kByteOrderMark = 0x01020304;
+    };
+    static_assert(sizeof(MatrixFileHeader) == 64, "the header keeps the payload aligned to 64 bytes");
+
+    // Writes a matrix file row by row, so a matrix larger than memory can be produced in pieces.
+    // Throws std::runtime_error when the file cannot be written and std::logic_error when more or
+    // fewer than rows rows are written.
+    template <typename T>
+    class MatrixWriter {
+    public:
+        MatrixWriter(const std::string& path, size_t rows, size_t cols);
+        // Closes the file, errors are only reported by an explicit close()
+        ~MatrixWriter();
+        MatrixWriter(const MatrixWriter&) = delete;
+        MatrixWriter& operator=(const MatrixWriter&) = delete;
+
+        // Append the cols elements of the next row
+        void write_row(const T* row);
+        // Append count rows whose starts are stride elements apart
+        void write_rows(const T* rows, size_t count, size_t stride);
+        // Flush and close, checking that every row was written
+        void close();
+
+        size_t rows_written() const { return written_; }
+
+    private:
+        std::ofstream out_;
+        size_t rows_;
+        size_t cols_;
+        size_t stride_;
+        size_t written_{};
+    };
+
+    extern template class MatrixWriter<double>;
+    extern template class MatrixWriter<float>;
+
+    // Write a whole matrix, in its own element type
+    template <typename T>
+    void save(const BasicDenseMatrix<T>& matrix, const std::string& path);
+    // Read a whole file into memory. Files of the other byte order are swapped while they are read.
+    // Throws std::runtime_error for a missing or malformed file and std::logic_error when the file
+    // holds another element type than T.
+    template <typename T = double>
+    BasicDenseMatrix<T> load(const std::string& path);
+
+    // Header of a matrix file with its sizes in the native byte order, the payload is not read.
+    // byte_order is left as stored: it differs from kByteOrderMark when the payload has the other byte order.
+    // Throws std::runtime_error for a missing or malformed file.
+    MatrixFileHeader read_header(const std::string& path);
+    // Create the file of a rows x cols matrix of zeros, to be filled in place through a writable
+    // MappedMatrix or positioned writes. The payload is not written, so on most file systems
+    // the file takes no space until it is filled.
+    void create_matrix_file(const std::string& path, size_t rows, size_t cols, DType dtype = DType::float64);
+
+    // A matrix file mapped into memory. Opening it reads nothing but the header: pages are loaded
+    // on first access and shared through the page cache with every process mapping the same file.
+    // A writable mapping writes straight through to the file.
+    // Throws std::runtime_error for a missing or malformed file, or one of the other byte order.
+    class MappedMatrix {
+    public:
+        explicit MappedMatrix(const std::string& path, bool writable = false);
+        ~MappedMatrix();
+        MappedMatrix(MappedMatrix&& other) noexcept;
+        MappedMatrix& operator=(MappedMatrix&& other) noexcept;
+        MappedMatrix(const MappedMatrix&) = delete;
+        MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+        size_t rows() const { return rows_; }
+        size_t cols() const { return cols_; }
+        size_t stride() const { return stride_; }
+        DType dtype() const { return dtype_; }
+        bool writable() const { return writable_; }
+
+        // The payload as elements of T, throws std::logic_error when T is not the file's element type
+        template <typename T>
+        const T* data() const {
+            check_dtype(dtype_of<T>());
+            return static_cast<const T*>(payload_);
+        }
+
+        // Zero-copy views of a float64 file, the writable one needs a writable mapping.
+        // Throws std::logic_error otherwise.
+        ConstMatrixView view() const;
+        MatrixView mutable_view();
+
+        // Copy into memory, converting to T
+        template <typename T = double>
+        BasicDenseMatrix<T> to_dense() const;
+
+    private:
+        void check_dtype(DType dtype) const;
+        void unmap();
+
+        void* mapping_ = nullptr;
+        size_t length_ = 0;
+        void* payload_ = nullptr;
+        size_t rows_ = 0;
+        size_t cols_ = 0;
+        size_t stride_ = 0;
+        DType dtype_ = DType::float64;
+        bool writable_ = false;
+    };
+}
+
+#endif //AP_MATRIX_FILE_H
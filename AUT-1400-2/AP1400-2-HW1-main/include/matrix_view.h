@@ -0,0 +1,212 @@
+#ifndef AP_MATRIX_VIEW_H
+#define AP_MATRIX_VIEW_H
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include "dense_matrix.h"
+
+namespace algebra {
+    // Most positions a view can skip along one axis, i.e. how many minors of minors can be nested
+    constexpr size_t kMaxViewSkips = 8;
+
+    // How the indices of a view along one axis map to indices of the viewed matrix:
+    // index i of the view is source(i) = offset + step * k, where k is the i-th position
+    // that is not in the ascending list of skipped positions
+    struct ViewAxis {
+        size_t size = 0;
+        size_t offset = 0;
+        size_t step = 1;
+        size_t skip_count = 0;
+        std::array<size_t, kMaxViewSkips> skips{};
+
+        size_t position(size_t i) const {
+            for (size_t s = 0; s < skip_count && skips[s] <= i; ++s)
+                ++i;
+            return i;
+        }
+
+        size_t source(size_t i) const { return offset + step * position(i); }
+
+        // The same axis without index i
+        ViewAxis without(size_t i) const {
+            if (skip_count == kMaxViewSkips)
+                throw std::logic_error("too many skipped rows or columns in a view");
+            ViewAxis result = *this;
+            size_t skipped = position(i);
+            size_t s = result.skip_count++;
+            for (; s > 0 && result.skips[s - 1] > skipped; --s)
+                result.skips[s] = result.skips[s - 1];
+            result.skips[s] = skipped;
+            --result.size;
+            return result;
+        }
+
+        // count indices of this axis, from first on, every step-th one
+        ViewAxis slice(size_t first, size_t count, size_t every) const {
+            if (every == 0)
+                throw std::logic_error("a view cannot have a zero step");
+            if (count > 0 && first + (count - 1) * every >= size)
+                throw std::out_of_range("submatrix out of range");
+            ViewAxis result;
+            result.size = count;
+            if (count == 0)
+                return result;
+            if (skip_count == 0) {
+                result.offset = offset + step * first;
+                result.step = step * every;
+                return result;
+            }
+            // Skipped positions cannot be expressed on a strided sequence
+            if (every != 1)
+                throw std::logic_error("a view with skipped rows or columns cannot be strided");
+            size_t start = position(first);
+            result.offset = offset + step * start;
+            result.step = step;
+            for (size_t s = 0; s < skip_count; ++s)
+                if (skips[s] > start)
+                    result.skips[result.skip_count++] = skips[s] - start;
+            return result;
+        }
+    };
+
+    // Non-owning window on a Matrix or a DenseMatrix: a range of rows and columns, optionally
+    // strided, with up to kMaxViewSkips rows and columns left out. Creating one never copies an
+    // element; the viewed matrix must outlive the view and keep its size.
+    // T is double for a MatrixView, which can write through, and const double for a ConstMatrixView.
+    template <typename T>
+    class BasicMatrixView {
+    public:
+        using Nested = std::conditional_t<std::is_const<T>::value, const Matrix, Matrix>;
+        using Dense = std::conditional_t<std::is_const<T>::value, const DenseMatrix, DenseMatrix>;
+
+        BasicMatrixView() = default;
+
+        explicit BasicMatrixView(Nested& matrix) : nested_(matrix.data()) {
+            rows_.size = matrix.size();
+            cols_.size = matrix.empty() ? 0 : matrix[0].size();
+        }
+
+        explicit BasicMatrixView(Dense& matrix) : data_(matrix.data()), stride_(matrix.stride()) {
+            rows_.size = matrix.rows();
+            cols_.size = matrix.cols();
+        }
+
+        // rows x cols elements stored row-major at data, the starts of two rows stride elements apart
+        BasicMatrixView(T* data, size_t rows, size_t cols, size_t stride) : data_(data), stride_(stride) {
+            rows_.size = rows;
+            cols_.size = cols;
+        }
+
+        // A MatrixView can be read through as a ConstMatrixView
+        template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value && !std::is_same<U, T>::value>>
+        BasicMatrixView(const BasicMatrixView<U>& other)
+            : nested_(other.nested_), data_(other.data_), stride_(other.stride_), rows_(other.rows_), cols_(other.cols_) {}
+
+        size_t rows() const { return rows_.size; }
+        size_t cols() const { return cols_.size; }
+        bool empty() const { return rows_.size == 0 || cols_.size == 0; }
+
+        T& operator()(size_t i, size_t j) const {
+            size_t r = rows_.source(i);
+            size_t c = cols_.source(j);
+            return nested_ ? nested_[r][c] : data_[r * stride_ + c];
+        }
+
+        // Start of row i when the viewed columns of a row are adjacent in memory, nullptr otherwise
+        T* row_data(size_t i) const {
+            if (cols_.step != 1 || cols_.skip_count != 0)
+                return nullptr;
+            size_t r = rows_.source(i);
+            return nested_ ? nested_[r].data() + cols_.offset : data_ + r * stride_ + cols_.offset;
+        }
+
+        // The whole view is rows() rows of row_data, stride() elements apart, as gemm takes them
+        bool contiguous() const {
+            return !nested_ && cols_.step == 1 && cols_.skip_count == 0 && rows_.skip_count == 0;
+        }
+        size_t stride() const { return stride_ * rows_.step; }
+
+        // count_rows x count_cols window starting at (first_row, first_col), taking every
+        // row_step-th row and col_step-th column
+        BasicMatrixView submatrix(size_t first_row, size_t first_col, size_t count_rows, size_t count_cols,
+                                  size_t row_step = 1, size_t col_step = 1) const {
+            BasicMatrixView result = *this;
+            result.rows_ = rows_.slice(first_row, count_rows, row_step);
+            result.cols_ = cols_.slice(first_col, count_cols, col_step);
+            return result;
+        }
+
+        // The view without one row and one column
+        BasicMatrixView minor(size_t row, size_t col) const {
+            if (row >= rows() || col >= cols())
+                throw std::out_of_range("row or col index out of range");
+            BasicMatrixView result = *this;
+            result.rows_ = rows_.without(row);
+            result.cols_ = cols_.without(col);
+            return result;
+        }
+
+        // Copy the viewed elements into an owning matrix
+        Matrix to_matrix() const {
+            Matrix result(rows(), Vector(cols()));
+            for (size_t i = 0; i < rows(); ++i)
+                for (size_t j = 0; j < cols(); ++j)
+                    result[i][j] = (*this)(i, j);
+            return result;
+        }
+
+    private:
+        template <typename U>
+        friend class BasicMatrixView;
+
+        // Exactly one of the two sources is set for a non-empty view
+        std::conditional_t<std::is_const<T>::value, const Vector, Vector>* nested_ = nullptr;
+        T* data_ = nullptr;
+        size_t stride_ = 0;
+        ViewAxis rows_;
+        ViewAxis cols_;
+    };
+
+    using MatrixView = BasicMatrixView<double>;
+    using ConstMatrixView = BasicMatrixView<const double>;
+
+    inline MatrixView view(Matrix& matrix) { return MatrixView(matrix); }
+    inline ConstMatrixView view(const Matrix& matrix) { return ConstMatrixView(matrix); }
+    inline MatrixView view(DenseMatrix& matrix) { return MatrixView(matrix); }
+    inline ConstMatrixView view(const DenseMatrix& matrix) { return ConstMatrixView(matrix); }
+
+    // Views are minors of their own, the Matrix version of minor copies
+    template <typename T>
+    BasicMatrixView<T> minor(const BasicMatrixView<T>& matrix, size_t row, size_t col) {
+        return matrix.minor(row, col);
+    }
+
+    // Copy the viewed elements into a contiguous matrix
+    DenseMatrix to_dense(ConstMatrixView matrix);
+
+    // Overloads of the read-only algebra API for views, same semantics and errors as the Matrix versions.
+    // Element-wise work reads through the view directly; determinant, inverse and large products
+    // make one contiguous copy, as the Matrix versions do.
+    void show(ConstMatrixView matrix);
+    Matrix multiply(ConstMatrixView matrix, double c);
+    Matrix multiply(ConstMatrixView matrix1, ConstMatrixView matrix2);
+    Matrix sum(ConstMatrixView matrix, double c);
+    Matrix sum(ConstMatrixView matrix1, ConstMatrixView matrix2);
+    Matrix transpose(ConstMatrixView matrix);
+    double determinant(ConstMatrixView matrix);
+    Matrix inverse(ConstMatrixView matrix);
+    Matrix concatenate(ConstMatrixView matrix1, ConstMatrixView matrix2, size_t axis);
+    Matrix ero_swap(ConstMatrixView matrix, size_t r1, size_t r2);
+    Matrix ero_multiply(ConstMatrixView matrix, size_t r, double c);
+    Matrix ero_sum(ConstMatrixView matrix, size_t r1, double c, size_t r2);
+    Matrix upper_triangular(ConstMatrixView matrix, Pivoting pivoting = Pivoting::first_nonzero);
+
+    // Row operations on the viewed elements of the underlying matrix
+    void ero_swap_inplace(MatrixView matrix, size_t r1, size_t r2);
+    void ero_multiply_inplace(MatrixView matrix, size_t r, double c);
+    void ero_sum_inplace(MatrixView matrix, size_t r1, double c, size_t r2);
+}
+
+#endif //AP_MATRIX_VIEW_H
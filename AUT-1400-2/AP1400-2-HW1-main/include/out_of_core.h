@@ -0,0 +1,27 @@
+#ifndef AP_OUT_OF_CORE_H
+#define AP_OUT_OF_CORE_H
+
+#include <cstddef>
+#include <string>
+
+namespace algebra {
+    // Default memory for the tiles of multiply_files, in bytes
+    constexpr size_t kOutOfCoreBudget = size_t(1) << 30;
+
+    // Side of the square tiles multiply_files uses under memory_budget bytes: two A, two B and
+    // two C tiles of doubles must fit, and the side is a multiple of 64 elements when it can be.
+    // Throws std::logic_error when not even an 8 x 8 tile fits.
+    size_t out_of_core_tile(size_t memory_budget);
+
+    // C = A * B on float64 matrix files (see matrix_file.h) that need not fit in memory.
+    // C is computed one tile at a time by the in-memory gemm; every A and B tile it needs is read
+    // by a separate I/O thread while the previous pair is multiplied, and finished C tiles are
+    // written back behind the computation, so disk and CPU work overlap. Memory stays within
+    // memory_budget plus the gemm packing buffers. The file at c_path is replaced.
+    // Throws std::logic_error for matrices that cannot be multiplied, files that are not float64,
+    // too small a budget or a c_path naming one of the operands, and std::runtime_error when a file cannot be read or written.
+    void multiply_files(const std::string& a_path, const std::string& b_path, const std::string& c_path,
+                        size_t memory_budget = kOutOfCoreBudget);
+}
+
+#endif //AP_OUT_OF_CORE_H
@@ -0,0 +1,37 @@
+#ifndef AP_RANDOM_H
+#define AP_RANDOM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace algebra {
+    // Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random Numbers: As Easy as
+    // 1, 2, 3"): ten rounds of multiplies and xors turn a 128 bit counter and a 64 bit key into
+    // 128 random bits. There is no state to advance, so any part of a stream can be produced
+    // independently of the others.
+    using PhiloxCounter = std::array<uint32_t, 4>;
+    using PhiloxKey = std::array<uint32_t, 2>;
+
+    constexpr PhiloxCounter philox4x32(PhiloxCounter counter, PhiloxKey key) {
+        for (int round = 0; round < 10; ++round) {
+            uint64_t product0 = uint64_t(0xD2511F53) * counter[0];
+            uint64_t product1 = uint64_t(0xCD9E8D57) * counter[2];
+            counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0], static_cast<uint32_t>(product1),
+                       static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1], static_cast<uint32_t>(product0)};
+            key = {key[0] + 0x9E3779B9, key[1] + 0xBB67AE85};
+        }
+        return counter;
+    }
+
+    // Element i of the stream of seed is uniform in [min, max); dst[j] gets element first + j.
+    // Every counter gives two doubles or four floats, so the result only depends on seed and on
+    // the positions, never on how a fill is split or on the vector tier that runs it.
+    void uniform_fill(double* dst, size_t count, uint64_t first, double min, double max, uint64_t seed);
+    void uniform_fill(float* dst, size_t count, uint64_t first, float min, float max, uint64_t seed);
+
+    // A different seed on every call, derived from a single std::random_device read per process
+    uint64_t fresh_seed();
+}
+
+#endif //AP_RANDOM_H
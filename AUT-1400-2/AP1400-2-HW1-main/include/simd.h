@@ -0,0 +1,100 @@
+#ifndef AP_SIMD_H
+#define AP_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Set when the compiler can build x86 vector code through per-function target attributes
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ALGEBRA_X86_DISPATCH 1
+#else
+#define ALGEBRA_X86_DISPATCH 0
+#endif
+
+// Bodies passed to dispatch() must be inlined into its per-tier instantiations to be compiled for
+// that tier, so they and the kernels they call are marked with it
+#if defined(__GNUC__) || defined(__clang__)
+#define ALGEBRA_ALWAYS_INLINE __attribute__((always_inline))
+#else
+#define ALGEBRA_ALWAYS_INLINE
+#endif
+
+namespace algebra {
+    // Instruction set tiers the kernels are written for, in increasing order
+    enum class Isa { scalar, sse2, avx2, avx512 };
+
+    // Best tier this CPU supports, found once through CPUID
+    Isa detected_isa();
+    // Tier the kernels currently run on. It is the detected tier unless the ALGEBRA_ISA
+    // environment variable (scalar, sse2, avx2 or avx512) or force_isa says otherwise.
+    Isa active_isa();
+    // Run every kernel on the given tier, mainly to benchmark the tiers against each other.
+    // Throws std::logic_error when the CPU does not support it.
+    void force_isa(Isa isa);
+    const char* isa_name(Isa isa);
+
+    // Table of the kernels of one tier, used by the algebra functions
+    struct Kernels {
+        Isa isa;
+        // dst[i] = src[i] * c
+        void (*scale)(const double* src, double c, double* dst, size_t n);
+        // dst[i] += c * src[i]
+        void (*axpy)(double c, const double* src, double* dst, size_t n);
+        // Register block of the GEMM micro-kernel (4x4 scalar and SSE2, 6x8 AVX2, 8x16 AVX-512)
+        size_t gemm_mr;
+        size_t gemm_nr;
+        // C[0:mr, 0:nr] += A * B for a packed mr x kc micro-panel of A and kc x nr micro-panel of B
+        void (*gemm_kernel)(size_t kc, const double* a, const double* b, double* c, size_t ldc);
+
+        // Single precision counterparts, a register holds twice as many floats as doubles
+        void (*scale_f32)(const float* src, float c, float* dst, size_t n);
+        void (*axpy_f32)(float c, const float* src, float* dst, size_t n);
+        // 4x8 scalar and SSE2, 6x16 AVX2, 8x32 AVX-512
+        size_t sgemm_mr;
+        size_t sgemm_nr;
+        void (*sgemm_kernel)(size_t kc, const float* a, const float* b, float* c, size_t ldc);
+
+        // Philox4x32-10 of the kPhiloxBatch counters {first + l, 0, 0} (see random.h) under key:
+        // word w of counter l goes to words[w * kPhiloxBatch + l]
+        void (*philox)(uint64_t first, uint64_t key, uint32_t* words);
+
+        // Side of the square tile transposed in registers (4 scalar, SSE2 and AVX2, 8 AVX-512)
+        size_t transpose_tile;
+        // B = A^T for one tile, rows lda and ldb elements apart. The whole tile is read before
+        // any of it is written, so a == b transposes a tile in place.
+        void (*transpose_kernel)(const double* a, size_t lda, double* b, size_t ldb);
+    };
+
+    // Counters per call of Kernels::philox
+    constexpr size_t kPhiloxBatch = 16;
+
+    // Kernels of the active tier
+    const Kernels& kernels();
+
+#if ALGEBRA_X86_DISPATCH
+    template <typename Body>
+    __attribute__((target("avx2,fma")))
+    void run_avx2(const Body& body) { body(); }
+
+    template <typename Body>
+    __attribute__((target("avx512f")))
+    void run_avx512(const Body& body) { body(); }
+#endif
+
+    // Run body compiled for the active tier: an ALGEBRA_ALWAYS_INLINE body is inlined into the
+    // instantiation with the matching target attribute, so the compiler vectorizes its loops
+    // with the widest registers available
+    template <typename Body>
+    void dispatch(const Body& body) {
+#if ALGEBRA_X86_DISPATCH
+        Isa isa = active_isa();
+        if (isa == Isa::avx512)
+            return run_avx512(body);
+        if (isa == Isa::avx2)
+            return run_avx2(body);
+#endif
+        body();
+    }
+}
+
+#endif //AP_SIMD_H
@@ -0,0 +1,50 @@
+#ifndef AP_SOLVE_H
+#define AP_SOLVE_H
+
+#include <cstddef>
+#include <utility>
+#include "hw1.h"
+#include "dense_matrix.h"
+#include "lu.h"
+
+namespace algebra {
+    // LU factorization with partial pivoting of a square matrix, computed once and reused for
+    // any number of right-hand sides: every solve is O(n^2) per column instead of O(n^3).
+    // Throws std::logic_error for a non-square matrix.
+    class Factorization {
+    public:
+        explicit Factorization(DenseMatrix matrix);
+        explicit Factorization(const Matrix& matrix);
+        // From a factorization computed otherwise, e.g. lu_factor_banded
+        explicit Factorization(LuDecomposition lu) : lu_(std::move(lu)) {}
+
+        size_t size() const { return lu_.lu.rows(); }
+        // A zero pivot was found: the matrix has no inverse and solve throws
+        bool singular() const { return lu_.singular; }
+        const LuDecomposition& lu() const { return lu_; }
+
+        double determinant() const;
+        DenseMatrix inverse() const;
+
+        // X with A * X = B, by one blocked forward and one blocked back substitution.
+        // Throws std::logic_error when the matrix is singular or B does not have size() rows.
+        DenseMatrix solve(DenseMatrix b) const;
+        Matrix solve(const Matrix& b) const;
+        Vector solve(const Vector& b) const;
+
+    private:
+        // Solve in place for nrhs columns of b, rows ldb elements apart
+        void solve_in_place(double* b, size_t nrhs, size_t ldb) const;
+
+        LuDecomposition lu_;
+    };
+
+    // X with A * X = B for a square A, factoring A once for all the columns of B.
+    // Use a Factorization to solve with the same A again. Throws std::logic_error for a
+    // non-square or singular A and when B does not have as many rows as A.
+    DenseMatrix solve(const DenseMatrix& a, DenseMatrix b);
+    Matrix solve(const Matrix& a, const Matrix& b);
+    Vector solve(const Matrix& a, const Vector& b);
+}
+
+#endif //AP_SOLVE_H
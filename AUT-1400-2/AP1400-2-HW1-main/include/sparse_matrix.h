@@ -0,0 +1,85 @@
+#ifndef AP_SPARSE_MATRIX_H
+#define AP_SPARSE_MATRIX_H
+
+#include <cstddef>
+#include <vector>
+#include "hw1.h"
+
+namespace algebra {
+    // Compressed sparse row (csr) or compressed sparse column (csc) storage
+    enum class SparseFormat { csr, csc };
+
+    // One nonzero given by position, for building sparse matrices
+    struct Triplet {
+        size_t row;
+        size_t col;
+        double value;
+    };
+
+    // Sparse matrix that only stores its nonzeros, so memory and time scale with nnz().
+    // In csr the compressed axis is the rows: the nonzeros of row i are
+    // values()[offsets()[i] .. offsets()[i + 1]) at columns indices()[...]. In csc the roles of
+    // rows and columns are exchanged. Indices are sorted and unique inside every row (column).
+    class SparseMatrix {
+    public:
+        SparseMatrix() = default;
+        // rows x cols matrix without any nonzero
+        SparseMatrix(size_t rows, size_t cols, SparseFormat format = SparseFormat::csr);
+        // Compress a nested-vector matrix, exact zeros are dropped
+        explicit SparseMatrix(const Matrix& matrix, SparseFormat format = SparseFormat::csr);
+        // Build from nonzeros in any order, values at the same position are added up.
+        // Throws std::out_of_range when a triplet lies outside rows x cols.
+        static SparseMatrix from_triplets(size_t rows, size_t cols, const std::vector<Triplet>& triplets,
+                                          SparseFormat format = SparseFormat::csr);
+
+        // Expand into the nested-vector layout
+        Matrix to_matrix() const;
+        // The same matrix in the other layout, in O(nnz + rows + cols)
+        SparseMatrix convert(SparseFormat format) const;
+
+        size_t rows() const { return rows_; }
+        size_t cols() const { return cols_; }
+        size_t nnz() const { return values_.size(); }
+        SparseFormat format() const { return format_; }
+
+        const std::vector<size_t>& offsets() const { return offsets_; }
+        const std::vector<size_t>& indices() const { return indices_; }
+        const std::vector<double>& values() const { return values_; }
+
+        // Element (i, j), zero when it is not stored. Binary search inside the row (column).
+        double operator()(size_t i, size_t j) const;
+
+    private:
+        friend SparseMatrix transpose(const SparseMatrix& matrix);
+        friend SparseMatrix multiply(const SparseMatrix& matrix, double c);
+        friend SparseMatrix multiply(const SparseMatrix& matrix1, const SparseMatrix& matrix2);
+        friend SparseMatrix sum(const SparseMatrix& matrix1, const SparseMatrix& matrix2);
+
+        size_t rows_{};
+        size_t cols_{};
+        SparseFormat format_{SparseFormat::csr};
+        // Length of the compressed axis + 1, starts at 0 and ends at nnz()
+        std::vector<size_t> offsets_{0};
+        std::vector<size_t> indices_;
+        std::vector<double> values_;
+    };
+
+    bool operator==(const SparseMatrix& matrix1, const SparseMatrix& matrix2);
+    bool operator!=(const SparseMatrix& matrix1, const SparseMatrix& matrix2);
+
+    // Sparse times vector. csr splits the rows across threads; csc scatters column by column.
+    Vector multiply(const SparseMatrix& matrix, const Vector& vector);
+    // Sparse times dense, every row of the result is a sum of scaled rows of the dense operand
+    Matrix multiply(const SparseMatrix& matrix1, const Matrix& matrix2);
+    // Sparse times sparse (Gustavson): one pass counts the nonzeros of every result row, a
+    // second one fills them, rows split across threads. The result is csr.
+    SparseMatrix multiply(const SparseMatrix& matrix1, const SparseMatrix& matrix2);
+    SparseMatrix multiply(const SparseMatrix& matrix, double c);
+    // Merge of the nonzeros, the result has the format of matrix1
+    SparseMatrix sum(const SparseMatrix& matrix1, const SparseMatrix& matrix2);
+    // The arrays stay as they are and the format flips: the csr arrays of A are the csc arrays of A^T.
+    // Use convert() on the result when a given format is needed.
+    SparseMatrix transpose(const SparseMatrix& matrix);
+}
+
+#endif //AP_SPARSE_MATRIX_H
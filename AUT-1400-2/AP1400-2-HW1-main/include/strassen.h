@@ -0,0 +1,41 @@
+#ifndef AP_STRASSEN_H
+#define AP_STRASSEN_H
+
+#include <cstddef>
+#include "dense_matrix.h"
+
+namespace algebra {
+    // Default for the cutoff below which recursion stops and the blocked gemm takes over
+    constexpr size_t kStrassenCutoff = 1024;
+    // multiply() switches to strassen when every dimension reaches this
+    constexpr size_t kStrassenThreshold = 2048;
+
+    // C = A * B by the Strassen-Winograd recursion: seven half-size products and fifteen
+    // additions per level instead of eight products, so about n^2.81 multiply-adds for large n.
+    // Every level halves all three dimensions until one of them is below cutoff.
+    // Odd dimensions are peeled: the even part recurses and the last row, column or rank-one
+    // term is added by gemm. Unlike gemm, C is overwritten.
+    // All scratch space is allocated once per call. With two to seven threads the seven products
+    // of the top level run as parallel tasks, one per thread; otherwise they run one after the
+    // other and every gemm uses the whole pool. Both ways give bit-identical results.
+    // The error is bounded by a few times n^log2(12) eps |A| |B| instead of n eps |A| |B|.
+    void strassen(size_t m, size_t n, size_t k,
+                  const double* a, size_t lda,
+                  const double* b, size_t ldb,
+                  double* c, size_t ldc, size_t cutoff = kStrassenCutoff);
+    void strassen(size_t m, size_t n, size_t k,
+                  const float* a, size_t lda,
+                  const float* b, size_t ldb,
+                  float* c, size_t ldc, size_t cutoff = kStrassenCutoff);
+
+    // Elements of scratch space strassen needs for these sizes, with or without parallel tasks
+    size_t strassen_workspace(size_t m, size_t n, size_t k, bool tasks, size_t cutoff = kStrassenCutoff);
+
+    // Strassen-Winograd product of dense matrices, whatever their size.
+    // Throws std::logic_error when the dimensions do not match.
+    template <typename T>
+    BasicDenseMatrix<T> multiply_strassen(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2,
+                                          size_t cutoff = kStrassenCutoff);
+}
+
+#endif //AP_STRASSEN_H
@@ -0,0 +1,51 @@
+#ifndef AP_STRUCTURE_H
+#define AP_STRUCTURE_H
+
+#include <cstddef>
+#include "hw1.h"
+#include "dense_matrix.h"
+
+namespace algebra {
+    // Band matrices whose band covers at most 1/kBandedRatio of the columns are factored by
+    // the banded LU
+    constexpr size_t kBandedRatio = 16;
+    // Symmetric indefinite matrices from this size on go to the blocked LU, faster than the
+    // unblocked LDL^T
+    constexpr size_t kLdltThreshold = 128;
+
+    // What a single pass over a square matrix found out about it, for picking the cheapest
+    // factorization
+    struct Structure {
+        size_t size = 0;
+        bool symmetric = true;
+        // How far the farthest non-zero element lies below (above) the diagonal
+        size_t lower_bandwidth = 0;
+        size_t upper_bandwidth = 0;
+
+        bool diagonal() const { return lower_bandwidth == 0 && upper_bandwidth == 0; }
+        bool lower_triangular() const { return upper_bandwidth == 0; }
+        bool upper_triangular() const { return lower_bandwidth == 0; }
+        bool banded() const { return (lower_bandwidth + upper_bandwidth + 1) * kBandedRatio <= size; }
+    };
+
+    // O(n^2) reads at most, usually far fewer: each row is scanned from both ends only up to its
+    // first non-zero, and the symmetry check stops at the first mismatch.
+    // Throws std::logic_error for non-square matrices.
+    Structure probe(const DenseMatrix& matrix);
+    Structure probe(const Matrix& matrix);
+
+    // Same results and errors as the versions without a structure, taking the fastest path the
+    // structure allows: the diagonal alone for diagonal matrices, one triangular solve for
+    // triangular ones, the banded LU for band matrices, Cholesky for symmetric ones (then LDL^T,
+    // or LU from kLdltThreshold on, when it finds a non-positive pivot) and the dense LU otherwise.
+    // The structure is trusted, pass the one probe gave for the same matrix. One of another size
+    // throws std::logic_error.
+    double determinant(const DenseMatrix& matrix, const Structure& structure);
+    double determinant(const Matrix& matrix, const Structure& structure);
+    DenseMatrix inverse(const DenseMatrix& matrix, const Structure& structure);
+    Matrix inverse(const Matrix& matrix, const Structure& structure);
+    DenseMatrix solve(const DenseMatrix& a, DenseMatrix b, const Structure& structure);
+    Matrix solve(const Matrix& a, const Matrix& b, const Structure& structure);
+}
+
+#endif //AP_STRUCTURE_H
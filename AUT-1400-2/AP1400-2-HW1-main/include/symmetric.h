@@ -0,0 +1,62 @@
+#ifndef AP_SYMMETRIC_H
+#define AP_SYMMETRIC_H
+
+#include <cstddef>
+#include <vector>
+#include "hw1.h"
+#include "dense_matrix.h"
+
+namespace algebra {
+    // Matrices from this size on are factored by Cholesky block by block
+    constexpr size_t kCholeskyBlockThreshold = 128;
+    // Width of the panels of the blocked Cholesky factorization
+    constexpr size_t kCholeskyBlockSize = 64;
+
+    // Factorizations of symmetric matrices. Only the lower triangle of the input is read, and
+    // half the flops of LU are spent (n^3 / 3).
+
+    // A = L * L^T for a symmetric positive definite A
+    struct CholeskyDecomposition {
+        // Lower triangular, zero above the diagonal
+        DenseMatrix l;
+        // Cleared when a diagonal element was not positive: A is not positive definite and l is
+        // only partly computed
+        bool positive_definite = true;
+    };
+
+    // Small matrices row by row; from kCholeskyBlockThreshold on, each diagonal block of
+    // kCholeskyBlockSize is factored, the panel below it solved, and the lower triangle of the
+    // trailing matrix updated by one gemm per block row.
+    // Stops at the first non-positive diagonal element. Throws std::logic_error for non-square matrices.
+    CholeskyDecomposition cholesky_factor(DenseMatrix matrix);
+
+    // P * A * P^T = L * D * L^T for any symmetric A, by diagonal pivoting (Bunch-Kaufman): D is
+    // block diagonal with 1x1 and 2x2 blocks, chosen so the elements of L stay bounded
+    struct LdltDecomposition {
+        // Unit lower triangular, its diagonal is stored as ones
+        DenseMatrix l;
+        // The diagonal of D, and for a 2x2 block at (k, k + 1) its off-diagonal element at k
+        // (zero everywhere else)
+        Vector diagonal;
+        Vector off_diagonal;
+        // Row i of P * A is row permutation[i] of A
+        std::vector<size_t> permutation;
+        // A 1x1 block of D is zero, A has no inverse
+        bool singular = false;
+    };
+
+    // Unblocked. Throws std::logic_error for non-square matrices.
+    LdltDecomposition ldlt_factor(DenseMatrix matrix);
+
+    // Same results and errors as the LU versions (lu.h, solve.h): inverse and solve throw
+    // std::logic_error for a matrix that is not positive definite (Cholesky) or singular (LDL^T),
+    // and solve when B does not have as many rows as A
+    double determinant(const CholeskyDecomposition& cholesky);
+    DenseMatrix inverse(const CholeskyDecomposition& cholesky);
+    DenseMatrix solve(const CholeskyDecomposition& cholesky, DenseMatrix b);
+    double determinant(const LdltDecomposition& ldlt);
+    DenseMatrix inverse(const LdltDecomposition& ldlt);
+    DenseMatrix solve(const LdltDecomposition& ldlt, DenseMatrix b);
+}
+
+#endif //AP_SYMMETRIC_H
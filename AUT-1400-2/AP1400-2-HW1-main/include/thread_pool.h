@@ -0,0 +1,78 @@
+#ifndef AP_THREAD_POOL_H
+#define AP_THREAD_POOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace algebra {
+    // condition.wait(lock, predicate) made of timed waits: the untimed wait got a new symbol
+    // version in GCC 12's libstdc++, and a binary using it fails to load next to an older runtime
+    // (such as the one GTest is often installed with). A timed wait has no such symbol.
+    template <typename Predicate>
+    void wait_for_condition(std::condition_variable& condition, std::unique_lock<std::mutex>& lock, Predicate predicate) {
+        while (!condition.wait_for(lock, std::chrono::milliseconds(100), predicate)) {
+        }
+    }
+
+    // Work below this many element operations runs on the calling thread
+    constexpr size_t kParallelThreshold = 1 << 16;
+
+    // Persistent set of worker threads that run one parallel loop at a time.
+    // A loop is cut into one contiguous chunk per thread; the chunk boundaries only depend
+    // on the range and the thread count, so results are reproducible for a given count.
+    class ThreadPool {
+    public:
+        // threads counts the calling thread, so threads - 1 workers are started
+        explicit ThreadPool(size_t threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t size() const { return workers_.size() + 1; }
+
+        // Call body(chunk_begin, chunk_end) for every chunk of [begin, end) and wait for all of them.
+        // The first exception thrown by a chunk is rethrown here.
+        void run(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body);
+
+    private:
+        void worker_loop();
+        void run_chunks();
+
+        std::vector<std::thread> workers_;
+        // Serializes loops coming from different threads
+        std::mutex run_mutex_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        // State of the loop in flight, guarded by mutex_
+        const std::function<void(size_t, size_t)>* body_{};
+        size_t begin_{};
+        size_t end_{};
+        size_t next_chunk_{};
+        size_t pending_chunks_{};
+        size_t generation_{};
+        bool stop_{};
+        std::exception_ptr error_;
+    };
+
+    // Number of threads of the process-wide pool. It starts from the ALGEBRA_NUM_THREADS
+    // environment variable, or the hardware concurrency when that is not set.
+    size_t num_threads();
+    // Resize the process-wide pool, 0 means the hardware concurrency
+    void set_num_threads(size_t threads);
+
+    // Run body over [begin, end) on the process-wide pool when (end - begin) * work_per_item
+    // reaches kParallelThreshold, otherwise call body(begin, end) on the calling thread.
+    // Loops started from inside a chunk also run on the calling thread.
+    void parallel_for(size_t begin, size_t end, size_t work_per_item,
+                      const std::function<void(size_t, size_t)>& body);
+}
+
+#endif //AP_THREAD_POOL_H
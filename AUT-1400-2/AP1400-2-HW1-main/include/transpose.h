@@ -0,0 +1,23 @@
+#ifndef AP_TRANSPOSE_H
+#define AP_TRANSPOSE_H
+
+#include <cstddef>
+
+namespace algebra {
+    // Side of the blocks the transposes walk: a block of the source and of the destination fit
+    // in L1 together, so every cache line is read and written whole
+    constexpr size_t kTransposeBlock = 32;
+
+    // B = A^T on row-major operands: A is m x n with row stride lda, B is n x m with row stride
+    // ldb. Blocks are cut into the register tiles of the active tier (Kernels::transpose_kernel)
+    // and the blocks of output rows are split across threads.
+    void transpose(size_t m, size_t n, const double* a, size_t lda, double* b, size_t ldb);
+    void transpose(size_t m, size_t n, const float* a, size_t lda, float* b, size_t ldb);
+
+    // A = A^T for an n x n A with row stride lda, without a second buffer: the tiles on either
+    // side of the diagonal are transposed and exchanged through registers
+    void transpose_inplace(size_t n, double* a, size_t lda);
+    void transpose_inplace(size_t n, float* a, size_t lda);
+}
+
+#endif //AP_TRANSPOSE_H
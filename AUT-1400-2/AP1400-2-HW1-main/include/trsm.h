@@ -0,0 +1,27 @@
+#ifndef AP_TRSM_H
+#define AP_TRSM_H
+
+#include <cstddef>
+
+namespace algebra {
+    // Rows of the diagonal blocks of the blocked triangular solves
+    constexpr size_t kTrsmBlock = 64;
+    // Right-hand sides from which the updates below a diagonal block go through gemm;
+    // narrower ones are updated row by row
+    constexpr size_t kTrsmGemmColumns = 8;
+
+    // Triangular solves with many right-hand sides, in place on row-major operands.
+    // The triangle is n x n with row stride ldt, only its lower (upper) part is read, and
+    // B is n x nrhs with row stride ldb. With unit_diagonal the diagonal is taken as ones.
+    // Blocked: each kTrsmBlock diagonal block is solved by substitution with the columns of B
+    // split across threads, and its effect on the rest of B is one gemm.
+
+    // B = L^-1 * B, by forward substitution
+    void trsm_lower(size_t n, size_t nrhs, const double* l, size_t ldt, double* b, size_t ldb,
+                    bool unit_diagonal = false);
+    // B = U^-1 * B, by back substitution
+    void trsm_upper(size_t n, size_t nrhs, const double* u, size_t ldt, double* b, size_t ldb,
+                    bool unit_diagonal = false);
+}
+
+#endif //AP_TRSM_H
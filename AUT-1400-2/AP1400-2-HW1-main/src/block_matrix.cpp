@@ -0,0 +1,199 @@
+#include "block_matrix.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include "gemm.h"
+#include "thread_pool.h"
+#include "transpose.h"
+
+namespace algebra {
+    // A leaf when first is not set. Either child of an inner node may be missing for an
+    // empty operand of the concatenation.
+    struct BlockMatrix::Node {
+        size_t rows;
+        size_t cols;
+        ConstMatrixView leaf;
+        std::shared_ptr<const Node> first;
+        std::shared_ptr<const Node> second;
+        size_t axis;
+    };
+
+    namespace {
+        // Operand of a gemm: a contiguous block, or a contiguous copy of it
+        struct Panel {
+            size_t row;
+            size_t col;
+            size_t rows;
+            size_t cols;
+            const double* data;
+            size_t ld;
+        };
+
+        std::vector<Panel> panels(const std::vector<BlockMatrix::Block>& blocks, std::vector<DenseMatrix>& copies) {
+            std::vector<Panel> result;
+            result.reserve(blocks.size());
+            for (const BlockMatrix::Block& block : blocks) {
+                ConstMatrixView v = block.view;
+                if (v.contiguous()) {
+                    result.push_back({block.row, block.col, v.rows(), v.cols(), v.row_data(0), v.stride()});
+                    continue;
+                }
+                copies.push_back(to_dense(v));
+                const DenseMatrix& copy = copies.back();
+                result.push_back({block.row, block.col, v.rows(), v.cols(), copy.data(), copy.stride()});
+            }
+            return result;
+        }
+
+        // Copy every block to its place, row i of the whole matrix starts at out(i)
+        template <typename Out>
+        void materialize(const std::vector<BlockMatrix::Block>& blocks, Out out) {
+            for (const BlockMatrix::Block& block : blocks) {
+                ConstMatrixView v = block.view;
+                parallel_for(0, v.rows(), v.cols(), [&](size_t lo, size_t hi) {
+                    for (size_t i = lo; i < hi; ++i) {
+                        double* dst = out(block.row + i) + block.col;
+                        if (const double* src = v.row_data(i))
+                            std::copy(src, src + v.cols(), dst);
+                        else
+                            for (size_t j = 0; j < v.cols(); ++j)
+                                dst[j] = v(i, j);
+                    }
+                });
+            }
+        }
+    }
+
+    BlockMatrix::BlockMatrix(ConstMatrixView matrix)
+        : root_(std::make_shared<const Node>(Node{matrix.rows(), matrix.cols(), matrix, nullptr, nullptr, 0})) {}
+
+    size_t BlockMatrix::rows() const {
+        return root_ ? root_->rows : 0;
+    }
+
+    size_t BlockMatrix::cols() const {
+        return root_ ? root_->cols : 0;
+    }
+
+    double BlockMatrix::operator()(size_t i, size_t j) const {
+        if (i >= rows() || j >= cols())
+            throw std::out_of_range("row or col index out of range");
+        const Node* node = root_.get();
+        while (node->first || node->second) {
+            // The index is inside the first child or shifted past it into the second
+            const Node* first = node->first.get();
+            size_t& index = node->axis == 0 ? i : j;
+            size_t extent = !first ? 0 : node->axis == 0 ? first->rows : first->cols;
+            if (index < extent) {
+                node = first;
+            } else {
+                index -= extent;
+                node = node->second.get();
+            }
+        }
+        return node->leaf(i, j);
+    }
+
+    std::vector<BlockMatrix::Block> BlockMatrix::blocks() const {
+        std::vector<Block> result;
+        // Depth first, the second child is pushed first so the first one comes out first
+        std::vector<std::pair<const Node*, std::pair<size_t, size_t>>> stack;
+        if (root_)
+            stack.push_back({root_.get(), {0, 0}});
+        while (!stack.empty()) {
+            auto [node, at] = stack.back();
+            stack.pop_back();
+            if (!node->first && !node->second) {
+                if (!node->leaf.empty())
+                    result.push_back({at.first, at.second, node->leaf});
+                continue;
+            }
+            size_t extent = !node->first ? 0 : node->axis == 0 ? node->first->rows : node->first->cols;
+            if (node->second)
+                stack.push_back({node->second.get(), node->axis == 0 ? std::make_pair(at.first + extent, at.second)
+                                                                      : std::make_pair(at.first, at.second + extent)});
+            if (node->first)
+                stack.push_back({node->first.get(), at});
+        }
+        return result;
+    }
+
+    Matrix BlockMatrix::to_matrix() const {
+        if (rows() == 0)
+            return Matrix();
+        Matrix result(rows(), Vector(cols()));
+        materialize(blocks(), [&](size_t i) { return result[i].data(); });
+        return result;
+    }
+
+    DenseMatrix BlockMatrix::to_dense() const {
+        DenseMatrix result(rows(), cols());
+        materialize(blocks(), [&](size_t i) { return result.row(i); });
+        return result;
+    }
+
+    BlockMatrix concatenate(const BlockMatrix& matrix1, const BlockMatrix& matrix2, size_t axis) {
+        size_t rows1 = matrix1.rows();
+        size_t cols1 = matrix1.cols();
+        size_t rows2 = matrix2.rows();
+        size_t cols2 = matrix2.cols();
+        if (rows1 == 0 && rows2 == 0)
+            return BlockMatrix();
+        if (axis == 0 && cols1 != cols2)
+            throw std::logic_error("matrices with different number of columns cannot be concatenated along axis 0");
+        if (axis == 1 && rows1 != rows2)
+            throw std::logic_error("matrices with different number of rows cannot be concatenated along axis 1");
+        if (axis > 1)
+            return BlockMatrix();
+        using Node = BlockMatrix::Node;
+        size_t rows = axis == 0 ? rows1 + rows2 : rows1;
+        size_t cols = axis == 0 ? cols1 : cols1 + cols2;
+        return BlockMatrix(std::make_shared<const Node>(
+            Node{rows, cols, ConstMatrixView(), matrix1.root_, matrix2.root_, axis}));
+    }
+
+    DenseMatrix multiply(const BlockMatrix& matrix1, const BlockMatrix& matrix2) {
+        if (matrix1.cols() != matrix2.rows())
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        DenseMatrix result(matrix1.rows(), matrix2.cols());
+        std::vector<DenseMatrix> copies;
+        std::vector<Panel> a = panels(matrix1.blocks(), copies);
+        std::vector<Panel> b = panels(matrix2.blocks(), copies);
+        // C[a rows, b cols] += A block * B block over the inner indices the two blocks share
+        for (const Panel& pa : a)
+            for (const Panel& pb : b) {
+                size_t lo = std::max(pa.col, pb.row);
+                size_t hi = std::min(pa.col + pa.cols, pb.row + pb.rows);
+                if (lo >= hi)
+                    continue;
+                gemm(pa.rows, pb.cols, hi - lo, pa.data + (lo - pa.col), pa.ld, pb.data + (lo - pb.row) * pb.ld,
+                     pb.ld, result.row(pa.row) + pb.col, result.stride());
+            }
+        return result;
+    }
+
+    DenseMatrix transpose(const BlockMatrix& matrix) {
+        DenseMatrix result(matrix.cols(), matrix.rows());
+        for (const BlockMatrix::Block& block : matrix.blocks()) {
+            ConstMatrixView v = block.view;
+            if (v.contiguous()) {
+                transpose(v.rows(), v.cols(), v.row_data(0), v.stride(), result.row(block.col) + block.row,
+                          result.stride());
+                continue;
+            }
+            // Every thread owns a range of output rows, i.e. of columns of the block
+            parallel_for(0, v.cols(), v.rows(), [&](size_t lo, size_t hi) {
+                for (size_t i = 0; i < v.rows(); ++i) {
+                    size_t column = block.row + i;
+                    if (const double* src = v.row_data(i))
+                        for (size_t j = lo; j < hi; ++j)
+                            result(block.col + j, column) = src[j];
+                    else
+                        for (size_t j = lo; j < hi; ++j)
+                            result(block.col + j, column) = v(i, j);
+                }
+            });
+        }
+        return result;
+    }
+}
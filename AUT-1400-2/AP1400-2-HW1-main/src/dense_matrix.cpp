@@ -0,0 +1,388 @@
+#include "dense_matrix.h"
+
+#include <algorithm>
+#include "expression.h"
+#include "format.h"
+#include "gemm.h"
+#include "lu.h"
+#include "random.h"
+#include "simd.h"
+#include "strassen.h"
+#include "thread_pool.h"
+#include "transpose.h"
+
+namespace algebra {
+    namespace {
+        // cols rounded up to a whole alignment block of T
+        template <typename T>
+        size_t padded_stride(size_t cols) {
+            constexpr size_t block = BasicDenseMatrix<T>::alignment / sizeof(T);
+            return (cols + block - 1) / block * block;
+        }
+
+        // Row kernels of the active tier for either element type
+        void scale_row(const double* src, double c, double* dst, size_t n) {
+            kernels().scale(src, c, dst, n);
+        }
+
+        void scale_row(const float* src, float c, float* dst, size_t n) {
+            kernels().scale_f32(src, c, dst, n);
+        }
+
+        void axpy_row(double c, const double* src, double* dst, size_t n) {
+            kernels().axpy(c, src, dst, n);
+        }
+
+        void axpy_row(float c, const float* src, float* dst, size_t n) {
+            kernels().axpy_f32(c, src, dst, n);
+        }
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T>::BasicDenseMatrix(size_t rows, size_t cols, T value)
+        : rows_(rows), cols_(cols), stride_(padded_stride<T>(cols)), data_(rows * stride_, 0) {
+        // Only the logical elements get the value, the padding stays zero
+        if (value != 0)
+            for (size_t i = 0; i < rows_; ++i)
+                std::fill(row(i), row(i) + cols_, value);
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T>::BasicDenseMatrix(const BasicMatrix<T>& matrix)
+        : BasicDenseMatrix(matrix.size(), matrix.empty() ? 0 : matrix[0].size()) {
+        for (size_t i = 0; i < rows_; ++i) {
+            // A nested vector can be ragged, a dense matrix cannot
+            if (matrix[i].size() != cols_)
+                throw std::logic_error("rows of a matrix must all have the same size");
+            std::copy(matrix[i].begin(), matrix[i].end(), row(i));
+        }
+    }
+
+    template <typename T>
+    BasicMatrix<T> BasicDenseMatrix<T>::to_matrix() const {
+        BasicMatrix<T> result(rows_);
+        for (size_t i = 0; i < rows_; ++i)
+            result[i].assign(row(i), row(i) + cols_);
+        return result;
+    }
+
+    template <typename T>
+    void BasicDenseMatrix<T>::swap_rows(size_t r1, size_t r2) {
+        if (r1 != r2)
+            std::swap_ranges(row(r1), row(r1) + cols_, row(r2));
+    }
+
+    template <typename T>
+    bool operator==(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2) {
+        if (matrix1.rows() != matrix2.rows() || matrix1.cols() != matrix2.cols())
+            return false;
+        for (size_t i = 0; i < matrix1.rows(); ++i)
+            if (!std::equal(matrix1.row(i), matrix1.row(i) + matrix1.cols(), matrix2.row(i)))
+                return false;
+        return true;
+    }
+
+    template <typename T>
+    bool operator!=(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2) {
+        return !(matrix1 == matrix2);
+    }
+
+    namespace dense {
+        template <typename T>
+        BasicDenseMatrix<T> zeros(size_t n, size_t m) {
+            return BasicDenseMatrix<T>(n, m, 0);
+        }
+
+        template <typename T>
+        BasicDenseMatrix<T> ones(size_t n, size_t m) {
+            return BasicDenseMatrix<T>(n, m, 1);
+        }
+
+        template <typename T>
+        BasicDenseMatrix<T> random(size_t n, size_t m, double min, double max) {
+            return random<T>(n, m, min, max, fresh_seed());
+        }
+
+        template <typename T>
+        BasicDenseMatrix<T> random(size_t n, size_t m, double min, double max, uint64_t seed) {
+            if (min >= max)
+                throw std::logic_error("min cannot be greater than max");
+            BasicDenseMatrix<T> matrix(n, m);
+            // Same stream positions as algebra::random, so a double matrix has the same elements
+            parallel_for(0, n, m, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i)
+                    uniform_fill(matrix.row(i), m, i * m, static_cast<T>(min), static_cast<T>(max), seed);
+            });
+            return matrix;
+        }
+    }
+
+    template <typename T>
+    void show(const BasicDenseMatrix<T>& matrix) {
+        print(matrix, stream_sink(std::cout));
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> multiply(const BasicDenseMatrix<T>& matrix, Scalar<T> c) {
+        return evaluate(lazy(matrix) * c);
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> multiply(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2) {
+        size_t rows1 = matrix1.rows();
+        size_t cols1 = matrix1.cols();
+        size_t cols2 = matrix2.cols();
+        if (cols1 != matrix2.rows())
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        if (std::min({rows1, cols1, cols2}) >= kStrassenThreshold)
+            return multiply_strassen(matrix1, matrix2);
+        BasicDenseMatrix<T> result(rows1, cols2);
+        if (rows1 * cols1 * cols2 >= kGemmThreshold) {
+            gemm(rows1, cols2, cols1, matrix1.data(), matrix1.stride(),
+                 matrix2.data(), matrix2.stride(), result.data(), result.stride());
+            return result;
+        }
+        // i-k-j order: the inner loop streams one row of matrix2 into one row of the result
+        for (size_t i = 0; i < rows1; ++i) {
+            T* dst = result.row(i);
+            for (size_t k = 0; k < cols1; ++k) {
+                T a = matrix1(i, k);
+                const T* src = matrix2.row(k);
+                for (size_t j = 0; j < cols2; ++j)
+                    dst[j] += a * src[j];
+            }
+        }
+        return result;
+    }
+
+    DenseMatrix multiply_mixed(const FloatDenseMatrix& matrix1, const FloatDenseMatrix& matrix2) {
+        size_t rows1 = matrix1.rows();
+        size_t cols1 = matrix1.cols();
+        size_t cols2 = matrix2.cols();
+        if (cols1 != matrix2.rows())
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        DenseMatrix result(rows1, cols2);
+        if (rows1 * cols1 * cols2 >= kGemmThreshold) {
+            gemm(rows1, cols2, cols1, matrix1.data(), matrix1.stride(),
+                 matrix2.data(), matrix2.stride(), result.data(), result.stride());
+            return result;
+        }
+        for (size_t i = 0; i < rows1; ++i) {
+            double* dst = result.row(i);
+            for (size_t k = 0; k < cols1; ++k) {
+                double a = matrix1(i, k);
+                const float* src = matrix2.row(k);
+                for (size_t j = 0; j < cols2; ++j)
+                    dst[j] += a * src[j];
+            }
+        }
+        return result;
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> sum(const BasicDenseMatrix<T>& matrix, Scalar<T> c) {
+        return evaluate(lazy(matrix) + c);
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> sum(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2) {
+        // The expression checks the dimensions
+        return evaluate(lazy(matrix1) + lazy(matrix2));
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> transpose(const BasicDenseMatrix<T>& matrix) {
+        BasicDenseMatrix<T> result(matrix.cols(), matrix.rows());
+        // Tile by tile, in registers
+        transpose(matrix.rows(), matrix.cols(), matrix.data(), matrix.stride(), result.data(), result.stride());
+        return result;
+    }
+
+    template <typename T>
+    void transpose_inplace(BasicDenseMatrix<T>& matrix) {
+        if (matrix.rows() != matrix.cols())
+            throw std::logic_error("only square matrices can be transposed in place");
+        transpose_inplace(matrix.rows(), matrix.data(), matrix.stride());
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> minor(const BasicDenseMatrix<T>& matrix, size_t row, size_t col) {
+        if (matrix.empty())
+            return BasicDenseMatrix<T>();
+        size_t rows = matrix.rows();
+        size_t cols = matrix.cols();
+        if (row >= rows || col >= cols)
+            throw std::out_of_range("row or col index out of range");
+        BasicDenseMatrix<T> result(rows - 1, cols - 1);
+        for (size_t i = 0, r = 0; i < rows; ++i) {
+            if (i == row)
+                continue;
+            // Copy the parts of the row left and right of the skipped column
+            const T* src = matrix.row(i);
+            std::copy(src, src + col, result.row(r));
+            std::copy(src + col + 1, src + cols, result.row(r) + col);
+            ++r;
+        }
+        return result;
+    }
+
+    template <typename T>
+    T determinant(const BasicDenseMatrix<T>& matrix) {
+        if (matrix.rows() == 0)
+            return 1;
+        size_t n = matrix.rows();
+        if (n != matrix.cols())
+            throw std::logic_error("non-square matrix");
+        if (n == 1)
+            return matrix(0, 0);
+        if (n == 2)
+            return matrix(0, 0) * matrix(1, 1) - matrix(0, 1) * matrix(1, 0);
+        return static_cast<T>(determinant(lu_factor(matrix_cast<double>(matrix))));
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> inverse(const BasicDenseMatrix<T>& matrix) {
+        if (matrix.rows() == 0)
+            return BasicDenseMatrix<T>();
+        size_t n = matrix.rows();
+        if (n != matrix.cols())
+            throw std::logic_error("non-square matrix");
+        DenseMatrix result = inverse(lu_factor(matrix_cast<double>(matrix)));
+        if constexpr (std::is_same<T, double>::value)
+            return result;
+        else
+            return matrix_cast<T>(result);
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> concatenate(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2, size_t axis) {
+        size_t rows1 = matrix1.rows();
+        size_t cols1 = matrix1.cols();
+        size_t rows2 = matrix2.rows();
+        size_t cols2 = matrix2.cols();
+        if (rows1 == 0 && rows2 == 0)
+            return BasicDenseMatrix<T>();
+        if (axis == 0 && cols1 != cols2)
+            throw std::logic_error("matrices with different number of columns cannot be concatenated along axis 0");
+        if (axis == 1 && rows1 != rows2)
+            throw std::logic_error("matrices with different number of rows cannot be concatenated along axis 1");
+        if (axis > 1)
+            return BasicDenseMatrix<T>();
+        // The output is sized once, then both inputs are copied row by row
+        BasicDenseMatrix<T> result = axis == 0 ? BasicDenseMatrix<T>(rows1 + rows2, cols1)
+                                               : BasicDenseMatrix<T>(rows1, cols1 + cols2);
+        for (size_t i = 0; i < rows1; ++i)
+            std::copy(matrix1.row(i), matrix1.row(i) + cols1, result.row(i));
+        for (size_t i = 0; i < rows2; ++i) {
+            T* dst = axis == 0 ? result.row(rows1 + i) : result.row(i) + cols1;
+            std::copy(matrix2.row(i), matrix2.row(i) + cols2, dst);
+        }
+        return result;
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> ero_swap(const BasicDenseMatrix<T>& matrix, size_t r1, size_t r2) {
+        BasicDenseMatrix<T> result = matrix;
+        ero_swap_inplace(result, r1, r2);
+        return result;
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> ero_multiply(const BasicDenseMatrix<T>& matrix, size_t r, Scalar<T> c) {
+        BasicDenseMatrix<T> result = matrix;
+        ero_multiply_inplace(result, r, c);
+        return result;
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> ero_sum(const BasicDenseMatrix<T>& matrix, size_t r1, Scalar<T> c, size_t r2) {
+        BasicDenseMatrix<T> result = matrix;
+        ero_sum_inplace(result, r1, c, r2);
+        return result;
+    }
+
+    template <typename T>
+    void ero_swap_inplace(BasicDenseMatrix<T>& matrix, size_t r1, size_t r2) {
+        if (matrix.rows() == 0)
+            return;
+        if (r1 >= matrix.rows() || r2 >= matrix.rows())
+            throw std::out_of_range("r1 or r2 index out of range");
+        matrix.swap_rows(r1, r2);
+    }
+
+    template <typename T>
+    void ero_multiply_inplace(BasicDenseMatrix<T>& matrix, size_t r, Scalar<T> c) {
+        if (matrix.rows() == 0)
+            return;
+        if (r >= matrix.rows())
+            throw std::out_of_range("r index out of range");
+        scale_row(matrix.row(r), c, matrix.row(r), matrix.cols());
+    }
+
+    template <typename T>
+    void ero_sum_inplace(BasicDenseMatrix<T>& matrix, size_t r1, Scalar<T> c, size_t r2) {
+        if (matrix.rows() == 0)
+            return;
+        if (r1 >= matrix.rows() || r2 >= matrix.rows())
+            throw std::out_of_range("r1 or r2 index out of range");
+        axpy_row(c, matrix.row(r1), matrix.row(r2), matrix.cols());
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> upper_triangular(const BasicDenseMatrix<T>& matrix, Pivoting pivoting) {
+        if (matrix.rows() == 0)
+            return BasicDenseMatrix<T>();
+        if (matrix.rows() != matrix.cols())
+            throw std::logic_error("non-square matrix");
+        size_t n = matrix.rows();
+        // Blocked elimination, in double precision like determinant and inverse
+        if (n >= kLuBlockThreshold)
+            return matrix_cast<T>(upper(lu_factor(matrix_cast<double>(matrix), pivoting)));
+        // The only allocation: every row operation below works in place on this copy
+        BasicDenseMatrix<T> result = matrix;
+        for (size_t i = 0; i < n; ++i) {
+            size_t pivot = find_pivot(i, n, pivoting, [&](size_t r) { return result(r, i); });
+            if (pivot == n)
+                continue;
+            ero_swap_inplace(result, i, pivot);
+            // The rows below the pivot are independent, so they are split across threads
+            parallel_for(i + 1, n, n, [&](size_t lo, size_t hi) {
+                for (size_t j = lo; j < hi; ++j)
+                    ero_sum_inplace(result, i, -result(j, i) / result(i, i), j);
+            });
+        }
+        return result;
+    }
+
+    // Everything above is compiled for exactly these two element types
+#define ALGEBRA_INSTANTIATE_DENSE(T) \
+    template class BasicDenseMatrix<T>; \
+    template bool operator==(const BasicDenseMatrix<T>&, const BasicDenseMatrix<T>&); \
+    template bool operator!=(const BasicDenseMatrix<T>&, const BasicDenseMatrix<T>&); \
+    template BasicDenseMatrix<T> dense::zeros<T>(size_t, size_t); \
+    template BasicDenseMatrix<T> dense::ones<T>(size_t, size_t); \
+    template BasicDenseMatrix<T> dense::random<T>(size_t, size_t, double, double); \
+    template BasicDenseMatrix<T> dense::random<T>(size_t, size_t, double, double, uint64_t); \
+    template void show(const BasicDenseMatrix<T>&); \
+    template BasicDenseMatrix<T> multiply(const BasicDenseMatrix<T>&, Scalar<T>); \
+    template BasicDenseMatrix<T> multiply(const BasicDenseMatrix<T>&, const BasicDenseMatrix<T>&); \
+    template BasicDenseMatrix<T> sum(const BasicDenseMatrix<T>&, Scalar<T>); \
+    template BasicDenseMatrix<T> sum(const BasicDenseMatrix<T>&, const BasicDenseMatrix<T>&); \
+    template BasicDenseMatrix<T> transpose(const BasicDenseMatrix<T>&); \
+    template void transpose_inplace(BasicDenseMatrix<T>&); \
+    template BasicDenseMatrix<T> minor(const BasicDenseMatrix<T>&, size_t, size_t); \
+    template T determinant(const BasicDenseMatrix<T>&); \
+    template BasicDenseMatrix<T> inverse(const BasicDenseMatrix<T>&); \
+    template BasicDenseMatrix<T> concatenate(const BasicDenseMatrix<T>&, const BasicDenseMatrix<T>&, size_t); \
+    template BasicDenseMatrix<T> ero_swap(const BasicDenseMatrix<T>&, size_t, size_t); \
+    template BasicDenseMatrix<T> ero_multiply(const BasicDenseMatrix<T>&, size_t, Scalar<T>); \
+    template BasicDenseMatrix<T> ero_sum(const BasicDenseMatrix<T>&, size_t, Scalar<T>, size_t); \
+    template void ero_swap_inplace(BasicDenseMatrix<T>&, size_t, size_t); \
+    template void ero_multiply_inplace(BasicDenseMatrix<T>&, size_t, Scalar<T>); \
+    template void ero_sum_inplace(BasicDenseMatrix<T>&, size_t, Scalar<T>, size_t); \
+    template BasicDenseMatrix<T> upper_triangular(const BasicDenseMatrix<T>&, Pivoting);
+
+    ALGEBRA_INSTANTIATE_DENSE(double)
+    ALGEBRA_INSTANTIATE_DENSE(float)
+#undef ALGEBRA_INSTANTIATE_DENSE
+}
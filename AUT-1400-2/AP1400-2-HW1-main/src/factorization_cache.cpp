@@ -0,0 +1,198 @@
+#include "factorization_cache.h"
+
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace algebra {
+    namespace {
+        uint64_t mix(uint64_t z) {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // Hash of the sizes and the bits of every element. Four independent lanes keep the
+        // multiplies from waiting on each other.
+        uint64_t content_hash(const DenseMatrix& matrix) {
+            uint64_t lanes[4] = {};
+            for (size_t l = 0; l < 4; ++l)
+                lanes[l] = mix(matrix.rows() * 4 + l) ^ matrix.cols();
+            for (size_t i = 0; i < matrix.rows(); ++i) {
+                const double* row = matrix.row(i);
+                for (size_t j = 0; j < matrix.cols(); ++j) {
+                    uint64_t bits;
+                    std::memcpy(&bits, row + j, sizeof(bits));
+                    uint64_t& lane = lanes[j % 4];
+                    lane = (lane ^ bits) * 0x9E3779B97F4A7C15ull;
+                    lane ^= lane >> 32;
+                }
+            }
+            return mix(lanes[0] ^ mix(lanes[1] ^ mix(lanes[2] ^ mix(lanes[3]))));
+        }
+
+        // Bit for bit, so NaNs match themselves and 0 does not match -0, as in the hash
+        bool same_contents(const DenseMatrix& a, const DenseMatrix& b) {
+            if (a.rows() != b.rows() || a.cols() != b.cols())
+                return false;
+            for (size_t i = 0; i < a.rows(); ++i)
+                if (std::memcmp(a.row(i), b.row(i), a.cols() * sizeof(double)) != 0)
+                    return false;
+            return true;
+        }
+
+        size_t bytes_of(const DenseMatrix& matrix) {
+            return matrix.rows() * matrix.stride() * sizeof(double);
+        }
+
+        size_t bytes_of(const Matrix& matrix) {
+            return matrix.empty() ? 0 : matrix.size() * (matrix[0].size() * sizeof(double) + sizeof(Vector));
+        }
+    }
+
+    struct FactorizationCache::Entry {
+        Key key;
+        // Compared on content hits, empty for versioned entries
+        DenseMatrix matrix;
+        uint64_t version;
+        std::shared_ptr<const Factorization> factorization;
+        // Set by the first inverse asked for
+        std::shared_ptr<const Matrix> inverse;
+        size_t bytes;
+    };
+
+    FactorizationCache::FactorizationCache(size_t memory_budget) : budget_(memory_budget) {}
+
+    FactorizationCache::~FactorizationCache() = default;
+
+    std::shared_ptr<const Factorization> FactorizationCache::factorization(const Matrix& matrix) {
+        return factorization(DenseMatrix(matrix));
+    }
+
+    std::shared_ptr<const Factorization> FactorizationCache::factorization(const DenseMatrix& matrix) {
+        Key key{content_hash(matrix), false};
+        if (auto found = lookup(key, matrix, 0, nullptr))
+            return found;
+        auto computed = std::make_shared<const Factorization>(matrix);
+        insert(key, matrix, 0, computed);
+        return computed;
+    }
+
+    std::shared_ptr<const Factorization> FactorizationCache::factorization(const DenseMatrix& matrix, uint64_t id,
+                                                                           uint64_t version) {
+        Key key{id, true};
+        if (auto found = lookup(key, matrix, version, nullptr))
+            return found;
+        auto computed = std::make_shared<const Factorization>(matrix);
+        insert(key, DenseMatrix(), version, computed);
+        return computed;
+    }
+
+    double FactorizationCache::determinant(const Matrix& matrix) {
+        // The cases algebra::determinant answers without a factorization
+        if (matrix.empty() || matrix.size() != matrix[0].size() || matrix.size() <= 2)
+            return algebra::determinant(matrix);
+        return factorization(matrix)->determinant();
+    }
+
+    Matrix FactorizationCache::inverse(const Matrix& matrix) {
+        if (matrix.empty())
+            return Matrix();
+        DenseMatrix dense(matrix);
+        Key key{content_hash(dense), false};
+        std::shared_ptr<const Matrix> inverse;
+        std::shared_ptr<const Factorization> found = lookup(key, dense, 0, &inverse);
+        if (inverse)
+            return *inverse;
+        if (!found) {
+            found = std::make_shared<const Factorization>(dense);
+            insert(key, std::move(dense), 0, found);
+        }
+        inverse = std::make_shared<const Matrix>(found->inverse().to_matrix());
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Unless the entry was evicted or replaced meanwhile
+        auto it = index_.find(key);
+        if (it != index_.end() && it->second->factorization == found && !it->second->inverse) {
+            it->second->inverse = inverse;
+            it->second->bytes += bytes_of(*inverse);
+            stats_.bytes += bytes_of(*inverse);
+            evict_to_budget();
+        }
+        return *inverse;
+    }
+
+    FactorizationCache::Stats FactorizationCache::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats stats = stats_;
+        stats.entries = entries_.size();
+        return stats;
+    }
+
+    void FactorizationCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+        index_.clear();
+        stats_.bytes = 0;
+    }
+
+    FactorizationCache::Entry* FactorizationCache::find(const Key& key, const DenseMatrix& matrix, uint64_t version) {
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return nullptr;
+        Entries::iterator entry = it->second;
+        bool fresh = key.versioned ? entry->version == version : same_contents(entry->matrix, matrix);
+        if (!fresh) {
+            // Another version of the matrix, or another matrix with the same hash
+            erase(entry);
+            return nullptr;
+        }
+        entries_.splice(entries_.begin(), entries_, entry);
+        return &entries_.front();
+    }
+
+    std::shared_ptr<const Factorization> FactorizationCache::lookup(const Key& key, const DenseMatrix& matrix,
+                                                                    uint64_t version,
+                                                                    std::shared_ptr<const Matrix>* inverse) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry* entry = find(key, matrix, version);
+        if (!entry) {
+            ++stats_.misses;
+            return nullptr;
+        }
+        ++stats_.hits;
+        if (inverse)
+            *inverse = entry->inverse;
+        return entry->factorization;
+    }
+
+    void FactorizationCache::insert(const Key& key, DenseMatrix copy, uint64_t version,
+                                    std::shared_ptr<const Factorization> factorization) {
+        const LuDecomposition& lu = factorization->lu();
+        size_t bytes = sizeof(Entry) + bytes_of(copy) + bytes_of(lu.lu) + lu.pivots.size() * sizeof(size_t);
+        // An entry larger than the whole budget would only push everything else out
+        if (bytes > budget_)
+            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Another thread may have computed the same entry meanwhile
+        auto it = index_.find(key);
+        if (it != index_.end())
+            erase(it->second);
+        entries_.push_front(Entry{key, std::move(copy), version, std::move(factorization), nullptr, bytes});
+        index_[key] = entries_.begin();
+        stats_.bytes += bytes;
+        evict_to_budget();
+    }
+
+    void FactorizationCache::erase(Entries::iterator entry) {
+        stats_.bytes -= entry->bytes;
+        index_.erase(entry->key);
+        entries_.erase(entry);
+    }
+
+    void FactorizationCache::evict_to_budget() {
+        while (stats_.bytes > budget_ && !entries_.empty()) {
+            erase(std::prev(entries_.end()));
+            ++stats_.evictions;
+        }
+    }
+}
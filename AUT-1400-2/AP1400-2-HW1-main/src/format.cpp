@@ -0,0 +1,181 @@
+#include "format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+#include "thread_pool.h"
+
+namespace algebra {
+    namespace {
+        // Elements per block of rows, about 256 KB of text for numbers in [-1, 1)
+        constexpr size_t kFormatBlockElements = 1 << 15;
+        // Longest number: a sign, the 309 integer digits of the largest double, the point and three decimals
+        constexpr size_t kMaxNumberChars = 1 + 309 + 1 + 3;
+
+        // Text of one block of rows, its storage reused from block to block
+        class Text {
+        public:
+            void clear() { size_ = 0; }
+            const char* data() const { return chars_.data(); }
+            size_t size() const { return size_; }
+
+            void put(char c) {
+                reserve(1);
+                chars_[size_++] = c;
+            }
+
+            // What std::fixed << std::setprecision(3) prints: both are printf's %.3f, and a float
+            // reaches the stream as a double
+            void number(double x) {
+                reserve(kMaxNumberChars);
+                char* begin = chars_.data() + size_;
+                char* end = chars_.data() + chars_.size();
+                uint64_t bits;
+                std::memcpy(&bits, &x, sizeof(bits));
+                uint64_t exponent = bits >> 52 & 0x7FF;
+                uint64_t mantissa = bits & ((uint64_t(1) << 52) - 1);
+                // x = mantissa * 2^shift exactly, and below 2^53 thousandths fit in 64 bits
+                int shift = exponent == 0 ? -1074 : static_cast<int>(exponent) - 1075;
+                if (exponent != 0)
+                    mantissa |= uint64_t(1) << 52;
+                if (exponent == 0x7FF || shift >= 0) {
+                    size_ = std::to_chars(begin, end, x, std::chars_format::fixed, 3).ptr - chars_.data();
+                    return;
+                }
+                // Thousandths rounded half to even, as printf rounds the exact binary value
+                uint64_t thousandths = 0;
+                if (shift > -64) {
+                    uint64_t scaled = mantissa * 1000;
+                    thousandths = scaled >> -shift;
+                    uint64_t rest = scaled & ((uint64_t(1) << -shift) - 1);
+                    uint64_t half = uint64_t(1) << (-shift - 1);
+                    if (rest > half || (rest == half && (thousandths & 1)))
+                        ++thousandths;
+                }
+                if (bits >> 63)
+                    *begin++ = '-';
+                begin = std::to_chars(begin, end, thousandths / 1000).ptr;
+                unsigned decimals = static_cast<unsigned>(thousandths % 1000);
+                begin[0] = '.';
+                begin[1] = static_cast<char>('0' + decimals / 100);
+                begin[2] = static_cast<char>('0' + decimals / 10 % 10);
+                begin[3] = static_cast<char>('0' + decimals % 10);
+                size_ = begin + 4 - chars_.data();
+            }
+
+        private:
+            void reserve(size_t n) {
+                if (size_ + n > chars_.size())
+                    chars_.resize(std::max(2 * chars_.size(), size_ + n));
+            }
+
+            std::vector<char> chars_;
+            size_t size_ = 0;
+        };
+
+        template <typename T>
+        void append_row(Text& text, const T* row, size_t cols) {
+            for (size_t j = 0; j < cols; ++j) {
+                if (j != 0)
+                    text.put(' ');
+                text.number(row[j]);
+            }
+        }
+
+        // Lines of rows 0 to rows - 1, produced by append(i, text). Up to one block per thread is
+        // formatted at a time, then the blocks go to the sink in order.
+        template <typename Append>
+        void print_rows(size_t rows, size_t cols, Append append, const Sink& sink) {
+            if (rows == 0) {
+                sink("\n", 1);
+                return;
+            }
+            size_t block = std::max<size_t>(1, kFormatBlockElements / std::max<size_t>(1, cols));
+            size_t blocks = (rows + block - 1) / block;
+            std::vector<Text> texts(std::min(blocks, num_threads()));
+            for (size_t first = 0; first < blocks; first += texts.size()) {
+                size_t count = std::min(texts.size(), blocks - first);
+                // Formatting a number costs a few dozen arithmetic operations
+                parallel_for(0, count, block * cols * 32, [&](size_t lo, size_t hi) {
+                    for (size_t b = lo; b < hi; ++b) {
+                        Text& text = texts[b];
+                        text.clear();
+                        size_t end = std::min(rows, (first + b + 1) * block);
+                        for (size_t i = (first + b) * block; i < end; ++i) {
+                            append(i, text);
+                            text.put('\n');
+                        }
+                    }
+                });
+                for (size_t b = 0; b < count; ++b)
+                    sink(texts[b].data(), texts[b].size());
+            }
+        }
+
+        [[noreturn]] void write_failed(const char* reason) {
+            throw std::runtime_error(std::string("cannot write matrix text (") + reason + ")");
+        }
+    }
+
+    Sink fd_sink(int fd) {
+        return [fd](const char* data, size_t size) {
+            while (size > 0) {
+                ssize_t done = ::write(fd, data, size);
+                if (done < 0 && errno == EINTR)
+                    continue;
+                if (done <= 0)
+                    write_failed(done < 0 ? std::strerror(errno) : "nothing written");
+                data += done;
+                size -= static_cast<size_t>(done);
+            }
+        };
+    }
+
+    Sink file_sink(std::FILE* file) {
+        return [file](const char* data, size_t size) {
+            if (std::fwrite(data, 1, size, file) != size)
+                write_failed(std::strerror(errno));
+        };
+    }
+
+    Sink stream_sink(std::ostream& out) {
+        return [&out](const char* data, size_t size) {
+            if (!out.write(data, static_cast<std::streamsize>(size)))
+                write_failed("stream failed");
+        };
+    }
+
+    Sink string_sink(std::string& out) {
+        return [&out](const char* data, size_t size) { out.append(data, size); };
+    }
+
+    void print(const Matrix& matrix, const Sink& sink) {
+        // Rows may differ in length, every one is printed whole
+        print_rows(matrix.size(), matrix.empty() ? 0 : matrix[0].size(),
+                   [&](size_t i, Text& text) { append_row(text, matrix[i].data(), matrix[i].size()); }, sink);
+    }
+
+    template <typename T>
+    void print(const BasicDenseMatrix<T>& matrix, const Sink& sink) {
+        print_rows(matrix.rows(), matrix.cols(),
+                   [&](size_t i, Text& text) { append_row(text, matrix.row(i), matrix.cols()); }, sink);
+    }
+
+    void print(ConstMatrixView matrix, const Sink& sink) {
+        print_rows(matrix.rows(), matrix.cols(), [&](size_t i, Text& text) {
+            for (size_t j = 0; j < matrix.cols(); ++j) {
+                if (j != 0)
+                    text.put(' ');
+                text.number(matrix(i, j));
+            }
+        }, sink);
+    }
+
+    template void print(const BasicDenseMatrix<double>&, const Sink&);
+    template void print(const BasicDenseMatrix<float>&, const Sink&);
+}
@@ -0,0 +1,194 @@
+#include "gemm.h"
+
+#include <algorithm>
+#include <vector>
+#include "dense_matrix.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace algebra {
+    namespace {
+        // A KC x NR micro-panel of B stays in L1 while it is reused MC / MR times
+        constexpr size_t KC = 256;
+        // An MC x KC block of A stays in L2 while it is reused NC / NR times.
+        // 120 is a multiple of every micro-kernel height (4, 6 and 8).
+        constexpr size_t MC = 120;
+        // A KC x NC panel of B stays in L3 while every block of A passes over it
+        constexpr size_t NC = 4096;
+        // Largest register block among the kernel tiers, for the edge tile buffer
+        constexpr size_t kMaxTile = 8 * 32;
+
+        template <typename T>
+        using Buffer = std::vector<T, AlignedAllocator<T>>;
+
+        // Register block and micro-kernel of the active tier for accumulator type T
+        template <typename T>
+        struct MicroKernel {
+            size_t mr;
+            size_t nr;
+            void (*kernel)(size_t kc, const T* a, const T* b, T* c, size_t ldc);
+        };
+
+        MicroKernel<double> micro_kernel(const Kernels& kernels, double) {
+            return {kernels.gemm_mr, kernels.gemm_nr, kernels.gemm_kernel};
+        }
+
+        MicroKernel<float> micro_kernel(const Kernels& kernels, float) {
+            return {kernels.sgemm_mr, kernels.sgemm_nr, kernels.sgemm_kernel};
+        }
+
+        // Copy alpha times an mc x kc block of A into micro-panels of mr rows, stored column by column.
+        // Rows past the end of the block are filled with zeros so the kernel never branches.
+        // In is the element type of A, Acc the one the kernel accumulates in.
+        template <typename In, typename Acc>
+        void pack_a(size_t mc, size_t kc, size_t mr, Acc alpha, const In* a, size_t lda, Acc* packed) {
+            for (size_t i = 0; i < mc; i += mr) {
+                size_t rows = std::min(mr, mc - i);
+                for (size_t p = 0; p < kc; ++p) {
+                    for (size_t r = 0; r < rows; ++r)
+                        packed[r] = alpha * static_cast<Acc>(a[(i + r) * lda + p]);
+                    for (size_t r = rows; r < mr; ++r)
+                        packed[r] = 0;
+                    packed += mr;
+                }
+            }
+        }
+
+        // Copy micro-panels [first, last) of a kc x nc panel of B, each nr columns wide and stored row by row
+        template <typename In, typename Acc>
+        void pack_b(size_t kc, size_t nc, size_t nr, size_t first, size_t last,
+                    const In* b, size_t ldb, Acc* packed) {
+            packed += first * nr * kc;
+            for (size_t j = first * nr; j < std::min(nc, last * nr); j += nr) {
+                size_t cols = std::min(nr, nc - j);
+                for (size_t p = 0; p < kc; ++p) {
+                    const In* src = b + p * ldb + j;
+                    for (size_t c = 0; c < cols; ++c)
+                        packed[c] = static_cast<Acc>(src[c]);
+                    for (size_t c = cols; c < nr; ++c)
+                        packed[c] = 0;
+                    packed += nr;
+                }
+            }
+        }
+
+        // Multiply a packed MC x KC block of A by a packed KC x NC panel of B.
+        // Full tiles go straight to C, edge tiles through a scratch tile.
+        template <typename T>
+        void macro_kernel(const MicroKernel<T>& micro, size_t mc, size_t nc, size_t kc,
+                          const T* packed_a, const T* packed_b,
+                          T* c, size_t ldc) {
+            size_t mr = micro.mr;
+            size_t nr = micro.nr;
+            T tile[kMaxTile];
+            for (size_t j = 0; j < nc; j += nr) {
+                size_t cols = std::min(nr, nc - j);
+                for (size_t i = 0; i < mc; i += mr) {
+                    size_t rows = std::min(mr, mc - i);
+                    const T* a = packed_a + i * kc;
+                    const T* b = packed_b + j * kc;
+                    T* dst = c + i * ldc + j;
+                    if (rows == mr && cols == nr) {
+                        micro.kernel(kc, a, b, dst, ldc);
+                        continue;
+                    }
+                    std::fill(tile, tile + mr * nr, T(0));
+                    micro.kernel(kc, a, b, tile, nr);
+                    for (size_t r = 0; r < rows; ++r)
+                        for (size_t s = 0; s < cols; ++s)
+                            dst[r * ldc + s] += tile[r * nr + s];
+                }
+            }
+        }
+
+        // The blocked algorithm for every combination of element types
+        template <typename In, typename Acc>
+        void gemm_blocked(size_t m, size_t n, size_t k, Acc alpha,
+                          const In* a, size_t lda,
+                          const In* b, size_t ldb,
+                          Acc* c, size_t ldc) {
+            if (m == 0 || n == 0 || k == 0)
+                return;
+            // One tier for the whole product, even if force_isa runs concurrently
+            MicroKernel<Acc> micro = micro_kernel(kernels(), Acc());
+            size_t mr = micro.mr;
+            size_t nr = micro.nr;
+            // Packing buffers are rounded up to whole micro-panels
+            size_t packed_a_size = (std::min(MC, m) + mr - 1) / mr * mr * std::min(KC, k);
+            Buffer<Acc> packed_b((std::min(NC, n) + nr - 1) / nr * nr * std::min(KC, k));
+            size_t blocks = (m + MC - 1) / MC;
+            for (size_t jc = 0; jc < n; jc += NC) {
+                size_t nc = std::min(NC, n - jc);
+                size_t panels = (nc + nr - 1) / nr;
+                // Few row blocks would leave threads idle, so the B panel is cut into column slices as well
+                size_t slices = std::min((num_threads() + blocks - 1) / blocks, (panels + 3) / 4);
+                size_t slice_panels = (panels + slices - 1) / slices;
+                slices = (panels + slice_panels - 1) / slice_panels;
+                for (size_t pc = 0; pc < k; pc += KC) {
+                    size_t kc = std::min(KC, k - pc);
+                    parallel_for(0, panels, kc * nr, [&](size_t lo, size_t hi) {
+                        pack_b(kc, nc, nr, lo, hi, b + pc * ldb + jc, ldb, packed_b.data());
+                    });
+                    // Every task owns one MC x slice block of C, so each element keeps the same
+                    // summation order whatever the thread count
+                    parallel_for(0, blocks * slices, MC * slice_panels * nr * kc, [&](size_t lo, size_t hi) {
+                        Buffer<Acc> packed_a(packed_a_size);
+                        for (size_t task = lo; task < hi; ++task) {
+                            size_t ic = task / slices * MC;
+                            size_t mc = std::min(MC, m - ic);
+                            size_t j0 = task % slices * slice_panels * nr;
+                            size_t width = std::min(slice_panels * nr, nc - j0);
+                            // Consecutive tasks of the same row block reuse the packed A
+                            if (task == lo || task % slices == 0)
+                                pack_a(mc, kc, mr, alpha, a + ic * lda + pc, lda, packed_a.data());
+                            macro_kernel(micro, mc, width, kc, packed_a.data(), packed_b.data() + j0 * kc,
+                                         c + ic * ldc + jc + j0, ldc);
+                        }
+                    });
+                }
+            }
+        }
+    }
+
+    void gemm(size_t m, size_t n, size_t k,
+              const double* a, size_t lda,
+              const double* b, size_t ldb,
+              double* c, size_t ldc) {
+        gemm_blocked(m, n, k, 1.0, a, lda, b, ldb, c, ldc);
+    }
+
+    void gemm(size_t m, size_t n, size_t k, double alpha,
+              const double* a, size_t lda,
+              const double* b, size_t ldb,
+              double* c, size_t ldc) {
+        gemm_blocked(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    }
+
+    void gemm(size_t m, size_t n, size_t k,
+              const float* a, size_t lda,
+              const float* b, size_t ldb,
+              float* c, size_t ldc) {
+        gemm_blocked(m, n, k, 1.0f, a, lda, b, ldb, c, ldc);
+    }
+
+    void gemm(size_t m, size_t n, size_t k, float alpha,
+              const float* a, size_t lda,
+              const float* b, size_t ldb,
+              float* c, size_t ldc) {
+        gemm_blocked(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    }
+
+    void gemm(size_t m, size_t n, size_t k,
+              const float* a, size_t lda,
+              const float* b, size_t ldb,
+              double* c, size_t ldc) {
+        gemm_blocked(m, n, k, 1.0, a, lda, b, ldb, c, ldc);
+    }
+
+    void gemm(size_t m, size_t n, size_t k, double alpha,
+              const float* a, size_t lda,
+              const float* b, size_t ldb,
+              double* c, size_t ldc) {
+        gemm_blocked(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+    }
+}
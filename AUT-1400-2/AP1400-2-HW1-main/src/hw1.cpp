@@ -1,4 +1,17 @@
 #include "hw1.h"
+#include "dense_matrix.h"
+#include "expression.h"
+#include "format.h"
+#include "gemm.h"
+#include "lu.h"
+#include "matrix_view.h"
+#include "random.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "transpose.h"
+
+#include <algorithm>
+#include <utility>
 
 
 namespace algebra {
@@ -12,56 +25,35 @@ namespace algebra {
     }
 
     Matrix random(size_t n, size_t m, double min, double max) {
+        // A fresh seed per call: the process reads the random device once, not on every call
+        return random(n, m, min, max, fresh_seed());
+    }
+
+    Matrix random(size_t n, size_t m, double min, double max, uint64_t seed) {
         // Omitted the brackets for the if statement since it has only one line
         if (min >= max)
             throw std::logic_error("min cannot be greater than max");
-        // Random number generator
-        std::random_device rd;
-        // Mersenne Twister engine with a seed from random device
-        std::mt19937 gen(rd());
-        // Generate random numbers between min and max
-        std::uniform_real_distribution<double> dis(min, max);
         // initialize the matrix with vector constructor
         Matrix matrix(n, Vector(m));
-        // auto keyword is used to avoid the long type name
-        // use colon to avoid copying the elements, like go slices
-        for (auto& row : matrix)
-            for (auto& elem : row)
-                elem = dis(gen);
+        // Element (i, j) is element i * m + j of the counter-based stream of seed, so rows can be
+        // filled by any thread in any order and the result only depends on the seed
+        parallel_for(0, n, m, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i)
+                uniform_fill(matrix[i].data(), m, i * m, min, max, seed);
+        });
         return matrix;
     }
 
     void show(const Matrix& matrix) {
-        if (matrix.empty()) {
-            std::cout << std::endl;
-            return;
-        }
-        // Get the number of columns using size
-        size_t cols = matrix[0].size();
-        for (const auto& row : matrix) {
-            // Use ostringstream to format the output
-            std::ostringstream oss;
-            for (size_t i = 0; i < row.size(); ++i) {
-                // When i is not 0, add a space
-                if (i != 0) oss << ' ';
-                // Set the precision to 3 decimal points
-                oss << std::fixed << std::setprecision(3) << row[i];
-            }
-            // Print the formatted string
-            std::cout << oss.str() << '\n';
-        }
+        print(matrix, stream_sink(std::cout));
     }
 
     Matrix multiply(const Matrix& matrix, double c) {
         if (matrix.empty())
             return Matrix();
-        // Initialize the matrix with the same size as the input matrix
-        Matrix result(matrix.size(), Vector(matrix[0].size()));
-        // Use range-based for loop to iterate over the matrix
-        for (size_t i = 0; i < matrix.size(); ++i)
-            for (size_t j = 0; j < matrix[i].size(); ++j)
-                // Multiply each element by c
-                result[i][j] = matrix[i][j] * c;
+        // A one-node expression, evaluated row by row and vectorized for the active instruction set
+        Matrix result;
+        assign(result, lazy(matrix) * c);
         return result;
     }
 
@@ -75,6 +67,9 @@ namespace algebra {
         // Check if the number of columns in the first matrix is equal to the number of rows in the second matrix
         if (cols1 != rows2)
             throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        // Large products go through the blocked GEMM on contiguous copies, the copies are O(n^2) next to O(n^3) work
+        if (rows1 * cols1 * cols2 >= kGemmThreshold)
+            return multiply(DenseMatrix(matrix1), DenseMatrix(matrix2)).to_matrix();
         // Initialize the result matrix with the size of the first matrix's rows and the second matrix's columns
         Matrix result(rows1, Vector(cols2, 0));
         // Use nested loops to iterate over the rows and columns of the result matrix
@@ -90,14 +85,9 @@ namespace algebra {
         // Check if the matrix is empty
         if (matrix.empty())
             return Matrix();
-        // Initialize the result matrix with the same size as the input matrix
-        Matrix result(matrix.size(), Vector(matrix[0].size()));
-        
-        // Use range-based for loop to iterate over the matrix
-        for (size_t i = 0; i < matrix.size(); ++i)
-            for (size_t j = 0; j < matrix[i].size(); ++j)
-                // Add c to each element
-                result[i][j] = matrix[i][j] + c;
+        // Add c to every element through the expression layer
+        Matrix result;
+        assign(result, lazy(matrix) + c);
         return result;
     }
 
@@ -113,13 +103,9 @@ namespace algebra {
         // Check if the matrices are empty, return an empty matrix
         if (rows1 == 0 || cols1 == 0 || rows2 == 0 || cols2 == 0)
             return Matrix();
-        // Initialize the result matrix with the same size as the input matrices
-        Matrix result(rows1, Vector(cols1));
-        // Use nested loops to iterate over the rows and columns of the result matrix
-        for (size_t i = 0; i < rows1; ++i)
-            for (size_t j = 0; j < cols1; ++j)
-                // Add the corresponding elements from both matrices
-                result[i][j] = matrix1[i][j] + matrix2[i][j];
+        // Add the corresponding elements from both matrices through the expression layer
+        Matrix result;
+        assign(result, lazy(matrix1) + lazy(matrix2));
         return result;
     }
 
@@ -132,42 +118,50 @@ namespace algebra {
         size_t cols = matrix[0].size();
         // Initialize the result matrix with the size of the input matrix's columns and rows
         Matrix result(cols, Vector(rows));
-        // Use nested loops to iterate over the rows and columns of the input matrix
-        for (size_t i = 0; i < rows; ++i)
-            for (size_t j = 0; j < cols; ++j)
-                // Transpose the elements by swapping the row and column indices
-                result[j][i] = matrix[i][j];
+        // Every thread owns blocks of output rows, i.e. blocks of input columns. Within a block
+        // the reads and the writes both stay on a few cache lines of kTransposeBlock rows.
+        size_t blocks = (cols + kTransposeBlock - 1) / kTransposeBlock;
+        parallel_for(0, blocks, kTransposeBlock * rows, [&](size_t lo, size_t hi) {
+            for (size_t jb = lo; jb < hi; ++jb) {
+                size_t j0 = jb * kTransposeBlock;
+                size_t j1 = std::min(cols, j0 + kTransposeBlock);
+                for (size_t i0 = 0; i0 < rows; i0 += kTransposeBlock)
+                    for (size_t i = i0; i < std::min(rows, i0 + kTransposeBlock); ++i)
+                        for (size_t j = j0; j < j1; ++j)
+                            // Transpose the elements by swapping the row and column indices
+                            result[j][i] = matrix[i][j];
+            }
+        });
         return result;
     }
 
+    void transpose_inplace(Matrix& matrix) {
+        if (matrix.empty())
+            return;
+        size_t n = matrix.size();
+        if (n != matrix[0].size())
+            throw std::logic_error("only square matrices can be transposed in place");
+        // A block row of the upper triangle is swapped with its mirror block column; no two
+        // block rows touch the same element
+        size_t blocks = (n + kTransposeBlock - 1) / kTransposeBlock;
+        parallel_for(0, blocks, kTransposeBlock * n, [&](size_t lo, size_t hi) {
+            for (size_t ib = lo; ib < hi; ++ib) {
+                size_t i0 = ib * kTransposeBlock;
+                size_t i1 = std::min(n, i0 + kTransposeBlock);
+                for (size_t j0 = i0; j0 < n; j0 += kTransposeBlock)
+                    for (size_t i = i0; i < i1; ++i)
+                        for (size_t j = std::max(j0, i + 1); j < std::min(n, j0 + kTransposeBlock); ++j)
+                            std::swap(matrix[i][j], matrix[j][i]);
+            }
+        });
+    }
+
     Matrix minor(const Matrix& matrix, size_t row, size_t col) {
         // Check if the matrix is empty
         if (matrix.empty())
             return Matrix();
-        // Get the number of rows and columns of the input matrix
-        size_t rows = matrix.size();
-        size_t cols = matrix[0].size();
-        // Check if the row and column indices are within the bounds of the matrix
-        if (row >= rows || col >= cols)
-            throw std::out_of_range("row or col index out of range");
-        // Initialize the result matrix with the size of the input matrix's rows and columns
-        Matrix result(rows - 1, Vector(cols - 1));
-        // Use nested loops to iterate over the rows and columns of the input matrix
-        for (size_t i = 0, r = 0; i < rows; ++i) {
-            // Skip the specified row
-            if (i == row)
-                continue;
-            for (size_t j = 0, c = 0; j < cols; ++j) {
-                // Skip the specified column
-                if (j == col)
-                    continue;
-                // Copy the element to the result matrix
-                result[r][c] = matrix[i][j];
-                ++c;
-            }
-            ++r;
-        }
-        return result;
+        // The minor view checks the indices and skips the row and the column, only the result is copied
+        return minor(view(matrix), row, col).to_matrix();
     }
 
     double determinant(const Matrix& matrix) {
@@ -186,18 +180,8 @@ namespace algebra {
         // Base case for 2x2 matrix
         if (rows == 2)
             return matrix[0][0] * matrix[1][1] - matrix[0][1] * matrix[1][0];
-        // Initialize the determinant value
-        double det = 0;
-        // Iterate over the first row of the matrix
-        for (size_t i = 0; i < cols; ++i) {
-            // Calculate the minor matrix for the current element
-            Matrix m = minor(matrix, 0, i);
-            // Calculate the determinant of the minor matrix
-            double minor_det = determinant(m);
-            // Add the product of the element and the determinant of the minor matrix
-            det += (i % 2 == 0 ? 1 : -1) * matrix[0][i] * minor_det;
-        }
-        return det;
+        // LU factorization with partial pivoting: O(n^3), where the Laplace expansion was O(n!)
+        return determinant(lu_factor(DenseMatrix(matrix)));
     }
 
     Matrix inverse(const Matrix& matrix) {
@@ -210,21 +194,9 @@ namespace algebra {
         // Check if the matrix is square
         if (rows != cols)
             throw std::logic_error("non-square matrix");
-        // Calculate the determinant of the input matrix
-        double det = determinant(matrix);
-        // Check if the determinant is zero
-        if (det == 0)
-            throw std::logic_error("matrix is singular, cannot be inverted");
-        size_t n = rows;
-        Matrix adj(n, Vector(n));
-        for (size_t i = 0; i < n; i++) {
-            for (size_t j = 0; j < n; j++) {
-                Matrix m = minor(matrix, i, j);
-                double minor_det = determinant(m);
-                adj[j][i] = (i + j) % 2 == 0 ? minor_det : -minor_det;
-            }
-        }
-        return multiply(adj, 1 / det);
+        // Factor once, then solve for every column of the identity.
+        // A zero pivot in the factorization reports the singular matrix.
+        return inverse(lu_factor(DenseMatrix(matrix))).to_matrix();
     }
 
     Matrix concatenate(const Matrix& matrix1, const Matrix& matrix2, size_t axis) {
@@ -247,103 +219,120 @@ namespace algebra {
         // Initialize the result matrix
         Matrix result;
         // Concatenate along the rows (axis 0)
+        // Every row is allocated once at its final size; use a BlockMatrix to skip the copies
         if (axis == 0) {
-            result = matrix1;
+            result.reserve(rows1 + rows2);
+            result.insert(result.end(), matrix1.begin(), matrix1.end());
             result.insert(result.end(), matrix2.begin(), matrix2.end());
         }
         // Concatenate along the columns (axis 1)
         else if (axis == 1) {
+            result.reserve(rows1);
             for (size_t i = 0; i < rows1; ++i) {
-                Vector row = matrix1[i];
+                Vector row;
+                row.reserve(cols1 + cols2);
+                row.insert(row.end(), matrix1[i].begin(), matrix1[i].end());
                 row.insert(row.end(), matrix2[i].begin(), matrix2[i].end());
-                result.push_back(row);
+                result.push_back(std::move(row));
             }
         }
         return result;
     }
 
     Matrix ero_swap(const Matrix& matrix, size_t r1, size_t r2) {
-        // Check if the matrix is empty
-        if (matrix.empty())
-            return Matrix();
-        // Get the number of rows and columns of the input matrix
-        size_t rows = matrix.size();
-        size_t cols = matrix[0].size();
-        // Check if the row indices are within the bounds of the matrix
-        if (r1 >= rows || r2 >= rows)
-            throw std::out_of_range("r1 or r2 index out of range");
-        // Initialize the result matrix with the same size as the input matrix
+        // Copy the matrix and swap the rows of the copy
         Matrix result = matrix;
-        // Swap the rows
-        swap(result[r1], result[r2]);
+        ero_swap_inplace(result, r1, r2);
         return result;
     }
 
     Matrix ero_multiply(const Matrix& matrix, size_t r, double c) {
-        // Check if the matrix is empty
-        if (matrix.empty())
-            return Matrix();
-        // Get the number of rows and columns of the input matrix
-        size_t rows = matrix.size();
-        size_t cols = matrix[0].size();
-        // Check if the row index is within the bounds of the matrix
-        if (r >= rows)
-            throw std::out_of_range("r index out of range");
-        // Initialize the result matrix with the same size as the input matrix
+        // Copy the matrix and scale the row of the copy
         Matrix result = matrix;
-        // Multiply the specified row by the constant
-        for (size_t j = 0; j < cols; ++j)
-            result[r][j] *= c;
+        ero_multiply_inplace(result, r, c);
         return result;
     }
 
     Matrix ero_sum(const Matrix& matrix, size_t r1, double c, size_t r2) {
-        // Check if the matrix is empty
+        // Copy the matrix and update the row of the copy
+        Matrix result = matrix;
+        ero_sum_inplace(result, r1, c, r2);
+        return result;
+    }
+
+    void ero_swap_inplace(Matrix& matrix, size_t r1, size_t r2) {
+        // Nothing to swap in an empty matrix
         if (matrix.empty())
-            return Matrix();
-        // Get the number of rows and columns of the input matrix
-        size_t rows = matrix.size();
-        size_t cols = matrix[0].size();
+            return;
+        // Check if the row indices are within the bounds of the matrix
+        if (r1 >= matrix.size() || r2 >= matrix.size())
+            throw std::out_of_range("r1 or r2 index out of range");
+        // Swapping two vectors only exchanges their buffers, no element is copied
+        swap(matrix[r1], matrix[r2]);
+    }
+
+    void ero_multiply_inplace(Matrix& matrix, size_t r, double c) {
+        if (matrix.empty())
+            return;
+        // Check if the row index is within the bounds of the matrix
+        if (r >= matrix.size())
+            throw std::out_of_range("r index out of range");
+        // Multiply the specified row by the constant with the vector kernel
+        kernels().scale(matrix[r].data(), c, matrix[r].data(), matrix[r].size());
+    }
+
+    void ero_sum_inplace(Matrix& matrix, size_t r1, double c, size_t r2) {
+        if (matrix.empty())
+            return;
         // Check if the row indices are within the bounds of the matrix
-        if (r1 >= rows || r2 >= rows)
+        if (r1 >= matrix.size() || r2 >= matrix.size())
             throw std::out_of_range("r1 or r2 index out of range");
-        // Initialize the result matrix with the same size as the input matrix
+        // Add the product of the specified row and constant to another row with the vector kernel
+        kernels().axpy(c, matrix[r1].data(), matrix[r2].data(), matrix[r2].size());
+    }
+
+    Matrix upper_triangular(const Matrix& matrix, Pivoting pivoting) {
+        // Large matrices go through the blocked factorization on a contiguous copy
+        if (!matrix.empty() && matrix.size() == matrix[0].size() && matrix.size() >= kLuBlockThreshold)
+            return upper(lu_factor(DenseMatrix(matrix), pivoting)).to_matrix();
+        // The only allocation: every row operation works in place on this copy
         Matrix result = matrix;
-        // Add the product of the specified row and constant to another row
-        for (size_t j = 0; j < cols; ++j)
-            result[r2][j] += c * result[r1][j];
+        upper_triangular_inplace(result, pivoting);
         return result;
     }
 
-    Matrix upper_triangular(const Matrix& matrix) {
+    void upper_triangular_inplace(Matrix& result, Pivoting pivoting) {
         // Check if the matrix is empty
-        if (matrix.empty())
-            return Matrix();
+        if (result.empty())
+            return;
         // Check if the matrix is square
-        if (matrix.size() != matrix[0].size())
+        if (result.size() != result[0].size())
             throw std::logic_error("non-square matrix");
         // Get the number of rows and columns of the input matrix
-        size_t rows = matrix.size();
-        size_t cols = matrix[0].size();
-        // Initialize the result matrix with the same size as the input matrix
-        Matrix result = matrix;
+        size_t rows = result.size();
+        size_t cols = result[0].size();
+        // From kLuBlockThreshold on, the blocked elimination with its GEMM updates wins over the
+        // copies to and from contiguous storage
+        if (rows >= kLuBlockThreshold) {
+            DenseMatrix u = upper(lu_factor(DenseMatrix(result), pivoting));
+            for (size_t i = 0; i < rows; ++i)
+                std::copy(u.row(i), u.row(i) + cols, result[i].begin());
+            return;
+        }
         // Use nested loops to iterate over the rows and columns of the input matrix
         for (size_t i = 0; i < rows; ++i) {
-            size_t pivot = i;
             // Find the pivot element in the current column
-            while (pivot < rows && result[pivot][i] == 0)
-                ++pivot;
+            size_t pivot = find_pivot(i, rows, pivoting, [&](size_t r) { return result[r][i]; });
             // Check if the pivot element is zero
             if (pivot == rows)
                 continue;
             // Swap the rows to move the pivot element to the current row
-            result = ero_swap(result, i, pivot);
-            // Eliminate the elements below the pivot element
-            for (size_t j = i + 1; j < rows; ++j) {
-                double factor = result[j][i] / result[i][i];
-                result = ero_sum(result, i, -factor, j);
-            }
+            ero_swap_inplace(result, i, pivot);
+            // Eliminate the elements below the pivot element, the rows are independent so they are split across threads
+            parallel_for(i + 1, rows, cols, [&](size_t lo, size_t hi) {
+                for (size_t j = lo; j < hi; ++j)
+                    ero_sum_inplace(result, i, -result[j][i] / result[i][i], j);
+            });
         }
-        return result;
     }
 }
@@ -0,0 +1,208 @@
+#include "lu.h"
+
+#include <algorithm>
+#include <cmath>
+#include "gemm.h"
+#include "thread_pool.h"
+#include "trsm.h"
+
+namespace algebra {
+    namespace {
+        // Factor columns [k, k + nb) over rows [k, n) in place. Only the panel columns are
+        // swapped and eliminated, the other columns are left to the caller (apply_swaps and the
+        // trailing update), so they can be updated meanwhile.
+        void factor_panel(DenseMatrix& a, size_t k, size_t nb, Pivoting pivoting, LuDecomposition& out) {
+            size_t n = a.rows();
+            size_t end = k + nb;
+            for (size_t j = k; j < end; ++j) {
+                size_t pivot = find_pivot(j, n, pivoting, [&](size_t i) { return a(i, j); });
+                if (pivot == n) {
+                    // Nothing to eliminate, the column is already zero below the diagonal
+                    out.pivots[j] = j;
+                    out.singular = true;
+                    continue;
+                }
+                out.pivots[j] = pivot;
+                if (pivot != j) {
+                    std::swap_ranges(a.row(j) + k, a.row(j) + end, a.row(pivot) + k);
+                    out.sign = -out.sign;
+                }
+                const double* pivot_row = a.row(j);
+                parallel_for(j + 1, n, end - j, [&](size_t lo, size_t hi) {
+                    for (size_t i = lo; i < hi; ++i) {
+                        double* row = a.row(i);
+                        // The multiplier is stored where the eliminated element was
+                        row[j] /= pivot_row[j];
+                        for (size_t c = j + 1; c < end; ++c)
+                            row[c] -= row[j] * pivot_row[c];
+                    }
+                });
+            }
+        }
+
+        // Replay the row swaps of the panel at k on every column outside it
+        void apply_swaps(DenseMatrix& a, size_t k, size_t nb, const LuDecomposition& out) {
+            size_t n = a.rows();
+            parallel_for(0, n - nb, nb, [&](size_t lo, size_t hi) {
+                // Columns lo..hi counted without the panel
+                size_t first = lo < k ? lo : lo + nb;
+                size_t last = hi <= k ? hi : hi + nb;
+                for (size_t j = k; j < k + nb; ++j) {
+                    size_t pivot = out.pivots[j];
+                    if (pivot == j)
+                        continue;
+                    double* r1 = a.row(j);
+                    double* r2 = a.row(pivot);
+                    if (first < k)
+                        std::swap_ranges(r1 + first, r1 + std::min(last, k), r2 + first);
+                    if (last > k + nb)
+                        std::swap_ranges(r1 + std::max(first, k + nb), r1 + last, r2 + std::max(first, k + nb));
+                }
+            });
+        }
+
+        // Overwrite the nb rows right of the panel with L11^-1 times themselves (U12)
+        void solve_panel_rows(DenseMatrix& a, size_t k, size_t nb) {
+            size_t first = k + nb;
+            size_t n = a.rows();
+            // Forward substitution with the unit lower triangle, split over column ranges
+            parallel_for(first, n, nb * nb / 2, [&](size_t lo, size_t hi) {
+                for (size_t r = k + 1; r < k + nb; ++r) {
+                    double* row = a.row(r);
+                    for (size_t i = k; i < r; ++i) {
+                        double l = row[i];
+                        const double* src = a.row(i);
+                        for (size_t c = lo; c < hi; ++c)
+                            row[c] -= l * src[c];
+                    }
+                }
+            });
+        }
+
+        void check_square(const DenseMatrix& matrix) {
+            if (matrix.rows() != matrix.cols())
+                throw std::logic_error("non-square matrix");
+        }
+    }
+
+    LuDecomposition lu_factor_unblocked(DenseMatrix matrix, Pivoting pivoting) {
+        check_square(matrix);
+        LuDecomposition out;
+        out.pivots.resize(matrix.rows());
+        factor_panel(matrix, 0, matrix.rows(), pivoting, out);
+        out.lu = std::move(matrix);
+        return out;
+    }
+
+    LuDecomposition lu_factor_banded(DenseMatrix matrix, size_t lower, size_t upper, Pivoting pivoting) {
+        check_square(matrix);
+        size_t n = matrix.rows();
+        LuDecomposition out;
+        out.pivots.resize(n);
+        for (size_t j = 0; j < n; ++j) {
+            // Rows and columns the step can reach, everything past them is zero
+            size_t row_end = std::min(n, j + lower + 1);
+            size_t col_end = std::min(n, j + lower + upper + 1);
+            size_t pivot = find_pivot(j, row_end, pivoting, [&](size_t i) { return matrix(i, j); });
+            if (pivot == row_end) {
+                out.pivots[j] = j;
+                out.singular = true;
+                continue;
+            }
+            out.pivots[j] = pivot;
+            if (pivot != j) {
+                // The multipliers of L left of j move with the rows, as in the dense version
+                std::swap_ranges(matrix.row(j), matrix.row(j) + col_end, matrix.row(pivot));
+                out.sign = -out.sign;
+            }
+            const double* pivot_row = matrix.row(j);
+            for (size_t i = j + 1; i < row_end; ++i) {
+                double* row = matrix.row(i);
+                row[j] /= pivot_row[j];
+                for (size_t c = j + 1; c < col_end; ++c)
+                    row[c] -= row[j] * pivot_row[c];
+            }
+        }
+        out.lu = std::move(matrix);
+        return out;
+    }
+
+    LuDecomposition lu_factor(DenseMatrix matrix, Pivoting pivoting) {
+        check_square(matrix);
+        size_t n = matrix.rows();
+        if (n < kLuBlockThreshold)
+            return lu_factor_unblocked(std::move(matrix), pivoting);
+        LuDecomposition out;
+        out.pivots.resize(n);
+        size_t stride = matrix.stride();
+        // The first panel alone, every later one is factored during the update before it
+        factor_panel(matrix, 0, kLuBlockSize, pivoting, out);
+        apply_swaps(matrix, 0, kLuBlockSize, out);
+        // Right-looking: push the whole effect of a panel onto the trailing matrix
+        for (size_t k = 0; k + kLuBlockSize < n; k += kLuBlockSize) {
+            size_t nb = kLuBlockSize;
+            size_t next = k + nb;
+            size_t next_nb = std::min(kLuBlockSize, n - next);
+            size_t rest = n - next;
+            solve_panel_rows(matrix, k, nb);
+            // A22 -= L21 * U12, where almost all of the flops are: the columns of the next panel first
+            gemm(rest, next_nb, nb, -1, matrix.row(next) + k, stride, matrix.row(k) + next, stride,
+                 matrix.row(next) + next, stride);
+            // Look-ahead: item 0 factors the next panel, the others update a slab each of the
+            // columns right of it. Without a second thread they simply run one after the other.
+            size_t right = next + next_nb;
+            size_t slabs = std::max<size_t>(num_threads(), 2) - 1;
+            parallel_for(0, slabs + 1, kParallelThreshold, [&](size_t lo, size_t hi) {
+                for (size_t t = lo; t < hi; ++t) {
+                    if (t == 0) {
+                        factor_panel(matrix, next, next_nb, pivoting, out);
+                        continue;
+                    }
+                    size_t first = right + (n - right) * (t - 1) / slabs;
+                    size_t last = right + (n - right) * t / slabs;
+                    if (first < last)
+                        gemm(rest, last - first, nb, -1, matrix.row(next) + k, stride, matrix.row(k) + first, stride,
+                             matrix.row(next) + first, stride);
+                }
+            });
+            apply_swaps(matrix, next, next_nb, out);
+        }
+        out.lu = std::move(matrix);
+        return out;
+    }
+
+    DenseMatrix upper(const LuDecomposition& lu) {
+        size_t n = lu.lu.rows();
+        DenseMatrix result(n, n);
+        for (size_t i = 0; i < n; ++i)
+            std::copy(lu.lu.row(i) + i, lu.lu.row(i) + n, result.row(i) + i);
+        return result;
+    }
+
+    double determinant(const LuDecomposition& lu) {
+        if (lu.singular)
+            return 0;
+        double det = lu.sign;
+        for (size_t i = 0; i < lu.lu.rows(); ++i)
+            det *= lu.lu(i, i);
+        return det;
+    }
+
+    DenseMatrix inverse(const LuDecomposition& lu) {
+        if (lu.singular)
+            throw std::logic_error("matrix is singular, cannot be inverted");
+        size_t n = lu.lu.rows();
+        // P * I: replay the row swaps on the identity, then solve L U X = P I with blocked substitutions
+        std::vector<size_t> perm(n);
+        for (size_t i = 0; i < n; ++i)
+            perm[i] = i;
+        for (size_t i = 0; i < n; ++i)
+            std::swap(perm[i], perm[lu.pivots[i]]);
+        DenseMatrix result(n, n);
+        for (size_t i = 0; i < n; ++i)
+            result(i, perm[i]) = 1;
+        trsm_lower(n, n, lu.lu.data(), lu.lu.stride(), result.data(), result.stride(), true);
+        trsm_upper(n, n, lu.lu.data(), lu.lu.stride(), result.data(), result.stride());
+        return result;
+    }
+}
@@ -0,0 +1,172 @@
+#include "matrix_batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include "fixed_matrix.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// The lane loops read and write distinct lanes; tell the vectorizer not to version them for aliasing
+#if defined(__GNUC__) && !defined(__clang__)
+#define ALGEBRA_IVDEP _Pragma("GCC ivdep")
+#else
+#define ALGEBRA_IVDEP
+#endif
+
+namespace algebra {
+    namespace {
+        // Number of doubles in one alignment block, lanes are padded to a multiple of it
+        constexpr size_t kLaneAlign = DenseMatrix::alignment / sizeof(double);
+        // Lanes processed together: three 4x4 operands of 64 lanes take 24 KiB and stay in L1
+        constexpr size_t kLaneBlock = 64;
+
+        // Accumulate lane by lane, kLaneBlock matrices at a time
+        inline ALGEBRA_ALWAYS_INLINE void multiply_lanes(const MatrixBatch& a, const MatrixBatch& b, MatrixBatch& c,
+                                                         size_t lo, size_t hi) {
+            for (size_t first = lo; first < hi; first += kLaneBlock) {
+                size_t last = std::min(hi, first + kLaneBlock);
+                for (size_t i = 0; i < c.rows(); ++i)
+                    for (size_t j = 0; j < c.cols(); ++j) {
+                        double* __restrict dst = c.lane(i, j);
+                        for (size_t k = 0; k < a.cols(); ++k) {
+                            const double* __restrict x = a.lane(i, k);
+                            const double* __restrict y = b.lane(k, j);
+                            ALGEBRA_IVDEP
+                            for (size_t l = first; l < last; ++l)
+                                dst[l] += x[l] * y[l];
+                        }
+                    }
+            }
+        }
+
+        // Gather matrix l of the batch from its N * N lanes
+        template <size_t N>
+        inline ALGEBRA_ALWAYS_INLINE FixedMatrix<double, N, N> load(const double* const* src, size_t l) {
+            FixedMatrix<double, N, N> m;
+            for (size_t e = 0; e < N * N; ++e)
+                m.elements[e] = src[e][l];
+            return m;
+        }
+
+        template <size_t N>
+        inline ALGEBRA_ALWAYS_INLINE void determinant_lanes(const MatrixBatch& a, double* out, size_t lo, size_t hi) {
+            const double* src[N * N];
+            for (size_t e = 0; e < N * N; ++e)
+                src[e] = a.lane(e / N, e % N);
+            ALGEBRA_IVDEP
+            for (size_t l = lo; l < hi; ++l)
+                out[l] = determinant(load<N>(src, l));
+        }
+
+        // Returns how many of the matrices were singular
+        template <size_t N>
+        inline ALGEBRA_ALWAYS_INLINE size_t inverse_lanes(const MatrixBatch& a, MatrixBatch& out, size_t lo, size_t hi) {
+            const double* src[N * N];
+            double* dst[N * N];
+            for (size_t e = 0; e < N * N; ++e) {
+                src[e] = a.lane(e / N, e % N);
+                dst[e] = out.lane(e / N, e % N);
+            }
+            size_t singular = 0;
+            ALGEBRA_IVDEP
+            for (size_t l = lo; l < hi; ++l) {
+                FixedMatrix<double, N, N> m = load<N>(src, l);
+                double det = determinant(m);
+                singular += det == 0;
+                FixedMatrix<double, N, N> adjugate = algebra::adjugate(m);
+                double inv = 1 / det;
+                for (size_t e = 0; e < N * N; ++e)
+                    dst[e][l] = adjugate.elements[e] * inv;
+            }
+            return singular;
+        }
+
+        void check_square(const MatrixBatch& matrix) {
+            if (matrix.rows() != matrix.cols())
+                throw std::logic_error("non-square matrix");
+        }
+    }
+
+    MatrixBatch::MatrixBatch(size_t count, size_t rows, size_t cols)
+        : count_(count), rows_(rows), cols_(cols),
+          stride_((count + kLaneAlign - 1) / kLaneAlign * kLaneAlign), data_(rows * cols * stride_, 0) {}
+
+    Matrix MatrixBatch::get(size_t b) const {
+        if (b >= count_)
+            throw std::out_of_range("batch index out of range");
+        Matrix result(rows_, Vector(cols_));
+        for (size_t i = 0; i < rows_; ++i)
+            for (size_t j = 0; j < cols_; ++j)
+                result[i][j] = (*this)(b, i, j);
+        return result;
+    }
+
+    void MatrixBatch::set(size_t b, const Matrix& matrix) {
+        if (b >= count_)
+            throw std::out_of_range("batch index out of range");
+        if (matrix.size() != rows_)
+            throw std::logic_error("matrix does not have the size of the batch");
+        for (size_t i = 0; i < rows_; ++i) {
+            if (matrix[i].size() != cols_)
+                throw std::logic_error("matrix does not have the size of the batch");
+            for (size_t j = 0; j < cols_; ++j)
+                (*this)(b, i, j) = matrix[i][j];
+        }
+    }
+
+    MatrixBatch batch_multiply(const MatrixBatch& matrix1, const MatrixBatch& matrix2) {
+        if (matrix1.size() != matrix2.size())
+            throw std::logic_error("batches of different sizes cannot be multiplied");
+        if (matrix1.cols() != matrix2.rows())
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        MatrixBatch result(matrix1.size(), matrix1.rows(), matrix2.cols());
+        size_t per_matrix = matrix1.rows() * matrix1.cols() * matrix2.cols();
+        parallel_for(0, matrix1.size(), per_matrix, [&](size_t lo, size_t hi) {
+            dispatch([&]() ALGEBRA_ALWAYS_INLINE { multiply_lanes(matrix1, matrix2, result, lo, hi); });
+        });
+        return result;
+    }
+
+    Vector batch_determinant(const MatrixBatch& matrix) {
+        check_square(matrix);
+        Vector result(matrix.size());
+        size_t n = matrix.rows();
+        parallel_for(0, matrix.size(), n * n * n, [&](size_t lo, size_t hi) {
+            switch (n) {
+                case 1: return dispatch([&]() ALGEBRA_ALWAYS_INLINE { determinant_lanes<1>(matrix, result.data(), lo, hi); });
+                case 2: return dispatch([&]() ALGEBRA_ALWAYS_INLINE { determinant_lanes<2>(matrix, result.data(), lo, hi); });
+                case 3: return dispatch([&]() ALGEBRA_ALWAYS_INLINE { determinant_lanes<3>(matrix, result.data(), lo, hi); });
+                case 4: return dispatch([&]() ALGEBRA_ALWAYS_INLINE { determinant_lanes<4>(matrix, result.data(), lo, hi); });
+                default:
+                    for (size_t b = lo; b < hi; ++b)
+                        result[b] = determinant(matrix.get(b));
+            }
+        });
+        return result;
+    }
+
+    MatrixBatch batch_inverse(const MatrixBatch& matrix) {
+        check_square(matrix);
+        MatrixBatch result(matrix.size(), matrix.rows(), matrix.cols());
+        size_t n = matrix.rows();
+        std::atomic<size_t> singular{0};
+        parallel_for(0, matrix.size(), n * n * n, [&](size_t lo, size_t hi) {
+            size_t count = 0;
+            switch (n) {
+                case 1: dispatch([&]() ALGEBRA_ALWAYS_INLINE { count = inverse_lanes<1>(matrix, result, lo, hi); }); break;
+                case 2: dispatch([&]() ALGEBRA_ALWAYS_INLINE { count = inverse_lanes<2>(matrix, result, lo, hi); }); break;
+                case 3: dispatch([&]() ALGEBRA_ALWAYS_INLINE { count = inverse_lanes<3>(matrix, result, lo, hi); }); break;
+                case 4: dispatch([&]() ALGEBRA_ALWAYS_INLINE { count = inverse_lanes<4>(matrix, result, lo, hi); }); break;
+                default:
+                    // Throws for a singular matrix
+                    for (size_t b = lo; b < hi; ++b)
+                        result.set(b, inverse(matrix.get(b)));
+            }
+            singular += count;
+        });
+        if (singular > 0)
+            throw std::logic_error("matrix is singular, cannot be inverted");
+        return result;
+    }
+}
@@ -0,0 +1,329 @@
+#include "matrix_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace algebra {
+    namespace {
+        constexpr char kMagic[8] = {'A', 'L', 'G', 'E', 'B', 'R', 'A', '\0'};
+        constexpr size_t kAlignment = DenseMatrix::alignment;
+
+        size_t element_size(DType dtype) {
+            return dtype == DType::float32 ? sizeof(float) : sizeof(double);
+        }
+
+        // Failure of a system call on path, with the reason from errno
+        std::runtime_error os_error(const std::string& what, const std::string& path) {
+            return std::runtime_error(what + ": " + path + " (" + std::strerror(errno) + ")");
+        }
+
+        // path exists but does not hold a valid matrix file
+        std::runtime_error format_error(const std::string& what, const std::string& path) {
+            return std::runtime_error(what + ": " + path);
+        }
+
+        template <typename T>
+        T byte_swap(T value) {
+            unsigned char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            std::reverse(bytes, bytes + sizeof(T));
+            std::memcpy(&value, bytes, sizeof(T));
+            return value;
+        }
+
+        MatrixFileHeader make_header(DType dtype, size_t rows, size_t cols) {
+            MatrixFileHeader header{};
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = MatrixFileHeader::kVersion;
+            header.dtype = static_cast<uint32_t>(dtype);
+            header.byte_order = MatrixFileHeader::kByteOrderMark;
+            header.alignment = kAlignment;
+            header.rows = rows;
+            header.cols = cols;
+            size_t block = kAlignment / element_size(dtype);
+            header.stride = (cols + block - 1) / block * block;
+            return header;
+        }
+
+        // Check a header just read from path and bring it into the native byte order.
+        // Returns whether the payload has the other byte order.
+        bool check_header(MatrixFileHeader& header, const std::string& path) {
+            if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+                throw format_error("not a matrix file", path);
+            bool swapped = header.byte_order != MatrixFileHeader::kByteOrderMark;
+            if (swapped) {
+                if (byte_swap(header.byte_order) != MatrixFileHeader::kByteOrderMark)
+                    throw format_error("corrupt byte order mark in matrix file", path);
+                header.version = byte_swap(header.version);
+                header.dtype = byte_swap(header.dtype);
+                header.alignment = byte_swap(header.alignment);
+                header.rows = byte_swap(header.rows);
+                header.cols = byte_swap(header.cols);
+                header.stride = byte_swap(header.stride);
+            }
+            if (header.version != MatrixFileHeader::kVersion)
+                throw format_error("unsupported matrix file version", path);
+            if (header.dtype != static_cast<uint32_t>(DType::float32) && header.dtype != static_cast<uint32_t>(DType::float64))
+                throw format_error("unknown element type in matrix file", path);
+            if (header.stride < header.cols)
+                throw format_error("row stride shorter than a row in matrix file", path);
+            return swapped;
+        }
+
+        size_t payload_size(const MatrixFileHeader& header) {
+            return header.rows * header.stride * element_size(static_cast<DType>(header.dtype));
+        }
+
+        // Whether the header and the payload it describes fit in file_size bytes. Divides
+        // instead of multiplying, so a corrupt header cannot overflow the size.
+        bool fits_in(const MatrixFileHeader& header, size_t file_size) {
+            if (file_size < sizeof(header))
+                return false;
+            size_t elements = (file_size - sizeof(header)) / element_size(static_cast<DType>(header.dtype));
+            return header.stride == 0 || header.rows <= elements / header.stride;
+        }
+    }
+
+    template <typename T>
+    MatrixWriter<T>::MatrixWriter(const std::string& path, size_t rows, size_t cols)
+        : out_(path, std::ios::binary | std::ios::trunc), rows_(rows), cols_(cols) {
+        if (!out_)
+            throw os_error("cannot create matrix file", path);
+        MatrixFileHeader header = make_header(dtype_of<T>(), rows, cols);
+        stride_ = header.stride;
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    template <typename T>
+    MatrixWriter<T>::~MatrixWriter() = default;
+
+    template <typename T>
+    void MatrixWriter<T>::write_row(const T* row) {
+        write_rows(row, 1, cols_);
+    }
+
+    template <typename T>
+    void MatrixWriter<T>::write_rows(const T* rows, size_t count, size_t stride) {
+        if (written_ + count > rows_)
+            throw std::logic_error("more rows written than the matrix file has");
+        // Rows that are already padded like the file go out in one piece
+        if (stride == stride_) {
+            out_.write(reinterpret_cast<const char*>(rows), static_cast<std::streamsize>(count * stride_ * sizeof(T)));
+        } else {
+            const T padding[kAlignment / sizeof(T)] = {};
+            for (size_t i = 0; i < count; ++i) {
+                out_.write(reinterpret_cast<const char*>(rows + i * stride), static_cast<std::streamsize>(cols_ * sizeof(T)));
+                out_.write(reinterpret_cast<const char*>(padding), static_cast<std::streamsize>((stride_ - cols_) * sizeof(T)));
+            }
+        }
+        written_ += count;
+        if (!out_)
+            throw std::runtime_error("cannot write matrix file");
+    }
+
+    template <typename T>
+    void MatrixWriter<T>::close() {
+        if (!out_.is_open())
+            return;
+        out_.close();
+        if (!out_)
+            throw std::runtime_error("cannot write matrix file");
+        if (written_ != rows_)
+            throw std::logic_error("matrix file closed before all of its rows were written");
+    }
+
+    template class MatrixWriter<double>;
+    template class MatrixWriter<float>;
+
+    template <typename T>
+    void save(const BasicDenseMatrix<T>& matrix, const std::string& path) {
+        MatrixWriter<T> writer(path, matrix.rows(), matrix.cols());
+        writer.write_rows(matrix.data(), matrix.rows(), matrix.stride());
+        writer.close();
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw os_error("cannot open matrix file", path);
+        MatrixFileHeader header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            throw format_error("truncated matrix file", path);
+        bool swapped = check_header(header, path);
+        if (static_cast<DType>(header.dtype) != dtype_of<T>())
+            throw std::logic_error("matrix file holds another element type");
+        // Before allocating whatever the header claims
+        std::error_code error;
+        size_t file_size = std::filesystem::file_size(path, error);
+        if (error)
+            throw std::runtime_error("cannot open matrix file: " + path + " (" + error.message() + ")");
+        if (!fits_in(header, file_size))
+            throw format_error("truncated matrix file", path);
+        BasicDenseMatrix<T> result(header.rows, header.cols);
+        if (header.stride == result.stride() && !swapped) {
+            // Same layout as in memory: the whole payload in one read
+            in.read(reinterpret_cast<char*>(result.data()), static_cast<std::streamsize>(payload_size(header)));
+            if (!in)
+                throw format_error("truncated matrix file", path);
+            return result;
+        }
+        // One row at a time straight into the result, the padding of the file is skipped
+        for (size_t i = 0; i < result.rows(); ++i) {
+            in.read(reinterpret_cast<char*>(result.row(i)), static_cast<std::streamsize>(result.cols() * sizeof(T)));
+            in.seekg(static_cast<std::streamoff>((header.stride - header.cols) * sizeof(T)), std::ios::cur);
+            if (swapped)
+                for (size_t j = 0; j < result.cols(); ++j)
+                    result(i, j) = byte_swap(result(i, j));
+        }
+        if (!in)
+            throw format_error("truncated matrix file", path);
+        return result;
+    }
+
+    template void save(const BasicDenseMatrix<double>&, const std::string&);
+    template void save(const BasicDenseMatrix<float>&, const std::string&);
+    template BasicDenseMatrix<double> load<double>(const std::string&);
+    template BasicDenseMatrix<float> load<float>(const std::string&);
+
+    MatrixFileHeader read_header(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw os_error("cannot open matrix file", path);
+        MatrixFileHeader header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            throw format_error("truncated matrix file", path);
+        check_header(header, path);
+        return header;
+    }
+
+    void create_matrix_file(const std::string& path, size_t rows, size_t cols, DType dtype) {
+        MatrixFileHeader header = make_header(dtype, rows, cols);
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out.write(reinterpret_cast<const char*>(&header), sizeof(header)))
+                throw os_error("cannot create matrix file", path);
+        }
+        // Growing the file leaves a hole that reads back as zeros
+        std::error_code error;
+        std::filesystem::resize_file(path, sizeof(header) + payload_size(header), error);
+        if (error)
+            throw std::runtime_error("cannot create matrix file: " + path + " (" + error.message() + ")");
+    }
+
+    MappedMatrix::MappedMatrix(const std::string& path, bool writable) : writable_(writable) {
+        int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0)
+            throw os_error("cannot open matrix file", path);
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
+            std::runtime_error error = os_error("cannot open matrix file", path);
+            ::close(fd);
+            throw error;
+        }
+        if (static_cast<size_t>(info.st_size) < sizeof(MatrixFileHeader)) {
+            ::close(fd);
+            throw format_error("truncated matrix file", path);
+        }
+        length_ = static_cast<size_t>(info.st_size);
+        // MAP_SHARED: every process mapping the file reads the same page cache pages
+        mapping_ = ::mmap(nullptr, length_, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping_ == MAP_FAILED) {
+            mapping_ = nullptr;
+            std::runtime_error error = os_error("cannot map matrix file", path);
+            ::close(fd);
+            throw error;
+        }
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+        MatrixFileHeader header;
+        std::memcpy(&header, mapping_, sizeof(header));
+        try {
+            if (check_header(header, path))
+                throw format_error("matrix file of the other byte order cannot be mapped", path);
+            if (header.alignment % alignof(double) != 0)
+                throw format_error("misaligned matrix file", path);
+            if (!fits_in(header, length_))
+                throw format_error("truncated matrix file", path);
+        } catch (...) {
+            unmap();
+            throw;
+        }
+        payload_ = static_cast<char*>(mapping_) + sizeof(header);
+        rows_ = header.rows;
+        cols_ = header.cols;
+        stride_ = header.stride;
+        dtype_ = static_cast<DType>(header.dtype);
+    }
+
+    MappedMatrix::~MappedMatrix() {
+        unmap();
+    }
+
+    MappedMatrix::MappedMatrix(MappedMatrix&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedMatrix& MappedMatrix::operator=(MappedMatrix&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            mapping_ = std::exchange(other.mapping_, nullptr);
+            length_ = std::exchange(other.length_, 0);
+            payload_ = std::exchange(other.payload_, nullptr);
+            rows_ = std::exchange(other.rows_, 0);
+            cols_ = std::exchange(other.cols_, 0);
+            stride_ = std::exchange(other.stride_, 0);
+            dtype_ = other.dtype_;
+            writable_ = other.writable_;
+        }
+        return *this;
+    }
+
+    void MappedMatrix::unmap() {
+        if (mapping_ != nullptr)
+            ::munmap(mapping_, length_);
+        mapping_ = nullptr;
+    }
+
+    void MappedMatrix::check_dtype(DType dtype) const {
+        if (dtype != dtype_)
+            throw std::logic_error("matrix file holds another element type");
+    }
+
+    ConstMatrixView MappedMatrix::view() const {
+        return ConstMatrixView(data<double>(), rows_, cols_, stride_);
+    }
+
+    MatrixView MappedMatrix::mutable_view() {
+        if (!writable_)
+            throw std::logic_error("matrix file is mapped read-only");
+        check_dtype(DType::float64);
+        return MatrixView(static_cast<double*>(payload_), rows_, cols_, stride_);
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> MappedMatrix::to_dense() const {
+        BasicDenseMatrix<T> result(rows_, cols_);
+        auto copy = [&](auto* source) {
+            for (size_t i = 0; i < rows_; ++i)
+                std::transform(source + i * stride_, source + i * stride_ + cols_, result.row(i),
+                               [](auto x) { return static_cast<T>(x); });
+        };
+        if (dtype_ == DType::float32)
+            copy(static_cast<const float*>(payload_));
+        else
+            copy(static_cast<const double*>(payload_));
+        return result;
+    }
+
+    template BasicDenseMatrix<double> MappedMatrix::to_dense<double>() const;
+    template BasicDenseMatrix<float> MappedMatrix::to_dense<float>() const;
+}
@@ -0,0 +1,187 @@
+#include "matrix_view.h"
+
+#include <algorithm>
+#include "format.h"
+#include "gemm.h"
+#include "lu.h"
+#include "thread_pool.h"
+
+namespace algebra {
+    namespace {
+        // Apply f to every element of a rows x cols result, rows split across threads
+        template <typename F>
+        Matrix generate(size_t rows, size_t cols, F f) {
+            Matrix result(rows, Vector(cols));
+            parallel_for(0, rows, cols, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i)
+                    for (size_t j = 0; j < cols; ++j)
+                        result[i][j] = f(i, j);
+            });
+            return result;
+        }
+
+        void check_rows(ConstMatrixView matrix, size_t r1, size_t r2) {
+            if (r1 >= matrix.rows() || r2 >= matrix.rows())
+                throw std::out_of_range("r1 or r2 index out of range");
+        }
+    }
+
+    DenseMatrix to_dense(ConstMatrixView matrix) {
+        DenseMatrix result(matrix.rows(), matrix.cols());
+        for (size_t i = 0; i < matrix.rows(); ++i) {
+            // Whole rows at once unless columns are strided or skipped
+            if (const double* row = matrix.row_data(i)) {
+                std::copy(row, row + matrix.cols(), result.row(i));
+                continue;
+            }
+            for (size_t j = 0; j < matrix.cols(); ++j)
+                result(i, j) = matrix(i, j);
+        }
+        return result;
+    }
+
+    void show(ConstMatrixView matrix) {
+        print(matrix, stream_sink(std::cout));
+    }
+
+    Matrix multiply(ConstMatrixView matrix, double c) {
+        if (matrix.rows() == 0)
+            return Matrix();
+        return generate(matrix.rows(), matrix.cols(), [&](size_t i, size_t j) { return matrix(i, j) * c; });
+    }
+
+    Matrix multiply(ConstMatrixView matrix1, ConstMatrixView matrix2) {
+        size_t rows1 = matrix1.rows();
+        size_t cols1 = matrix1.cols();
+        size_t cols2 = matrix2.cols();
+        if (cols1 != matrix2.rows())
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        // Large products pack contiguous copies for the blocked GEMM, like the Matrix version
+        if (rows1 * cols1 * cols2 >= kGemmThreshold)
+            return multiply(to_dense(matrix1), to_dense(matrix2)).to_matrix();
+        Matrix result(rows1, Vector(cols2, 0));
+        for (size_t i = 0; i < rows1; ++i)
+            for (size_t k = 0; k < cols1; ++k) {
+                double a = matrix1(i, k);
+                for (size_t j = 0; j < cols2; ++j)
+                    result[i][j] += a * matrix2(k, j);
+            }
+        return result;
+    }
+
+    Matrix sum(ConstMatrixView matrix, double c) {
+        if (matrix.rows() == 0)
+            return Matrix();
+        return generate(matrix.rows(), matrix.cols(), [&](size_t i, size_t j) { return matrix(i, j) + c; });
+    }
+
+    Matrix sum(ConstMatrixView matrix1, ConstMatrixView matrix2) {
+        if (matrix1.rows() != matrix2.rows() || matrix1.cols() != matrix2.cols())
+            throw std::logic_error("matrices with different dimensions cannot be summed");
+        if (matrix1.empty())
+            return Matrix();
+        return generate(matrix1.rows(), matrix1.cols(),
+                        [&](size_t i, size_t j) { return matrix1(i, j) + matrix2(i, j); });
+    }
+
+    Matrix transpose(ConstMatrixView matrix) {
+        if (matrix.rows() == 0)
+            return Matrix();
+        return generate(matrix.cols(), matrix.rows(), [&](size_t i, size_t j) { return matrix(j, i); });
+    }
+
+    double determinant(ConstMatrixView matrix) {
+        if (matrix.rows() == 0)
+            return 1;
+        if (matrix.rows() != matrix.cols())
+            throw std::logic_error("non-square matrix");
+        if (matrix.rows() == 1)
+            return matrix(0, 0);
+        if (matrix.rows() == 2)
+            return matrix(0, 0) * matrix(1, 1) - matrix(0, 1) * matrix(1, 0);
+        return determinant(lu_factor(to_dense(matrix)));
+    }
+
+    Matrix inverse(ConstMatrixView matrix) {
+        if (matrix.rows() == 0)
+            return Matrix();
+        if (matrix.rows() != matrix.cols())
+            throw std::logic_error("non-square matrix");
+        return inverse(lu_factor(to_dense(matrix))).to_matrix();
+    }
+
+    Matrix concatenate(ConstMatrixView matrix1, ConstMatrixView matrix2, size_t axis) {
+        size_t rows1 = matrix1.rows();
+        size_t cols1 = matrix1.cols();
+        size_t rows2 = matrix2.rows();
+        size_t cols2 = matrix2.cols();
+        if (rows1 == 0 && rows2 == 0)
+            return Matrix();
+        if (axis == 0 && cols1 != cols2)
+            throw std::logic_error("matrices with different number of columns cannot be concatenated along axis 0");
+        if (axis == 1 && rows1 != rows2)
+            throw std::logic_error("matrices with different number of rows cannot be concatenated along axis 1");
+        if (axis == 0)
+            return generate(rows1 + rows2, cols1, [&](size_t i, size_t j) {
+                return i < rows1 ? matrix1(i, j) : matrix2(i - rows1, j);
+            });
+        if (axis == 1)
+            return generate(rows1, cols1 + cols2, [&](size_t i, size_t j) {
+                return j < cols1 ? matrix1(i, j) : matrix2(i, j - cols1);
+            });
+        return Matrix();
+    }
+
+    Matrix ero_swap(ConstMatrixView matrix, size_t r1, size_t r2) {
+        Matrix result = matrix.to_matrix();
+        ero_swap_inplace(result, r1, r2);
+        return result;
+    }
+
+    Matrix ero_multiply(ConstMatrixView matrix, size_t r, double c) {
+        Matrix result = matrix.to_matrix();
+        ero_multiply_inplace(result, r, c);
+        return result;
+    }
+
+    Matrix ero_sum(ConstMatrixView matrix, size_t r1, double c, size_t r2) {
+        Matrix result = matrix.to_matrix();
+        ero_sum_inplace(result, r1, c, r2);
+        return result;
+    }
+
+    Matrix upper_triangular(ConstMatrixView matrix, Pivoting pivoting) {
+        if (matrix.rows() == 0)
+            return Matrix();
+        if (matrix.rows() != matrix.cols())
+            throw std::logic_error("non-square matrix");
+        Matrix result = matrix.to_matrix();
+        upper_triangular_inplace(result, pivoting);
+        return result;
+    }
+
+    void ero_swap_inplace(MatrixView matrix, size_t r1, size_t r2) {
+        if (matrix.empty())
+            return;
+        check_rows(matrix, r1, r2);
+        for (size_t j = 0; j < matrix.cols(); ++j)
+            std::swap(matrix(r1, j), matrix(r2, j));
+    }
+
+    void ero_multiply_inplace(MatrixView matrix, size_t r, double c) {
+        if (matrix.empty())
+            return;
+        if (r >= matrix.rows())
+            throw std::out_of_range("r index out of range");
+        for (size_t j = 0; j < matrix.cols(); ++j)
+            matrix(r, j) *= c;
+    }
+
+    void ero_sum_inplace(MatrixView matrix, size_t r1, double c, size_t r2) {
+        if (matrix.empty())
+            return;
+        check_rows(matrix, r1, r2);
+        for (size_t j = 0; j < matrix.cols(); ++j)
+            matrix(r2, j) += c * matrix(r1, j);
+    }
+}
@@ -0,0 +1,276 @@
+#include "out_of_core.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "dense_matrix.h"
+#include "gemm.h"
+#include "matrix_file.h"
+#include "thread_pool.h"
+
+namespace algebra {
+    namespace {
+        // Two buffers each for the A, B and C tiles
+        constexpr size_t kTileBuffers = 6;
+
+        using Buffer = std::vector<double, AlignedAllocator<double>>;
+
+        // Open file descriptor, closed with its owner
+        class File {
+        public:
+            File(const std::string& path, int flags) : path_(path), fd_(::open(path.c_str(), flags)) {
+                if (fd_ < 0)
+                    throw std::runtime_error("cannot open matrix file: " + path + " (" + std::strerror(errno) + ")");
+            }
+            ~File() { ::close(fd_); }
+            File(const File&) = delete;
+            File& operator=(const File&) = delete;
+
+            // Read or write exactly size bytes at offset, retrying short transfers
+            void read(void* dst, size_t size, size_t offset) const {
+                transfer(static_cast<char*>(dst), size, offset, [this](char* p, size_t n, off_t at) { return ::pread(fd_, p, n, at); });
+            }
+
+            void write(const void* src, size_t size, size_t offset) const {
+                transfer(const_cast<char*>(static_cast<const char*>(src)), size, offset,
+                         [this](char* p, size_t n, off_t at) { return ::pwrite(fd_, p, n, at); });
+            }
+
+        private:
+            template <typename Call>
+            void transfer(char* p, size_t size, size_t offset, Call call) const {
+                while (size > 0) {
+                    ssize_t done = call(p, size, static_cast<off_t>(offset));
+                    if (done < 0 && errno == EINTR)
+                        continue;
+                    if (done <= 0)
+                        throw std::runtime_error("cannot access matrix file: " + path_ +
+                                                 (done < 0 ? std::string(" (") + std::strerror(errno) + ")" : " (truncated)"));
+                    p += done;
+                    size -= static_cast<size_t>(done);
+                    offset += static_cast<size_t>(done);
+                }
+            }
+
+            std::string path_;
+            int fd_;
+        };
+
+        // rows x cols block at (row, col) of a float64 matrix file, as rows ld elements apart in memory
+        struct Tile {
+            size_t row;
+            size_t col;
+            size_t rows;
+            size_t cols;
+        };
+
+        void read_tile(const File& file, const MatrixFileHeader& header, Tile tile, double* dst, size_t ld) {
+            for (size_t r = 0; r < tile.rows; ++r)
+                file.read(dst + r * ld, tile.cols * sizeof(double),
+                          sizeof(header) + ((tile.row + r) * header.stride + tile.col) * sizeof(double));
+        }
+
+        void write_tile(const File& file, const MatrixFileHeader& header, Tile tile, const double* src, size_t ld) {
+            for (size_t r = 0; r < tile.rows; ++r)
+                file.write(src + r * ld, tile.cols * sizeof(double),
+                           sizeof(header) + ((tile.row + r) * header.stride + tile.col) * sizeof(double));
+        }
+
+        // One background thread running jobs in submission order. submit() returns a ticket and
+        // wait(ticket) blocks until that job, and so every earlier one, has run. An exception thrown
+        // by a job is rethrown by every later wait.
+        class IoThread {
+        public:
+            IoThread() : thread_([this] { loop(); }) {}
+
+            // Runs the jobs still queued, they may write results out
+            ~IoThread() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stop_ = true;
+                }
+                wake_.notify_all();
+                thread_.join();
+            }
+
+            IoThread(const IoThread&) = delete;
+            IoThread& operator=(const IoThread&) = delete;
+
+            size_t submit(std::function<void()> job) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                jobs_.push_back(std::move(job));
+                wake_.notify_all();
+                return ++submitted_;
+            }
+
+            void wait(size_t ticket) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wait_for_condition(done_, lock, [&] { return completed_ >= ticket; });
+                if (error_)
+                    std::rethrow_exception(error_);
+            }
+
+        private:
+            void loop() {
+                for (;;) {
+                    std::function<void()> job;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        wait_for_condition(wake_, lock, [this] { return stop_ || !jobs_.empty(); });
+                        if (jobs_.empty())
+                            return;
+                        job = std::move(jobs_.front());
+                        jobs_.pop_front();
+                    }
+                    std::exception_ptr error;
+                    // After a failure the remaining jobs are skipped, their results would be wrong anyway
+                    if (!failed_) {
+                        try {
+                            job();
+                        } catch (...) {
+                            error = std::current_exception();
+                            failed_ = true;
+                        }
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        if (error)
+                            error_ = error;
+                        ++completed_;
+                    }
+                    done_.notify_all();
+                }
+            }
+
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::condition_variable done_;
+            std::deque<std::function<void()>> jobs_;
+            size_t submitted_{};
+            size_t completed_{};
+            bool stop_{};
+            // Only touched by the I/O thread
+            bool failed_{};
+            std::exception_ptr error_;
+            // Last, so it starts after the state above is constructed
+            std::thread thread_;
+        };
+
+        MatrixFileHeader float64_header(const std::string& path) {
+            MatrixFileHeader header = read_header(path);
+            if (header.dtype != static_cast<uint32_t>(DType::float64))
+                throw std::logic_error("out-of-core multiply needs float64 matrix files");
+            if (header.byte_order != MatrixFileHeader::kByteOrderMark)
+                throw std::logic_error("out-of-core multiply needs matrix files in the native byte order");
+            return header;
+        }
+    }
+
+    size_t out_of_core_tile(size_t memory_budget) {
+        size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(memory_budget / (kTileBuffers * sizeof(double)))));
+        // Whole cache lines per tile row, and whole gemm blocks per tile when the budget allows it
+        size_t multiple = side >= 64 ? 64 : 8;
+        side = side / multiple * multiple;
+        if (side == 0)
+            throw std::logic_error("memory budget too small for an out-of-core multiply");
+        return side;
+    }
+
+    void multiply_files(const std::string& a_path, const std::string& b_path, const std::string& c_path,
+                        size_t memory_budget) {
+        MatrixFileHeader a_header = float64_header(a_path);
+        MatrixFileHeader b_header = float64_header(b_path);
+        if (a_header.cols != b_header.rows)
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        size_t m = a_header.rows;
+        size_t n = b_header.cols;
+        size_t k = a_header.cols;
+        size_t side = out_of_core_tile(memory_budget);
+        // Creating C truncates it, so it must not be one of the operands
+        if (std::filesystem::exists(c_path) &&
+            (std::filesystem::equivalent(c_path, a_path) || std::filesystem::equivalent(c_path, b_path)))
+            throw std::logic_error("out-of-core multiply cannot write its result over an operand");
+        create_matrix_file(c_path, m, n);
+        MatrixFileHeader c_header = read_header(c_path);
+        File a_file(a_path, O_RDONLY);
+        File b_file(b_path, O_RDONLY);
+        File c_file(c_path, O_RDWR);
+
+        // Every step multiplies one A tile by one B tile into one C tile; the steps of a C tile
+        // are consecutive and run along k. Each step is computed from its index, so the schedule
+        // takes no memory whatever the sizes.
+        struct Step {
+            Tile a;
+            Tile b;
+            Tile c;
+            bool first;
+            bool last;
+        };
+        size_t tiles_j = (n + side - 1) / side;
+        size_t tiles_p = (k + side - 1) / side;
+        size_t step_count = (m + side - 1) / side * tiles_j * tiles_p;
+        auto step_at = [&](size_t s) {
+            size_t i = s / (tiles_j * tiles_p) * side;
+            size_t j = s / tiles_p % tiles_j * side;
+            size_t p = s % tiles_p * side;
+            size_t rows = std::min(side, m - i);
+            size_t cols = std::min(side, n - j);
+            size_t depth = std::min(side, k - p);
+            return Step{{i, p, rows, depth}, {p, j, depth, cols}, {i, j, rows, cols}, p == 0, p + side >= k};
+        };
+        if (step_count == 0)
+            return;
+
+        // Buffers hold the largest tile of each operand, which is smaller than side x side for
+        // small matrices; edge tiles use part of them with the same row length
+        size_t tile_m = std::min(side, m);
+        size_t tile_n = std::min(side, n);
+        size_t tile_k = std::min(side, k);
+        Buffer a_tiles[2] = {Buffer(tile_m * tile_k), Buffer(tile_m * tile_k)};
+        Buffer b_tiles[2] = {Buffer(tile_k * tile_n), Buffer(tile_k * tile_n)};
+        Buffer c_tiles[2] = {Buffer(tile_m * tile_n), Buffer(tile_m * tile_n)};
+        // Ticket of the last write of each C buffer, the buffer is free once it completed
+        size_t c_written[2] = {0, 0};
+        // Declared after the buffers, so queued writes still find them while it shuts down
+        IoThread io;
+
+        auto load = [&](size_t s) {
+            Step step = step_at(s);
+            double* a = a_tiles[s % 2].data();
+            double* b = b_tiles[s % 2].data();
+            return io.submit([&, step, a, b] {
+                read_tile(a_file, a_header, step.a, a, tile_k);
+                read_tile(b_file, b_header, step.b, b, tile_n);
+            });
+        };
+
+        size_t loaded = load(0);
+        size_t c_tile = 0;
+        for (size_t s = 0; s < step_count; ++s) {
+            Step step = step_at(s);
+            // Prefetch the next pair into the other buffers, the step before this one is done with them
+            size_t next = s + 1 < step_count ? load(s + 1) : 0;
+            io.wait(loaded);
+            double* c = c_tiles[c_tile % 2].data();
+            if (step.first) {
+                io.wait(c_written[c_tile % 2]);
+                std::fill(c, c + tile_m * tile_n, 0.0);
+            }
+            gemm(step.c.rows, step.c.cols, step.a.cols, a_tiles[s % 2].data(), tile_k,
+                 b_tiles[s % 2].data(), tile_n, c, tile_n);
+            if (step.last) {
+                c_written[c_tile % 2] = io.submit([&, step, c] { write_tile(c_file, c_header, step.c, c, tile_n); });
+                ++c_tile;
+            }
+            loaded = next;
+        }
+        io.wait(c_written[(c_tile - 1) % 2]);
+    }
+}
@@ -0,0 +1,124 @@
+#include "random.h"
+
+#include <atomic>
+#include <cstring>
+#include <random>
+#include "simd.h"
+
+namespace algebra {
+    namespace {
+        // Counter of the n-th block of a stream: the block index in the low words, the rest zero
+        inline ALGEBRA_ALWAYS_INLINE PhiloxCounter block_counter(uint64_t n) {
+            return {static_cast<uint32_t>(n), static_cast<uint32_t>(n >> 32), 0, 0};
+        }
+
+        inline ALGEBRA_ALWAYS_INLINE PhiloxKey seed_key(uint64_t seed) {
+            return {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+        }
+
+        // The top bits of the random words become the mantissa of a number in [1, 2), minus one.
+        // Unlike an integer to floating point conversion this vectorizes on every tier.
+        inline ALGEBRA_ALWAYS_INLINE double unit(uint32_t high, uint32_t low) {
+            uint64_t bits = 0x3FF0000000000000ull | ((uint64_t(high) << 32 | low) >> 12);
+            double result;
+            std::memcpy(&result, &bits, sizeof(result));
+            return result - 1;
+        }
+
+        inline ALGEBRA_ALWAYS_INLINE float unit(uint32_t word) {
+            uint32_t bits = 0x3F800000u | (word >> 9);
+            float result;
+            std::memcpy(&result, &bits, sizeof(result));
+            return result - 1;
+        }
+
+        // Values per counter and how they are made from the four words
+        inline ALGEBRA_ALWAYS_INLINE void values(const PhiloxCounter& r, double* out) {
+            out[0] = unit(r[0], r[1]);
+            out[1] = unit(r[2], r[3]);
+        }
+
+        inline ALGEBRA_ALWAYS_INLINE void values(const PhiloxCounter& r, float* out) {
+            for (size_t w = 0; w < 4; ++w)
+                out[w] = unit(r[w]);
+        }
+
+        template <typename T>
+        constexpr size_t kPerCounter = 16 / sizeof(T);
+
+        // Whole blocks [first, last) of the stream, one counter each. The rounds run in the
+        // kernel of the active tier, the conversion and interleaving loops are vectorized here.
+        template <typename T>
+        inline ALGEBRA_ALWAYS_INLINE void fill_blocks(const Kernels& kernels, T* dst, uint64_t first, uint64_t last,
+                                                      T min, T scale, uint64_t seed) {
+            constexpr size_t per = kPerCounter<T>;
+            uint32_t words[4 * kPhiloxBatch];
+            uint64_t n = first;
+            for (; n + kPhiloxBatch <= last; n += kPhiloxBatch) {
+                kernels.philox(n, seed, words);
+                T* out = dst + (n - first) * per;
+                for (size_t l = 0; l < kPhiloxBatch; ++l) {
+                    T v[per];
+                    values({words[l], words[kPhiloxBatch + l], words[2 * kPhiloxBatch + l], words[3 * kPhiloxBatch + l]}, v);
+                    for (size_t i = 0; i < per; ++i)
+                        out[l * per + i] = min + scale * v[i];
+                }
+            }
+            PhiloxKey key = seed_key(seed);
+            for (; n < last; ++n) {
+                T v[per];
+                values(philox4x32(block_counter(n), key), v);
+                for (size_t i = 0; i < per; ++i)
+                    dst[(n - first) * per + i] = min + scale * v[i];
+            }
+        }
+
+        // Element i of the stream on its own, for the partial blocks at both ends
+        template <typename T>
+        T element(uint64_t i, T min, T scale, PhiloxKey key) {
+            constexpr size_t per = kPerCounter<T>;
+            T out[per];
+            values(philox4x32(block_counter(i / per), key), out);
+            return min + scale * out[i % per];
+        }
+
+        template <typename T>
+        void fill(T* dst, size_t count, uint64_t first, T min, T max, uint64_t seed) {
+            constexpr size_t per = kPerCounter<T>;
+            PhiloxKey key = seed_key(seed);
+            T scale = max - min;
+            for (; count > 0 && first % per != 0; --count)
+                *dst++ = element(first++, min, scale, key);
+            uint64_t blocks = count / per;
+            // One tier for the whole fill, even if force_isa runs concurrently
+            const Kernels& tier = kernels();
+            dispatch([&]() ALGEBRA_ALWAYS_INLINE { fill_blocks(tier, dst, first / per, first / per + blocks, min, scale, seed); });
+            dst += blocks * per;
+            first += blocks * per;
+            count -= blocks * per;
+            for (; count > 0; --count)
+                *dst++ = element(first++, min, scale, key);
+        }
+    }
+
+    void uniform_fill(double* dst, size_t count, uint64_t first, double min, double max, uint64_t seed) {
+        fill(dst, count, first, min, max, seed);
+    }
+
+    void uniform_fill(float* dst, size_t count, uint64_t first, float min, float max, uint64_t seed) {
+        fill(dst, count, first, min, max, seed);
+    }
+
+    uint64_t fresh_seed() {
+        static const uint64_t base = [] {
+            std::random_device rd;
+            return uint64_t(rd()) << 32 | rd();
+        }();
+        static std::atomic<uint64_t> calls{0};
+        // splitmix64 of consecutive numbers: distinct, well mixed seeds
+        uint64_t z = base + (calls.fetch_add(1, std::memory_order_relaxed) + 1) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+}
@@ -0,0 +1,588 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "random.h"
+
+// The vector tiers are compiled with per-function target attributes, so the whole
+// file builds for the baseline ISA and the dispatcher picks a tier at run time
+#if ALGEBRA_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace algebra {
+    namespace {
+        // Scalar tier, the only one on non-x86 targets
+
+        void scale_scalar(const double* src, double c, double* dst, size_t n) {
+            for (size_t i = 0; i < n; ++i)
+                dst[i] = src[i] * c;
+        }
+
+        void axpy_scalar(double c, const double* src, double* dst, size_t n) {
+            for (size_t i = 0; i < n; ++i)
+                dst[i] += c * src[i];
+        }
+
+        void gemm_kernel_scalar(size_t kc, const double* a, const double* b, double* c, size_t ldc) {
+            constexpr size_t MR = 4, NR = 4;
+            double acc[MR][NR] = {};
+            for (size_t p = 0; p < kc; ++p, a += MR, b += NR)
+                for (size_t i = 0; i < MR; ++i)
+                    for (size_t j = 0; j < NR; ++j)
+                        acc[i][j] += a[i] * b[j];
+            for (size_t i = 0; i < MR; ++i)
+                for (size_t j = 0; j < NR; ++j)
+                    c[i * ldc + j] += acc[i][j];
+        }
+
+        void scale_f32_scalar(const float* src, float c, float* dst, size_t n) {
+            for (size_t i = 0; i < n; ++i)
+                dst[i] = src[i] * c;
+        }
+
+        void axpy_f32_scalar(float c, const float* src, float* dst, size_t n) {
+            for (size_t i = 0; i < n; ++i)
+                dst[i] += c * src[i];
+        }
+
+        void sgemm_kernel_scalar(size_t kc, const float* a, const float* b, float* c, size_t ldc) {
+            constexpr size_t MR = 4, NR = 8;
+            float acc[MR][NR] = {};
+            for (size_t p = 0; p < kc; ++p, a += MR, b += NR)
+                for (size_t i = 0; i < MR; ++i)
+                    for (size_t j = 0; j < NR; ++j)
+                        acc[i][j] += a[i] * b[j];
+            for (size_t i = 0; i < MR; ++i)
+                for (size_t j = 0; j < NR; ++j)
+                    c[i * ldc + j] += acc[i][j];
+        }
+
+        void philox_scalar(uint64_t first, uint64_t key, uint32_t* words) {
+            for (size_t l = 0; l < kPhiloxBatch; ++l) {
+                uint64_t n = first + l;
+                PhiloxCounter r = philox4x32({static_cast<uint32_t>(n), static_cast<uint32_t>(n >> 32), 0, 0},
+                                             {static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32)});
+                for (size_t w = 0; w < 4; ++w)
+                    words[w * kPhiloxBatch + l] = r[w];
+            }
+        }
+
+        void transpose_kernel_scalar(const double* a, size_t lda, double* b, size_t ldb) {
+            double tile[4][4];
+            for (size_t i = 0; i < 4; ++i)
+                for (size_t j = 0; j < 4; ++j)
+                    tile[j][i] = a[i * lda + j];
+            for (size_t i = 0; i < 4; ++i)
+                for (size_t j = 0; j < 4; ++j)
+                    b[i * ldb + j] = tile[i][j];
+        }
+
+        constexpr Kernels kScalarKernels{
+            Isa::scalar, scale_scalar, axpy_scalar, 4, 4, gemm_kernel_scalar,
+            scale_f32_scalar, axpy_f32_scalar, 4, 8, sgemm_kernel_scalar,
+            philox_scalar, 4, transpose_kernel_scalar};
+
+#if ALGEBRA_X86_DISPATCH
+        // SSE2 tier, two doubles per register
+
+        __attribute__((target("sse2")))
+        void scale_sse2(const double* src, double c, double* dst, size_t n) {
+            __m128d vc = _mm_set1_pd(c);
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+                _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(src + i), vc));
+            for (; i < n; ++i)
+                dst[i] = src[i] * c;
+        }
+
+        __attribute__((target("sse2")))
+        void axpy_sse2(double c, const double* src, double* dst, size_t n) {
+            __m128d vc = _mm_set1_pd(c);
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2)
+                _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(dst + i), _mm_mul_pd(vc, _mm_loadu_pd(src + i))));
+            for (; i < n; ++i)
+                dst[i] += c * src[i];
+        }
+
+        // 4 x 4 block held in 8 accumulators
+        __attribute__((target("sse2")))
+        void gemm_kernel_sse2(size_t kc, const double* a, const double* b, double* c, size_t ldc) {
+            __m128d acc[4][2];
+            for (size_t i = 0; i < 4; ++i)
+                acc[i][0] = acc[i][1] = _mm_setzero_pd();
+            for (size_t p = 0; p < kc; ++p, a += 4, b += 4) {
+                __m128d b0 = _mm_loadu_pd(b);
+                __m128d b1 = _mm_loadu_pd(b + 2);
+                for (size_t i = 0; i < 4; ++i) {
+                    __m128d ai = _mm_set1_pd(a[i]);
+                    acc[i][0] = _mm_add_pd(acc[i][0], _mm_mul_pd(ai, b0));
+                    acc[i][1] = _mm_add_pd(acc[i][1], _mm_mul_pd(ai, b1));
+                }
+            }
+            for (size_t i = 0; i < 4; ++i) {
+                double* row = c + i * ldc;
+                _mm_storeu_pd(row, _mm_add_pd(_mm_loadu_pd(row), acc[i][0]));
+                _mm_storeu_pd(row + 2, _mm_add_pd(_mm_loadu_pd(row + 2), acc[i][1]));
+            }
+        }
+
+        __attribute__((target("sse2")))
+        void scale_f32_sse2(const float* src, float c, float* dst, size_t n) {
+            __m128 vc = _mm_set1_ps(c);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), vc));
+            for (; i < n; ++i)
+                dst[i] = src[i] * c;
+        }
+
+        __attribute__((target("sse2")))
+        void axpy_f32_sse2(float c, const float* src, float* dst, size_t n) {
+            __m128 vc = _mm_set1_ps(c);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(vc, _mm_loadu_ps(src + i))));
+            for (; i < n; ++i)
+                dst[i] += c * src[i];
+        }
+
+        // 4 x 8 block held in 8 accumulators
+        __attribute__((target("sse2")))
+        void sgemm_kernel_sse2(size_t kc, const float* a, const float* b, float* c, size_t ldc) {
+            __m128 acc[4][2];
+            for (size_t i = 0; i < 4; ++i)
+                acc[i][0] = acc[i][1] = _mm_setzero_ps();
+            for (size_t p = 0; p < kc; ++p, a += 4, b += 8) {
+                __m128 b0 = _mm_loadu_ps(b);
+                __m128 b1 = _mm_loadu_ps(b + 4);
+                for (size_t i = 0; i < 4; ++i) {
+                    __m128 ai = _mm_set1_ps(a[i]);
+                    acc[i][0] = _mm_add_ps(acc[i][0], _mm_mul_ps(ai, b0));
+                    acc[i][1] = _mm_add_ps(acc[i][1], _mm_mul_ps(ai, b1));
+                }
+            }
+            for (size_t i = 0; i < 4; ++i) {
+                float* row = c + i * ldc;
+                _mm_storeu_ps(row, _mm_add_ps(_mm_loadu_ps(row), acc[i][0]));
+                _mm_storeu_ps(row + 4, _mm_add_ps(_mm_loadu_ps(row + 4), acc[i][1]));
+            }
+        }
+
+        // The Philox kernels keep one 32 bit word per 64 bit lane, where mul_epu32 forms the full
+        // 64 bit product. The upper halves of the lanes collect garbage that the multiplies ignore
+        // and the final stores drop.
+        __attribute__((target("sse2")))
+        void philox_sse2(uint64_t first, uint64_t key, uint32_t* words) {
+            const __m128i m0 = _mm_set1_epi64x(0xD2511F53);
+            const __m128i m1 = _mm_set1_epi64x(0xCD9E8D57);
+            for (size_t g = 0; g < kPhiloxBatch; g += 2) {
+                __m128i c0 = _mm_add_epi64(_mm_set1_epi64x(static_cast<long long>(first + g)), _mm_set_epi64x(1, 0));
+                __m128i c1 = _mm_srli_epi64(c0, 32);
+                __m128i c2 = _mm_setzero_si128();
+                __m128i c3 = _mm_setzero_si128();
+                uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+                for (int round = 0; round < 10; ++round) {
+                    __m128i p0 = _mm_mul_epu32(c0, m0);
+                    __m128i p1 = _mm_mul_epu32(c2, m1);
+                    c0 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(p1, 32), c1), _mm_set1_epi64x(k0));
+                    c2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi64(p0, 32), c3), _mm_set1_epi64x(k1));
+                    c1 = p1;
+                    c3 = p0;
+                    k0 += 0x9E3779B9;
+                    k1 += 0xBB67AE85;
+                }
+                __m128i* out[4] = {&c0, &c1, &c2, &c3};
+                for (size_t w = 0; w < 4; ++w)
+                    _mm_storel_epi64(reinterpret_cast<__m128i*>(words + w * kPhiloxBatch + g),
+                                     _mm_shuffle_epi32(*out[w], _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+        }
+
+        // 4 x 4 as four 2 x 2 blocks: the two rows of a block interleave into two columns
+        __attribute__((target("sse2")))
+        void transpose_kernel_sse2(const double* a, size_t lda, double* b, size_t ldb) {
+            __m128d r[4][2];
+            for (size_t i = 0; i < 4; ++i) {
+                r[i][0] = _mm_loadu_pd(a + i * lda);
+                r[i][1] = _mm_loadu_pd(a + i * lda + 2);
+            }
+            for (size_t bi = 0; bi < 2; ++bi)
+                for (size_t bj = 0; bj < 2; ++bj) {
+                    __m128d upper = r[2 * bi][bj], lower = r[2 * bi + 1][bj];
+                    _mm_storeu_pd(b + (2 * bj) * ldb + 2 * bi, _mm_unpacklo_pd(upper, lower));
+                    _mm_storeu_pd(b + (2 * bj + 1) * ldb + 2 * bi, _mm_unpackhi_pd(upper, lower));
+                }
+        }
+
+        constexpr Kernels kSse2Kernels{
+            Isa::sse2, scale_sse2, axpy_sse2, 4, 4, gemm_kernel_sse2,
+            scale_f32_sse2, axpy_f32_sse2, 4, 8, sgemm_kernel_sse2,
+            philox_sse2, 4, transpose_kernel_sse2};
+
+        // AVX2 tier, four doubles per register and fused multiply-add
+
+        __attribute__((target("avx2,fma")))
+        void scale_avx2(const double* src, double c, double* dst, size_t n) {
+            __m256d vc = _mm256_set1_pd(c);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(src + i), vc));
+            for (; i < n; ++i)
+                dst[i] = src[i] * c;
+        }
+
+        __attribute__((target("avx2,fma")))
+        void axpy_avx2(double c, const double* src, double* dst, size_t n) {
+            __m256d vc = _mm256_set1_pd(c);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm256_storeu_pd(dst + i, _mm256_fmadd_pd(vc, _mm256_loadu_pd(src + i), _mm256_loadu_pd(dst + i)));
+            for (; i < n; ++i)
+                dst[i] += c * src[i];
+        }
+
+        // 6 x 8 block held in 12 accumulators, leaving room for two B vectors and a broadcast
+        __attribute__((target("avx2,fma")))
+        void gemm_kernel_avx2(size_t kc, const double* a, const double* b, double* c, size_t ldc) {
+            __m256d acc[6][2];
+            for (size_t i = 0; i < 6; ++i)
+                acc[i][0] = acc[i][1] = _mm256_setzero_pd();
+            for (size_t p = 0; p < kc; ++p, a += 6, b += 8) {
+                __m256d b0 = _mm256_loadu_pd(b);
+                __m256d b1 = _mm256_loadu_pd(b + 4);
+                for (size_t i = 0; i < 6; ++i) {
+                    __m256d ai = _mm256_broadcast_sd(a + i);
+                    acc[i][0] = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+                }
+            }
+            for (size_t i = 0; i < 6; ++i) {
+                double* row = c + i * ldc;
+                _mm256_storeu_pd(row, _mm256_add_pd(_mm256_loadu_pd(row), acc[i][0]));
+                _mm256_storeu_pd(row + 4, _mm256_add_pd(_mm256_loadu_pd(row + 4), acc[i][1]));
+            }
+        }
+
+        __attribute__((target("avx2,fma")))
+        void scale_f32_avx2(const float* src, float c, float* dst, size_t n) {
+            __m256 vc = _mm256_set1_ps(c);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), vc));
+            for (; i < n; ++i)
+                dst[i] = src[i] * c;
+        }
+
+        __attribute__((target("avx2,fma")))
+        void axpy_f32_avx2(float c, const float* src, float* dst, size_t n) {
+            __m256 vc = _mm256_set1_ps(c);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(vc, _mm256_loadu_ps(src + i), _mm256_loadu_ps(dst + i)));
+            for (; i < n; ++i)
+                dst[i] += c * src[i];
+        }
+
+        // 6 x 16 block, the same register budget as the double kernel
+        __attribute__((target("avx2,fma")))
+        void sgemm_kernel_avx2(size_t kc, const float* a, const float* b, float* c, size_t ldc) {
+            __m256 acc[6][2];
+            for (size_t i = 0; i < 6; ++i)
+                acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+            for (size_t p = 0; p < kc; ++p, a += 6, b += 16) {
+                __m256 b0 = _mm256_loadu_ps(b);
+                __m256 b1 = _mm256_loadu_ps(b + 8);
+                for (size_t i = 0; i < 6; ++i) {
+                    __m256 ai = _mm256_broadcast_ss(a + i);
+                    acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+                }
+            }
+            for (size_t i = 0; i < 6; ++i) {
+                float* row = c + i * ldc;
+                _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), acc[i][0]));
+                _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), acc[i][1]));
+            }
+        }
+
+        __attribute__((target("avx2,fma")))
+        void philox_avx2(uint64_t first, uint64_t key, uint32_t* words) {
+            const __m256i m0 = _mm256_set1_epi64x(0xD2511F53);
+            const __m256i m1 = _mm256_set1_epi64x(0xCD9E8D57);
+            const __m256i low_words = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            for (size_t g = 0; g < kPhiloxBatch; g += 4) {
+                __m256i c0 = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(first + g)), _mm256_setr_epi64x(0, 1, 2, 3));
+                __m256i c1 = _mm256_srli_epi64(c0, 32);
+                __m256i c2 = _mm256_setzero_si256();
+                __m256i c3 = _mm256_setzero_si256();
+                uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+                for (int round = 0; round < 10; ++round) {
+                    __m256i p0 = _mm256_mul_epu32(c0, m0);
+                    __m256i p1 = _mm256_mul_epu32(c2, m1);
+                    c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), _mm256_set1_epi64x(k0));
+                    c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), _mm256_set1_epi64x(k1));
+                    c1 = p1;
+                    c3 = p0;
+                    k0 += 0x9E3779B9;
+                    k1 += 0xBB67AE85;
+                }
+                __m256i* out[4] = {&c0, &c1, &c2, &c3};
+                for (size_t w = 0; w < 4; ++w)
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(words + w * kPhiloxBatch + g),
+                                     _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(*out[w], low_words)));
+            }
+        }
+
+        // Pairs of rows interleave within 128 bit lanes, then the lanes of the pairs are exchanged
+        __attribute__((target("avx2,fma")))
+        void transpose_kernel_avx2(const double* a, size_t lda, double* b, size_t ldb) {
+            __m256d r0 = _mm256_loadu_pd(a);
+            __m256d r1 = _mm256_loadu_pd(a + lda);
+            __m256d r2 = _mm256_loadu_pd(a + 2 * lda);
+            __m256d r3 = _mm256_loadu_pd(a + 3 * lda);
+            // a00 a10 a02 a12, a01 a11 a03 a13, and the same for rows 2 and 3
+            __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+            __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+            __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+            __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+            _mm256_storeu_pd(b, _mm256_permute2f128_pd(t0, t2, 0x20));
+            _mm256_storeu_pd(b + ldb, _mm256_permute2f128_pd(t1, t3, 0x20));
+            _mm256_storeu_pd(b + 2 * ldb, _mm256_permute2f128_pd(t0, t2, 0x31));
+            _mm256_storeu_pd(b + 3 * ldb, _mm256_permute2f128_pd(t1, t3, 0x31));
+        }
+
+        constexpr Kernels kAvx2Kernels{
+            Isa::avx2, scale_avx2, axpy_avx2, 6, 8, gemm_kernel_avx2,
+            scale_f32_avx2, axpy_f32_avx2, 6, 16, sgemm_kernel_avx2,
+            philox_avx2, 4, transpose_kernel_avx2};
+
+        // AVX-512 tier, eight doubles per register and masked tails
+
+        __attribute__((target("avx512f")))
+        void scale_avx512(const double* src, double c, double* dst, size_t n) {
+            __m512d vc = _mm512_set1_pd(c);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm512_storeu_pd(dst + i, _mm512_mul_pd(_mm512_loadu_pd(src + i), vc));
+            __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+            _mm512_mask_storeu_pd(dst + i, tail, _mm512_mul_pd(_mm512_maskz_loadu_pd(tail, src + i), vc));
+        }
+
+        __attribute__((target("avx512f")))
+        void axpy_avx512(double c, const double* src, double* dst, size_t n) {
+            __m512d vc = _mm512_set1_pd(c);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm512_storeu_pd(dst + i, _mm512_fmadd_pd(vc, _mm512_loadu_pd(src + i), _mm512_loadu_pd(dst + i)));
+            __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+            _mm512_mask_storeu_pd(dst + i, tail,
+                                  _mm512_fmadd_pd(vc, _mm512_maskz_loadu_pd(tail, src + i), _mm512_maskz_loadu_pd(tail, dst + i)));
+        }
+
+        // 8 x 16 block held in 16 of the 32 registers
+        __attribute__((target("avx512f")))
+        void gemm_kernel_avx512(size_t kc, const double* a, const double* b, double* c, size_t ldc) {
+            __m512d acc[8][2];
+            for (size_t i = 0; i < 8; ++i)
+                acc[i][0] = acc[i][1] = _mm512_setzero_pd();
+            for (size_t p = 0; p < kc; ++p, a += 8, b += 16) {
+                __m512d b0 = _mm512_loadu_pd(b);
+                __m512d b1 = _mm512_loadu_pd(b + 8);
+                for (size_t i = 0; i < 8; ++i) {
+                    __m512d ai = _mm512_set1_pd(a[i]);
+                    acc[i][0] = _mm512_fmadd_pd(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm512_fmadd_pd(ai, b1, acc[i][1]);
+                }
+            }
+            for (size_t i = 0; i < 8; ++i) {
+                double* row = c + i * ldc;
+                _mm512_storeu_pd(row, _mm512_add_pd(_mm512_loadu_pd(row), acc[i][0]));
+                _mm512_storeu_pd(row + 8, _mm512_add_pd(_mm512_loadu_pd(row + 8), acc[i][1]));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void scale_f32_avx512(const float* src, float c, float* dst, size_t n) {
+            __m512 vc = _mm512_set1_ps(c);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+                _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_loadu_ps(src + i), vc));
+            __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+            _mm512_mask_storeu_ps(dst + i, tail, _mm512_mul_ps(_mm512_maskz_loadu_ps(tail, src + i), vc));
+        }
+
+        __attribute__((target("avx512f")))
+        void axpy_f32_avx512(float c, const float* src, float* dst, size_t n) {
+            __m512 vc = _mm512_set1_ps(c);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+                _mm512_storeu_ps(dst + i, _mm512_fmadd_ps(vc, _mm512_loadu_ps(src + i), _mm512_loadu_ps(dst + i)));
+            __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+            _mm512_mask_storeu_ps(dst + i, tail,
+                                  _mm512_fmadd_ps(vc, _mm512_maskz_loadu_ps(tail, src + i), _mm512_maskz_loadu_ps(tail, dst + i)));
+        }
+
+        // 8 x 32 block held in 16 of the 32 registers
+        __attribute__((target("avx512f")))
+        void sgemm_kernel_avx512(size_t kc, const float* a, const float* b, float* c, size_t ldc) {
+            __m512 acc[8][2];
+            for (size_t i = 0; i < 8; ++i)
+                acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+            for (size_t p = 0; p < kc; ++p, a += 8, b += 32) {
+                __m512 b0 = _mm512_loadu_ps(b);
+                __m512 b1 = _mm512_loadu_ps(b + 16);
+                for (size_t i = 0; i < 8; ++i) {
+                    __m512 ai = _mm512_set1_ps(a[i]);
+                    acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+                    acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+                }
+            }
+            for (size_t i = 0; i < 8; ++i) {
+                float* row = c + i * ldc;
+                _mm512_storeu_ps(row, _mm512_add_ps(_mm512_loadu_ps(row), acc[i][0]));
+                _mm512_storeu_ps(row + 16, _mm512_add_ps(_mm512_loadu_ps(row + 16), acc[i][1]));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void philox_avx512(uint64_t first, uint64_t key, uint32_t* words) {
+            const __m512i m0 = _mm512_set1_epi64(0xD2511F53);
+            const __m512i m1 = _mm512_set1_epi64(0xCD9E8D57);
+            for (size_t g = 0; g < kPhiloxBatch; g += 8) {
+                __m512i c0 = _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>(first + g)),
+                                              _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7));
+                __m512i c1 = _mm512_srli_epi64(c0, 32);
+                __m512i c2 = _mm512_setzero_si512();
+                __m512i c3 = _mm512_setzero_si512();
+                uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+                for (int round = 0; round < 10; ++round) {
+                    __m512i p0 = _mm512_mul_epu32(c0, m0);
+                    __m512i p1 = _mm512_mul_epu32(c2, m1);
+                    c0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), c1), _mm512_set1_epi64(k0));
+                    c2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), c3), _mm512_set1_epi64(k1));
+                    c1 = p1;
+                    c3 = p0;
+                    k0 += 0x9E3779B9;
+                    k1 += 0xBB67AE85;
+                }
+                __m512i* out[4] = {&c0, &c1, &c2, &c3};
+                for (size_t w = 0; w < 4; ++w)
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + w * kPhiloxBatch + g), _mm512_cvtepi64_epi32(*out[w]));
+            }
+        }
+
+        // 8 x 8 in three steps: pairs of rows interleave within 128 bit lanes, then the lanes are
+        // gathered two rows of four apart, then four rows of eight apart
+        __attribute__((target("avx512f")))
+        void transpose_kernel_avx512(const double* a, size_t lda, double* b, size_t ldb) {
+            __m512d r[8], t[8], u[8];
+            for (size_t i = 0; i < 8; ++i)
+                r[i] = _mm512_loadu_pd(a + i * lda);
+            for (size_t i = 0; i < 8; i += 2) {
+                t[i] = _mm512_unpacklo_pd(r[i], r[i + 1]);
+                t[i + 1] = _mm512_unpackhi_pd(r[i], r[i + 1]);
+            }
+            // u[0] holds columns 0 and 4 of rows 0 to 3, u[1] columns 2 and 6, u[2] 1 and 5, u[3] 3 and 7
+            for (size_t h = 0; h < 8; h += 4) {
+                u[h] = _mm512_shuffle_f64x2(t[h], t[h + 2], 0x88);
+                u[h + 1] = _mm512_shuffle_f64x2(t[h], t[h + 2], 0xDD);
+                u[h + 2] = _mm512_shuffle_f64x2(t[h + 1], t[h + 3], 0x88);
+                u[h + 3] = _mm512_shuffle_f64x2(t[h + 1], t[h + 3], 0xDD);
+            }
+            const size_t column[4] = {0, 2, 1, 3};
+            for (size_t q = 0; q < 4; ++q) {
+                _mm512_storeu_pd(b + column[q] * ldb, _mm512_shuffle_f64x2(u[q], u[q + 4], 0x88));
+                _mm512_storeu_pd(b + (column[q] + 4) * ldb, _mm512_shuffle_f64x2(u[q], u[q + 4], 0xDD));
+            }
+        }
+
+        constexpr Kernels kAvx512Kernels{
+            Isa::avx512, scale_avx512, axpy_avx512, 8, 16, gemm_kernel_avx512,
+            scale_f32_avx512, axpy_f32_avx512, 8, 32, sgemm_kernel_avx512,
+            philox_avx512, 8, transpose_kernel_avx512};
+#endif
+
+        Isa detect() {
+#if ALGEBRA_X86_DISPATCH
+            __builtin_cpu_init();
+            // The builtins also check that the OS saves the wider registers on context switches
+            if (__builtin_cpu_supports("avx512f"))
+                return Isa::avx512;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                return Isa::avx2;
+            if (__builtin_cpu_supports("sse2"))
+                return Isa::sse2;
+#endif
+            return Isa::scalar;
+        }
+
+        const Kernels* table(Isa isa) {
+            switch (isa) {
+#if ALGEBRA_X86_DISPATCH
+                case Isa::avx512: return &kAvx512Kernels;
+                case Isa::avx2: return &kAvx2Kernels;
+                case Isa::sse2: return &kSse2Kernels;
+#endif
+                default: return &kScalarKernels;
+            }
+        }
+
+        // Tier requested through ALGEBRA_ISA, capped at what the CPU supports
+        const Kernels* initial_table() {
+            Isa isa = detected_isa();
+            const char* env = std::getenv("ALGEBRA_ISA");
+            if (env == nullptr || *env == '\0')
+                return table(isa);
+            for (Isa requested : {Isa::scalar, Isa::sse2, Isa::avx2, Isa::avx512}) {
+                if (std::strcmp(env, isa_name(requested)) != 0)
+                    continue;
+                if (requested > isa)
+                    std::cerr << "ALGEBRA_ISA=" << env << " is not supported by this CPU, using "
+                              << isa_name(isa) << '\n';
+                return table(std::min(requested, isa));
+            }
+            std::cerr << "ALGEBRA_ISA=" << env << " is not a known instruction set, using " << isa_name(isa) << '\n';
+            return table(isa);
+        }
+
+        std::atomic<const Kernels*>& active_table() {
+            static std::atomic<const Kernels*> active{initial_table()};
+            return active;
+        }
+    }
+
+    Isa detected_isa() {
+        static const Isa isa = detect();
+        return isa;
+    }
+
+    Isa active_isa() {
+        return kernels().isa;
+    }
+
+    void force_isa(Isa isa) {
+        if (isa > detected_isa())
+            throw std::logic_error(std::string("instruction set not supported by this CPU: ") + isa_name(isa));
+        active_table().store(table(isa));
+    }
+
+    const char* isa_name(Isa isa) {
+        switch (isa) {
+            case Isa::sse2: return "sse2";
+            case Isa::avx2: return "avx2";
+            case Isa::avx512: return "avx512";
+            default: return "scalar";
+        }
+    }
+
+    const Kernels& kernels() {
+        return *active_table().load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,69 @@
+#include "solve.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "trsm.h"
+
+namespace algebra {
+    Factorization::Factorization(DenseMatrix matrix) : lu_(lu_factor(std::move(matrix))) {}
+
+    Factorization::Factorization(const Matrix& matrix) : Factorization(DenseMatrix(matrix)) {}
+
+    double Factorization::determinant() const {
+        return algebra::determinant(lu_);
+    }
+
+    DenseMatrix Factorization::inverse() const {
+        return algebra::inverse(lu_);
+    }
+
+    void Factorization::solve_in_place(double* b, size_t nrhs, size_t ldb) const {
+        if (lu_.singular)
+            throw std::logic_error("matrix is singular, cannot solve");
+        size_t n = size();
+        // P * B, replaying the row swaps of the factorization in order
+        for (size_t i = 0; i < n; ++i)
+            if (lu_.pivots[i] != i)
+                std::swap_ranges(b + i * ldb, b + i * ldb + nrhs, b + lu_.pivots[i] * ldb);
+        // L * Y = P * B, then U * X = Y
+        trsm_lower(n, nrhs, lu_.lu.data(), lu_.lu.stride(), b, ldb, true);
+        trsm_upper(n, nrhs, lu_.lu.data(), lu_.lu.stride(), b, ldb);
+    }
+
+    DenseMatrix Factorization::solve(DenseMatrix b) const {
+        if (b.rows() != size())
+            throw std::logic_error("right-hand side with wrong number of rows");
+        solve_in_place(b.data(), b.cols(), b.stride());
+        return b;
+    }
+
+    Matrix Factorization::solve(const Matrix& b) const {
+        if (b.size() != size())
+            throw std::logic_error("right-hand side with wrong number of rows");
+        if (b.empty())
+            return Matrix();
+        return solve(DenseMatrix(b)).to_matrix();
+    }
+
+    Vector Factorization::solve(const Vector& b) const {
+        if (b.size() != size())
+            throw std::logic_error("right-hand side with wrong number of rows");
+        // A vector is a single column whose rows are one element apart
+        Vector x = b;
+        solve_in_place(x.data(), 1, 1);
+        return x;
+    }
+
+    DenseMatrix solve(const DenseMatrix& a, DenseMatrix b) {
+        return Factorization(a).solve(std::move(b));
+    }
+
+    Matrix solve(const Matrix& a, const Matrix& b) {
+        return Factorization(a).solve(b);
+    }
+
+    Vector solve(const Matrix& a, const Vector& b) {
+        return Factorization(a).solve(b);
+    }
+}
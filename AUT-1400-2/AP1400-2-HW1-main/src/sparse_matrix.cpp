@@ -0,0 +1,315 @@
+#include "sparse_matrix.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace algebra {
+    namespace {
+        constexpr size_t kNone = std::numeric_limits<size_t>::max();
+
+        // Length of the compressed axis
+        size_t major_size(size_t rows, size_t cols, SparseFormat format) {
+            return format == SparseFormat::csr ? rows : cols;
+        }
+
+        // The matrix itself when it already has the format, otherwise a converted copy kept in storage
+        const SparseMatrix& as_format(const SparseMatrix& matrix, SparseFormat format, SparseMatrix& storage) {
+            if (matrix.format() == format)
+                return matrix;
+            storage = matrix.convert(format);
+            return storage;
+        }
+
+        // Turn per-row counts stored at offsets[i + 1] into offsets
+        void prefix_sum(std::vector<size_t>& offsets) {
+            for (size_t i = 1; i < offsets.size(); ++i)
+                offsets[i] += offsets[i - 1];
+        }
+    }
+
+    SparseMatrix::SparseMatrix(size_t rows, size_t cols, SparseFormat format)
+        : rows_(rows), cols_(cols), format_(format), offsets_(major_size(rows, cols, format) + 1, 0) {}
+
+    SparseMatrix::SparseMatrix(const Matrix& matrix, SparseFormat format)
+        : SparseMatrix(matrix.size(), matrix.empty() ? 0 : matrix[0].size(), SparseFormat::csr) {
+        for (const auto& row : matrix)
+            if (row.size() != cols_)
+                throw std::logic_error("rows of a matrix must all have the same size");
+        // Count first so the arrays are allocated once
+        for (size_t i = 0; i < rows_; ++i)
+            offsets_[i + 1] = offsets_[i] + (cols_ - std::count(matrix[i].begin(), matrix[i].end(), 0.0));
+        indices_.resize(offsets_[rows_]);
+        values_.resize(offsets_[rows_]);
+        for (size_t i = 0, p = 0; i < rows_; ++i)
+            for (size_t j = 0; j < cols_; ++j)
+                if (matrix[i][j] != 0) {
+                    indices_[p] = j;
+                    values_[p++] = matrix[i][j];
+                }
+        if (format == SparseFormat::csc)
+            *this = convert(SparseFormat::csc);
+    }
+
+    SparseMatrix SparseMatrix::from_triplets(size_t rows, size_t cols, const std::vector<Triplet>& triplets,
+                                             SparseFormat format) {
+        SparseMatrix result(rows, cols, format);
+        bool csr = format == SparseFormat::csr;
+        std::vector<Triplet> sorted = triplets;
+        for (const Triplet& t : sorted)
+            if (t.row >= rows || t.col >= cols)
+                throw std::out_of_range("triplet index out of range");
+        // Order by compressed index, then by the other one, so duplicates end up next to each other
+        std::sort(sorted.begin(), sorted.end(), [csr](const Triplet& x, const Triplet& y) {
+            return csr ? std::tie(x.row, x.col) < std::tie(y.row, y.col) : std::tie(x.col, x.row) < std::tie(y.col, y.row);
+        });
+        for (size_t p = 0; p < sorted.size(); ++p) {
+            size_t major = csr ? sorted[p].row : sorted[p].col;
+            size_t minor = csr ? sorted[p].col : sorted[p].row;
+            if (p > 0 && sorted[p].row == sorted[p - 1].row && sorted[p].col == sorted[p - 1].col) {
+                result.values_.back() += sorted[p].value;
+                continue;
+            }
+            result.indices_.push_back(minor);
+            result.values_.push_back(sorted[p].value);
+            ++result.offsets_[major + 1];
+        }
+        prefix_sum(result.offsets_);
+        return result;
+    }
+
+    Matrix SparseMatrix::to_matrix() const {
+        Matrix result(rows_, Vector(cols_, 0));
+        for (size_t major = 0; major + 1 < offsets_.size(); ++major)
+            for (size_t p = offsets_[major]; p < offsets_[major + 1]; ++p) {
+                if (format_ == SparseFormat::csr)
+                    result[major][indices_[p]] = values_[p];
+                else
+                    result[indices_[p]][major] = values_[p];
+            }
+        return result;
+    }
+
+    SparseMatrix SparseMatrix::convert(SparseFormat format) const {
+        if (format == format_)
+            return *this;
+        // Counting sort on the other axis: walking the compressed axis in order leaves
+        // the new indices sorted
+        SparseMatrix result(rows_, cols_, format);
+        for (size_t index : indices_)
+            ++result.offsets_[index + 1];
+        prefix_sum(result.offsets_);
+        result.indices_.resize(nnz());
+        result.values_.resize(nnz());
+        std::vector<size_t> next(result.offsets_.begin(), result.offsets_.end() - 1);
+        for (size_t major = 0; major + 1 < offsets_.size(); ++major)
+            for (size_t p = offsets_[major]; p < offsets_[major + 1]; ++p) {
+                size_t q = next[indices_[p]]++;
+                result.indices_[q] = major;
+                result.values_[q] = values_[p];
+            }
+        return result;
+    }
+
+    double SparseMatrix::operator()(size_t i, size_t j) const {
+        size_t major = format_ == SparseFormat::csr ? i : j;
+        size_t minor = format_ == SparseFormat::csr ? j : i;
+        auto first = indices_.begin() + offsets_[major];
+        auto last = indices_.begin() + offsets_[major + 1];
+        auto it = std::lower_bound(first, last, minor);
+        if (it == last || *it != minor)
+            return 0;
+        return values_[it - indices_.begin()];
+    }
+
+    bool operator==(const SparseMatrix& matrix1, const SparseMatrix& matrix2) {
+        if (matrix1.rows() != matrix2.rows() || matrix1.cols() != matrix2.cols() || matrix1.nnz() != matrix2.nnz())
+            return false;
+        // Same stored nonzeros, whatever the layout
+        SparseMatrix storage;
+        const SparseMatrix& other = as_format(matrix2, matrix1.format(), storage);
+        return matrix1.offsets() == other.offsets() && matrix1.indices() == other.indices() &&
+               matrix1.values() == other.values();
+    }
+
+    bool operator!=(const SparseMatrix& matrix1, const SparseMatrix& matrix2) {
+        return !(matrix1 == matrix2);
+    }
+
+    Vector multiply(const SparseMatrix& matrix, const Vector& vector) {
+        if (matrix.cols() != vector.size())
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        Vector result(matrix.rows(), 0);
+        const auto& offsets = matrix.offsets();
+        const auto& indices = matrix.indices();
+        const auto& values = matrix.values();
+        if (matrix.format() == SparseFormat::csr) {
+            // One dot product per row, the rows are independent
+            size_t per_row = matrix.nnz() / std::max<size_t>(matrix.rows(), 1) + 1;
+            parallel_for(0, matrix.rows(), per_row, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    double dot = 0;
+                    for (size_t p = offsets[i]; p < offsets[i + 1]; ++p)
+                        dot += values[p] * vector[indices[p]];
+                    result[i] = dot;
+                }
+            });
+            return result;
+        }
+        // Every column scatters into the whole result, so csc stays on one thread
+        for (size_t j = 0; j < matrix.cols(); ++j)
+            for (size_t p = offsets[j]; p < offsets[j + 1]; ++p)
+                result[indices[p]] += values[p] * vector[j];
+        return result;
+    }
+
+    Matrix multiply(const SparseMatrix& matrix1, const Matrix& matrix2) {
+        size_t rows2 = matrix2.size();
+        size_t cols2 = rows2 > 0 ? matrix2[0].size() : 0;
+        if (matrix1.cols() != rows2)
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        // Converting costs O(nnz), next to O(nnz * cols2) for the product
+        SparseMatrix storage;
+        const SparseMatrix& a = as_format(matrix1, SparseFormat::csr, storage);
+        Matrix result(a.rows(), Vector(cols2, 0));
+        const Kernels& k = kernels();
+        size_t per_row = (a.nnz() / std::max<size_t>(a.rows(), 1) + 1) * cols2;
+        parallel_for(0, a.rows(), per_row, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i)
+                for (size_t p = a.offsets()[i]; p < a.offsets()[i + 1]; ++p)
+                    k.axpy(a.values()[p], matrix2[a.indices()[p]].data(), result[i].data(), cols2);
+        });
+        return result;
+    }
+
+    SparseMatrix multiply(const SparseMatrix& matrix1, const SparseMatrix& matrix2) {
+        if (matrix1.cols() != matrix2.rows())
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        SparseMatrix storage1, storage2;
+        const SparseMatrix& a = as_format(matrix1, SparseFormat::csr, storage1);
+        const SparseMatrix& b = as_format(matrix2, SparseFormat::csr, storage2);
+        size_t rows = a.rows();
+        size_t cols = b.cols();
+        SparseMatrix result(rows, cols, SparseFormat::csr);
+        size_t per_row = (a.nnz() / std::max<size_t>(rows, 1) + 1) * (b.nnz() / std::max<size_t>(b.rows(), 1) + 1);
+
+        // Symbolic pass: marker[j] == i when column j already appeared in result row i
+        parallel_for(0, rows, per_row, [&](size_t lo, size_t hi) {
+            std::vector<size_t> marker(cols, kNone);
+            for (size_t i = lo; i < hi; ++i) {
+                size_t count = 0;
+                for (size_t p = a.offsets_[i]; p < a.offsets_[i + 1]; ++p) {
+                    size_t k = a.indices_[p];
+                    for (size_t q = b.offsets_[k]; q < b.offsets_[k + 1]; ++q)
+                        if (marker[b.indices_[q]] != i) {
+                            marker[b.indices_[q]] = i;
+                            ++count;
+                        }
+                }
+                result.offsets_[i + 1] = count;
+            }
+        });
+        prefix_sum(result.offsets_);
+        result.indices_.resize(result.offsets_[rows]);
+        result.values_.resize(result.offsets_[rows]);
+
+        // Numeric pass: accumulate every row in a dense scratch row, then gather it in column order
+        parallel_for(0, rows, per_row, [&](size_t lo, size_t hi) {
+            std::vector<size_t> marker(cols, kNone);
+            std::vector<double> accumulator(cols);
+            for (size_t i = lo; i < hi; ++i) {
+                size_t first = result.offsets_[i];
+                size_t next = first;
+                for (size_t p = a.offsets_[i]; p < a.offsets_[i + 1]; ++p) {
+                    size_t k = a.indices_[p];
+                    double value = a.values_[p];
+                    for (size_t q = b.offsets_[k]; q < b.offsets_[k + 1]; ++q) {
+                        size_t j = b.indices_[q];
+                        if (marker[j] != i) {
+                            marker[j] = i;
+                            accumulator[j] = 0;
+                            result.indices_[next++] = j;
+                        }
+                        accumulator[j] += value * b.values_[q];
+                    }
+                }
+                std::sort(result.indices_.begin() + first, result.indices_.begin() + next);
+                for (size_t p = first; p < next; ++p)
+                    result.values_[p] = accumulator[result.indices_[p]];
+            }
+        });
+        return result;
+    }
+
+    SparseMatrix multiply(const SparseMatrix& matrix, double c) {
+        SparseMatrix result = matrix;
+        for (double& value : result.values_)
+            value *= c;
+        return result;
+    }
+
+    SparseMatrix sum(const SparseMatrix& matrix1, const SparseMatrix& matrix2) {
+        if (matrix1.rows() != matrix2.rows() || matrix1.cols() != matrix2.cols())
+            throw std::logic_error("matrices with different dimensions cannot be summed");
+        SparseMatrix storage;
+        const SparseMatrix& a = matrix1;
+        const SparseMatrix& b = as_format(matrix2, matrix1.format(), storage);
+        size_t majors = major_size(a.rows(), a.cols(), a.format());
+        SparseMatrix result(a.rows(), a.cols(), a.format());
+        size_t per_major = (a.nnz() + b.nnz()) / std::max<size_t>(majors, 1) + 1;
+
+        // Merge the sorted index lists of every row (column), counting first and then writing
+        auto merge = [&](size_t major, size_t* indices, double* values) {
+            size_t p = a.offsets_[major], p_end = a.offsets_[major + 1];
+            size_t q = b.offsets_[major], q_end = b.offsets_[major + 1];
+            size_t count = 0;
+            while (p < p_end || q < q_end) {
+                size_t index;
+                double value;
+                if (q == q_end || (p < p_end && a.indices_[p] < b.indices_[q])) {
+                    index = a.indices_[p];
+                    value = a.values_[p++];
+                } else if (p == p_end || b.indices_[q] < a.indices_[p]) {
+                    index = b.indices_[q];
+                    value = b.values_[q++];
+                } else {
+                    index = a.indices_[p];
+                    value = a.values_[p++] + b.values_[q++];
+                }
+                // Values that cancel are not stored, in both passes so the counts match
+                if (value == 0)
+                    continue;
+                if (indices) {
+                    indices[count] = index;
+                    values[count] = value;
+                }
+                ++count;
+            }
+            return count;
+        };
+        parallel_for(0, majors, per_major, [&](size_t lo, size_t hi) {
+            for (size_t major = lo; major < hi; ++major)
+                result.offsets_[major + 1] = merge(major, nullptr, nullptr);
+        });
+        prefix_sum(result.offsets_);
+        result.indices_.resize(result.offsets_[majors]);
+        result.values_.resize(result.offsets_[majors]);
+        parallel_for(0, majors, per_major, [&](size_t lo, size_t hi) {
+            for (size_t major = lo; major < hi; ++major) {
+                size_t first = result.offsets_[major];
+                merge(major, result.indices_.data() + first, result.values_.data() + first);
+            }
+        });
+        return result;
+    }
+
+    SparseMatrix transpose(const SparseMatrix& matrix) {
+        SparseMatrix result = matrix;
+        std::swap(result.rows_, result.cols_);
+        result.format_ = matrix.format() == SparseFormat::csr ? SparseFormat::csc : SparseFormat::csr;
+        return result;
+    }
+}
@@ -0,0 +1,279 @@
+#include "strassen.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include "gemm.h"
+#include "thread_pool.h"
+
+namespace algebra {
+    namespace {
+        template <typename T>
+        using Buffer = std::vector<T, AlignedAllocator<T>>;
+
+        // Row-major block of a larger matrix
+        template <typename T>
+        struct Block {
+            T* data;
+            size_t ld;
+
+            // Quadrant (i, j) of a block split into rows x cols quadrants
+            Block quadrant(size_t i, size_t j, size_t rows, size_t cols) const {
+                return {data + i * rows * ld + j * cols, ld};
+            }
+
+            operator Block<const T>() const { return {data, ld}; }
+        };
+
+        // Temporaries start on a cache line
+        size_t padded(size_t size) {
+            return (size + 15) / 16 * 16;
+        }
+
+        bool recurses(size_t m, size_t n, size_t k, size_t cutoff) {
+            return std::min({m, n, k}) >= cutoff;
+        }
+
+        // Scratch of the sequential schedule: X holds the sums of A quadrants and P1, Y the sums
+        // of B quadrants, and the products below reuse the same space one after the other
+        size_t sequential_workspace(size_t m, size_t n, size_t k, size_t cutoff) {
+            if (!recurses(m, n, k, cutoff))
+                return 0;
+            size_t mh = m / 2, nh = n / 2, kh = k / 2;
+            return padded(mh * std::max(kh, nh)) + padded(kh * nh) + sequential_workspace(mh, nh, kh, cutoff);
+        }
+
+        // Scratch of the task schedule: all four sums of each operand and three products live at
+        // once, and every task has the sequential scratch of its own product
+        size_t task_workspace(size_t m, size_t n, size_t k, size_t cutoff) {
+            if (!recurses(m, n, k, cutoff))
+                return 0;
+            size_t mh = m / 2, nh = n / 2, kh = k / 2;
+            return 4 * padded(mh * kh) + 4 * padded(kh * nh) + 3 * padded(mh * nh) + 7 * sequential_workspace(mh, nh, kh, cutoff);
+        }
+
+        // z = op(x, y) on rows x cols blocks; z may be x or y
+        template <typename T, typename Op>
+        void combine(size_t rows, size_t cols, Block<const T> x, Block<const T> y, Block<T> z, Op op) {
+            parallel_for(0, rows, cols, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const T* xi = x.data + i * x.ld;
+                    const T* yi = y.data + i * y.ld;
+                    T* zi = z.data + i * z.ld;
+                    for (size_t j = 0; j < cols; ++j)
+                        zi[j] = op(xi[j], yi[j]);
+                }
+            });
+        }
+
+        template <typename T>
+        void add(size_t rows, size_t cols, Block<const T> x, Block<const T> y, Block<T> z) {
+            combine(rows, cols, x, y, z, std::plus<T>());
+        }
+
+        template <typename T>
+        void subtract(size_t rows, size_t cols, Block<const T> x, Block<const T> y, Block<T> z) {
+            combine(rows, cols, x, y, z, std::minus<T>());
+        }
+
+        // U2 = P1 + P6, U3 = U2 + P7, U4 = U2 + P5, then C22 = U3 + P5 and C12 = U4 + P3, in one pass.
+        // On entry C11, C12, C21 and C22 hold P3, P6, P7 and P5; C21 is left holding U3.
+        template <typename T>
+        void combine_products(size_t rows, size_t cols, Block<const T> p1, Block<T> c11, Block<T> c12,
+                              Block<T> c21, Block<T> c22) {
+            parallel_for(0, rows, cols, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const T* p = p1.data + i * p1.ld;
+                    T* q11 = c11.data + i * c11.ld;
+                    T* q12 = c12.data + i * c12.ld;
+                    T* q21 = c21.data + i * c21.ld;
+                    T* q22 = c22.data + i * c22.ld;
+                    for (size_t j = 0; j < cols; ++j) {
+                        T u2 = p[j] + q12[j];
+                        T u3 = u2 + q21[j];
+                        T u4 = u2 + q22[j];
+                        q22[j] = u3 + q22[j];
+                        q12[j] = u4 + q11[j];
+                        q21[j] = u3;
+                    }
+                }
+            });
+        }
+
+        template <typename T>
+        void fill_zero(size_t rows, size_t cols, Block<T> c) {
+            for (size_t i = 0; i < rows; ++i)
+                std::fill(c.data + i * c.ld, c.data + i * c.ld + cols, T(0));
+        }
+
+        template <typename T>
+        void product(size_t m, size_t n, size_t k, Block<const T> a, Block<const T> b, Block<T> c,
+                     T* workspace, size_t cutoff, bool tasks);
+
+        // One level with two temporaries, in the order of Boyer, Dumas, Pernet and Zhou, "Memory
+        // efficient scheduling of Strassen-Winograd's matrix multiplication algorithm" (2009).
+        // The products P3 to P7 go straight into quadrants of C.
+        template <typename T>
+        void sequential_level(size_t mh, size_t nh, size_t kh, Block<const T> a, Block<const T> b, Block<T> c,
+                              T* workspace, size_t cutoff) {
+            Block<const T> a11 = a.quadrant(0, 0, mh, kh), a12 = a.quadrant(0, 1, mh, kh);
+            Block<const T> a21 = a.quadrant(1, 0, mh, kh), a22 = a.quadrant(1, 1, mh, kh);
+            Block<const T> b11 = b.quadrant(0, 0, kh, nh), b12 = b.quadrant(0, 1, kh, nh);
+            Block<const T> b21 = b.quadrant(1, 0, kh, nh), b22 = b.quadrant(1, 1, kh, nh);
+            Block<T> c11 = c.quadrant(0, 0, mh, nh), c12 = c.quadrant(0, 1, mh, nh);
+            Block<T> c21 = c.quadrant(1, 0, mh, nh), c22 = c.quadrant(1, 1, mh, nh);
+            Block<T> x{workspace, kh};
+            Block<T> p1{workspace, nh};
+            Block<T> y{workspace + padded(mh * std::max(kh, nh)), nh};
+            T* deeper = y.data + padded(kh * nh);
+
+            subtract<T>(mh, kh, a11, a21, x);                              // S3
+            subtract<T>(kh, nh, b22, b12, y);                              // T3
+            product<T>(mh, nh, kh, x, y, c21, deeper, cutoff, false);      // P7
+            add<T>(mh, kh, a21, a22, x);                                   // S1
+            subtract<T>(kh, nh, b12, b11, y);                              // T1
+            product<T>(mh, nh, kh, x, y, c22, deeper, cutoff, false);      // P5
+            subtract<T>(mh, kh, x, a11, x);                                // S2
+            subtract<T>(kh, nh, b22, y, y);                                // T2
+            product<T>(mh, nh, kh, x, y, c12, deeper, cutoff, false);      // P6
+            subtract<T>(mh, kh, a12, x, x);                                // S4
+            product<T>(mh, nh, kh, x, b22, c11, deeper, cutoff, false);    // P3
+            product<T>(mh, nh, kh, a11, b11, p1, deeper, cutoff, false);   // P1
+            combine_products<T>(mh, nh, p1, c11, c12, c21, c22);           // U2 to U5, U7
+            subtract<T>(kh, nh, y, b21, y);                                // T4
+            product<T>(mh, nh, kh, a22, y, c11, deeper, cutoff, false);    // P4
+            subtract<T>(mh, nh, c21, c11, c21);                            // U6 = U3 - P4, C21
+            product<T>(mh, nh, kh, a12, b21, c11, deeper, cutoff, false);  // P2
+            add<T>(mh, nh, p1, c11, c11);                                  // U1 = P1 + P2, C11
+        }
+
+        // One level whose seven products run as parallel tasks. The sums and the combination of
+        // the products are the same operations as in sequential_level, so the results are too.
+        template <typename T>
+        void task_level(size_t mh, size_t nh, size_t kh, Block<const T> a, Block<const T> b, Block<T> c,
+                        T* workspace, size_t cutoff) {
+            Block<const T> a11 = a.quadrant(0, 0, mh, kh), a12 = a.quadrant(0, 1, mh, kh);
+            Block<const T> a21 = a.quadrant(1, 0, mh, kh), a22 = a.quadrant(1, 1, mh, kh);
+            Block<const T> b11 = b.quadrant(0, 0, kh, nh), b12 = b.quadrant(0, 1, kh, nh);
+            Block<const T> b21 = b.quadrant(1, 0, kh, nh), b22 = b.quadrant(1, 1, kh, nh);
+            Block<T> c11 = c.quadrant(0, 0, mh, nh), c12 = c.quadrant(0, 1, mh, nh);
+            Block<T> c21 = c.quadrant(1, 0, mh, nh), c22 = c.quadrant(1, 1, mh, nh);
+            T* next = workspace;
+            auto take = [&](size_t size, size_t ld) {
+                Block<T> block{next, ld};
+                next += padded(size);
+                return block;
+            };
+            Block<T> s[4], t[4];
+            for (Block<T>& block : s)
+                block = take(mh * kh, kh);
+            for (Block<T>& block : t)
+                block = take(kh * nh, nh);
+            Block<T> p1 = take(mh * nh, nh), p2 = take(mh * nh, nh), p4 = take(mh * nh, nh);
+
+            add<T>(mh, kh, a21, a22, s[0]);        // S1
+            subtract<T>(mh, kh, s[0], a11, s[1]);  // S2
+            subtract<T>(mh, kh, a11, a21, s[2]);   // S3
+            subtract<T>(mh, kh, a12, s[1], s[3]);  // S4
+            subtract<T>(kh, nh, b12, b11, t[0]);   // T1
+            subtract<T>(kh, nh, b22, t[0], t[1]);  // T2
+            subtract<T>(kh, nh, b22, b12, t[2]);   // T3
+            subtract<T>(kh, nh, t[1], b21, t[3]);  // T4
+
+            struct Task {
+                Block<const T> a;
+                Block<const T> b;
+                Block<T> c;
+            };
+            const Task products[7] = {{a11, b11, p1}, {a12, b21, p2}, {s[3], b22, c11}, {a22, t[3], p4},
+                                      {s[0], t[0], c22}, {s[1], t[1], c12}, {s[2], t[2], c21}};
+            size_t scratch = sequential_workspace(mh, nh, kh, cutoff);
+            // Every task is worth a thread of its own, the products inside it run on that thread
+            parallel_for(0, 7, kParallelThreshold, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i)
+                    product<T>(mh, nh, kh, products[i].a, products[i].b, products[i].c, next + i * scratch, cutoff, false);
+            });
+
+            combine_products<T>(mh, nh, p1, c11, c12, c21, c22); // U2 to U5, U7
+            subtract<T>(mh, nh, c21, p4, c21); // U6 = U3 - P4, C21
+            add<T>(mh, nh, p1, p2, c11);       // U1 = P1 + P2, C11
+        }
+
+        // C = A * B, recursing on the even part and peeling the odd row, column and rank-one term
+        template <typename T>
+        void product(size_t m, size_t n, size_t k, Block<const T> a, Block<const T> b, Block<T> c,
+                     T* workspace, size_t cutoff, bool tasks) {
+            if (!recurses(m, n, k, cutoff)) {
+                fill_zero(m, n, c);
+                gemm(m, n, k, a.data, a.ld, b.data, b.ld, c.data, c.ld);
+                return;
+            }
+            size_t mh = m / 2, nh = n / 2, kh = k / 2;
+            if (tasks)
+                task_level(mh, nh, kh, a, b, c, workspace, cutoff);
+            else
+                sequential_level(mh, nh, kh, a, b, c, workspace, cutoff);
+            size_t me = 2 * mh, ne = 2 * nh, ke = 2 * kh;
+            if (k > ke)
+                gemm(me, ne, 1, a.data + ke, a.ld, b.data + ke * b.ld, b.ld, c.data, c.ld);
+            if (n > ne) {
+                fill_zero(me, 1, Block<T>{c.data + ne, c.ld});
+                gemm(me, 1, k, a.data, a.ld, b.data + ne, b.ld, c.data + ne, c.ld);
+            }
+            if (m > me) {
+                fill_zero(1, n, Block<T>{c.data + me * c.ld, c.ld});
+                gemm(1, n, k, a.data + me * a.ld, a.ld, b.data, b.ld, c.data + me * c.ld, c.ld);
+            }
+        }
+
+        // The seven products as tasks only pay off while they do not leave threads idle
+        bool use_tasks() {
+            size_t threads = num_threads();
+            return threads > 1 && threads <= 7;
+        }
+
+        template <typename T>
+        void strassen_impl(size_t m, size_t n, size_t k, const T* a, size_t lda, const T* b, size_t ldb,
+                           T* c, size_t ldc, size_t cutoff) {
+            // Halving a dimension below 2 would never end
+            cutoff = std::max<size_t>(cutoff, 2);
+            bool tasks = use_tasks();
+            Buffer<T> workspace(strassen_workspace(m, n, k, tasks, cutoff));
+            product<T>(m, n, k, {a, lda}, {b, ldb}, {c, ldc}, workspace.data(), cutoff, tasks);
+        }
+    }
+
+    size_t strassen_workspace(size_t m, size_t n, size_t k, bool tasks, size_t cutoff) {
+        cutoff = std::max<size_t>(cutoff, 2);
+        return tasks ? task_workspace(m, n, k, cutoff) : sequential_workspace(m, n, k, cutoff);
+    }
+
+    void strassen(size_t m, size_t n, size_t k,
+                  const double* a, size_t lda,
+                  const double* b, size_t ldb,
+                  double* c, size_t ldc, size_t cutoff) {
+        strassen_impl(m, n, k, a, lda, b, ldb, c, ldc, cutoff);
+    }
+
+    void strassen(size_t m, size_t n, size_t k,
+                  const float* a, size_t lda,
+                  const float* b, size_t ldb,
+                  float* c, size_t ldc, size_t cutoff) {
+        strassen_impl(m, n, k, a, lda, b, ldb, c, ldc, cutoff);
+    }
+
+    template <typename T>
+    BasicDenseMatrix<T> multiply_strassen(const BasicDenseMatrix<T>& matrix1, const BasicDenseMatrix<T>& matrix2,
+                                          size_t cutoff) {
+        if (matrix1.cols() != matrix2.rows())
+            throw std::logic_error("matrices with wrong dimensions cannot be multiplied");
+        BasicDenseMatrix<T> result(matrix1.rows(), matrix2.cols());
+        strassen(matrix1.rows(), matrix2.cols(), matrix1.cols(), matrix1.data(), matrix1.stride(),
+                 matrix2.data(), matrix2.stride(), result.data(), result.stride(), cutoff);
+        return result;
+    }
+
+    template DenseMatrix multiply_strassen(const DenseMatrix&, const DenseMatrix&, size_t);
+    template FloatDenseMatrix multiply_strassen(const FloatDenseMatrix&, const FloatDenseMatrix&, size_t);
+}
@@ -0,0 +1,192 @@
+#include "structure.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "lu.h"
+#include "solve.h"
+#include "symmetric.h"
+#include "transpose.h"
+#include "trsm.h"
+
+namespace algebra {
+    namespace {
+        void check_structure(size_t rows, size_t cols, const Structure& structure) {
+            if (rows != cols)
+                throw std::logic_error("non-square matrix");
+            if (structure.size != rows)
+                throw std::logic_error("structure of a matrix of another size");
+        }
+
+        // Compares the elements within band of the diagonal with their mirror images, tile by
+        // tile so that the columns read stay in cache
+        template <typename Row>
+        bool mirrored(size_t n, size_t band, Row row_of) {
+            for (size_t i0 = 0; i0 < n; i0 += kTransposeBlock) {
+                size_t i1 = std::min(n, i0 + kTransposeBlock);
+                size_t j_first = i0 > band ? (i0 - band) / kTransposeBlock * kTransposeBlock : 0;
+                for (size_t j0 = j_first; j0 <= i0; j0 += kTransposeBlock)
+                    for (size_t i = i0; i < i1; ++i) {
+                        const double* row = row_of(i);
+                        size_t j1 = std::min(i, j0 + kTransposeBlock);
+                        for (size_t j = std::max(j0, i > band ? i - band : 0); j < j1; ++j)
+                            if (row[j] != row_of(j)[i])
+                                return false;
+                    }
+            }
+            return true;
+        }
+
+        // One pass over n rows read through row(i), for either storage
+        template <typename Row>
+        Structure probe_rows(size_t n, Row row_of) {
+            Structure structure;
+            structure.size = n;
+            for (size_t i = 0; i < n; ++i) {
+                const double* row = row_of(i);
+                // Only the elements farther from the diagonal than the bandwidths so far can widen them
+                size_t lower = structure.lower_bandwidth;
+                for (size_t j = 0; j + lower < i; ++j)
+                    if (row[j] != 0) {
+                        structure.lower_bandwidth = i - j;
+                        break;
+                    }
+                size_t upper = structure.upper_bandwidth;
+                for (size_t j = n; j > i + upper + 1; --j)
+                    if (row[j - 1] != 0) {
+                        structure.upper_bandwidth = j - 1 - i;
+                        break;
+                    }
+            }
+            // A symmetric matrix has equal bandwidths, and only its band needs comparing
+            structure.symmetric = structure.lower_bandwidth == structure.upper_bandwidth &&
+                                  mirrored(n, structure.lower_bandwidth, row_of);
+            return structure;
+        }
+
+        DenseMatrix identity(size_t n) {
+            DenseMatrix result(n, n);
+            for (size_t i = 0; i < n; ++i)
+                result(i, i) = 1;
+            return result;
+        }
+
+        // The Factorization would report a singular matrix with its own message
+        DenseMatrix solve_lu(LuDecomposition lu, DenseMatrix b, const char* singular) {
+            if (lu.singular)
+                throw std::logic_error(singular);
+            return Factorization(std::move(lu)).solve(std::move(b));
+        }
+
+        // A X = B along the route of the structure, with B the identity for the inverse
+        DenseMatrix solve_routed(const DenseMatrix& a, DenseMatrix b, const Structure& structure, bool inverse) {
+            const char* singular = inverse ? "matrix is singular, cannot be inverted" : "matrix is singular, cannot solve";
+            size_t n = a.rows();
+            if (b.rows() != n)
+                throw std::logic_error("right-hand side with wrong number of rows");
+            if (structure.lower_triangular() || structure.upper_triangular()) {
+                for (size_t i = 0; i < n; ++i)
+                    if (a(i, i) == 0)
+                        throw std::logic_error(singular);
+                if (structure.diagonal()) {
+                    for (size_t i = 0; i < n; ++i) {
+                        double* row = b.row(i);
+                        for (size_t c = 0; c < b.cols(); ++c)
+                            row[c] /= a(i, i);
+                    }
+                } else if (structure.lower_triangular()) {
+                    trsm_lower(n, b.cols(), a.data(), a.stride(), b.data(), b.stride());
+                } else {
+                    trsm_upper(n, b.cols(), a.data(), a.stride(), b.data(), b.stride());
+                }
+                return b;
+            }
+            if (structure.banded())
+                return solve_lu(lu_factor_banded(a, structure.lower_bandwidth, structure.upper_bandwidth),
+                                std::move(b), singular);
+            if (structure.symmetric) {
+                CholeskyDecomposition cholesky = cholesky_factor(a);
+                if (cholesky.positive_definite)
+                    return inverse ? algebra::inverse(cholesky) : solve(cholesky, std::move(b));
+                if (n < kLdltThreshold) {
+                    LdltDecomposition ldlt = ldlt_factor(a);
+                    if (ldlt.singular)
+                        throw std::logic_error(singular);
+                    return solve(ldlt, std::move(b));
+                }
+            }
+            return solve_lu(lu_factor(a), std::move(b), singular);
+        }
+    }
+
+    Structure probe(const DenseMatrix& matrix) {
+        if (matrix.rows() != matrix.cols())
+            throw std::logic_error("non-square matrix");
+        return probe_rows(matrix.rows(), [&](size_t i) { return matrix.row(i); });
+    }
+
+    Structure probe(const Matrix& matrix) {
+        // Every row is scanned to its n-th element, a ragged one is not square either
+        for (const Vector& row : matrix)
+            if (row.size() != matrix.size())
+                throw std::logic_error("non-square matrix");
+        return probe_rows(matrix.size(), [&](size_t i) { return matrix[i].data(); });
+    }
+
+    double determinant(const DenseMatrix& matrix, const Structure& structure) {
+        check_structure(matrix.rows(), matrix.cols(), structure);
+        size_t n = matrix.rows();
+        if (structure.lower_triangular() || structure.upper_triangular()) {
+            double det = 1;
+            for (size_t i = 0; i < n; ++i)
+                det *= matrix(i, i);
+            return det;
+        }
+        if (structure.banded())
+            return determinant(lu_factor_banded(matrix, structure.lower_bandwidth, structure.upper_bandwidth));
+        if (structure.symmetric) {
+            CholeskyDecomposition cholesky = cholesky_factor(matrix);
+            if (cholesky.positive_definite)
+                return determinant(cholesky);
+            if (n < kLdltThreshold)
+                return determinant(ldlt_factor(matrix));
+        }
+        return determinant(lu_factor(matrix));
+    }
+
+    double determinant(const Matrix& matrix, const Structure& structure) {
+        if (matrix.empty())
+            return 1;
+        check_structure(matrix.size(), matrix[0].size(), structure);
+        // The closed forms of algebra::determinant
+        if (matrix.size() <= 2)
+            return determinant(matrix);
+        return determinant(DenseMatrix(matrix), structure);
+    }
+
+    DenseMatrix inverse(const DenseMatrix& matrix, const Structure& structure) {
+        check_structure(matrix.rows(), matrix.cols(), structure);
+        return solve_routed(matrix, identity(matrix.rows()), structure, true);
+    }
+
+    Matrix inverse(const Matrix& matrix, const Structure& structure) {
+        if (matrix.empty())
+            return Matrix();
+        check_structure(matrix.size(), matrix[0].size(), structure);
+        return inverse(DenseMatrix(matrix), structure).to_matrix();
+    }
+
+    DenseMatrix solve(const DenseMatrix& a, DenseMatrix b, const Structure& structure) {
+        check_structure(a.rows(), a.cols(), structure);
+        return solve_routed(a, std::move(b), structure, false);
+    }
+
+    Matrix solve(const Matrix& a, const Matrix& b, const Structure& structure) {
+        check_structure(a.size(), a.empty() ? 0 : a[0].size(), structure);
+        if (b.size() != a.size())
+            throw std::logic_error("right-hand side with wrong number of rows");
+        if (b.empty())
+            return Matrix();
+        return solve(DenseMatrix(a), DenseMatrix(b), structure).to_matrix();
+    }
+}
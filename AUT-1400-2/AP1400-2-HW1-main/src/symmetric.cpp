@@ -0,0 +1,333 @@
+#include "symmetric.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include "gemm.h"
+#include "thread_pool.h"
+#include "transpose.h"
+#include "trsm.h"
+
+namespace algebra {
+    namespace {
+        void check_square(const DenseMatrix& matrix) {
+            if (matrix.rows() != matrix.cols())
+                throw std::logic_error("non-square matrix");
+        }
+
+        // Cholesky-Banachiewicz on the diagonal block [k, k + nb): row by row, every element is
+        // the dot product of two rows of L already computed. False at a non-positive pivot.
+        bool factor_diagonal_block(DenseMatrix& a, size_t k, size_t nb) {
+            for (size_t i = k; i < k + nb; ++i) {
+                double* li = a.row(i);
+                for (size_t j = k; j <= i; ++j) {
+                    const double* lj = a.row(j);
+                    double s = li[j];
+                    for (size_t p = k; p < j; ++p)
+                        s -= li[p] * lj[p];
+                    if (j < i) {
+                        li[j] = s / lj[j];
+                        continue;
+                    }
+                    // Also false for NaN
+                    if (!(s > 0))
+                        return false;
+                    li[i] = std::sqrt(s);
+                }
+            }
+            return true;
+        }
+
+        // L21 = A21 * L11^-T: every row below the diagonal block is a forward substitution with L11
+        void solve_panel(DenseMatrix& a, size_t k, size_t nb) {
+            parallel_for(k + nb, a.rows(), nb * nb / 2, [&](size_t lo, size_t hi) {
+                for (size_t r = lo; r < hi; ++r) {
+                    double* row = a.row(r);
+                    for (size_t j = k; j < k + nb; ++j) {
+                        const double* lj = a.row(j);
+                        double s = row[j];
+                        for (size_t p = k; p < j; ++p)
+                            s -= row[p] * lj[p];
+                        row[j] = s / lj[j];
+                    }
+                }
+            });
+        }
+
+        // A22 -= L21 * L21^T on and below the diagonal only, one gemm per block row
+        void update_trailing(DenseMatrix& a, size_t k, size_t nb) {
+            size_t first = k + nb;
+            size_t n = a.rows();
+            size_t stride = a.stride();
+            // L21^T, contiguous for the gemm
+            DenseMatrix panel(nb, n - first);
+            transpose(n - first, nb, a.row(first) + k, stride, panel.data(), panel.stride());
+            for (size_t i0 = first; i0 < n; i0 += kCholeskyBlockSize) {
+                size_t rows = std::min(kCholeskyBlockSize, n - i0);
+                gemm(rows, i0 + rows - first, nb, -1, a.row(i0) + k, stride, panel.data(), panel.stride(),
+                     a.row(i0) + first, stride);
+            }
+        }
+
+        // Zero above the diagonal, where the input was left as it was
+        void clear_upper(DenseMatrix& a) {
+            for (size_t i = 0; i < a.rows(); ++i)
+                std::fill(a.row(i) + i + 1, a.row(i) + a.cols(), 0.0);
+        }
+
+        // Row i of the result is row permutation[i] of b, or the other way round with inverse
+        DenseMatrix permute_rows(const DenseMatrix& b, const std::vector<size_t>& permutation, bool inverse) {
+            DenseMatrix result(b.rows(), b.cols());
+            for (size_t i = 0; i < b.rows(); ++i) {
+                const double* src = b.row(inverse ? i : permutation[i]);
+                std::copy(src, src + b.cols(), result.row(inverse ? permutation[i] : i));
+            }
+            return result;
+        }
+
+        DenseMatrix identity(size_t n) {
+            DenseMatrix result(n, n);
+            for (size_t i = 0; i < n; ++i)
+                result(i, i) = 1;
+            return result;
+        }
+
+        void check_rhs(size_t n, const DenseMatrix& b) {
+            if (b.rows() != n)
+                throw std::logic_error("right-hand side with wrong number of rows");
+        }
+    }
+
+    CholeskyDecomposition cholesky_factor(DenseMatrix matrix) {
+        check_square(matrix);
+        size_t n = matrix.rows();
+        CholeskyDecomposition out;
+        size_t block = n < kCholeskyBlockThreshold ? std::max<size_t>(n, 1) : kCholeskyBlockSize;
+        // Right-looking: factor a diagonal block, solve the panel below it, update the rest
+        for (size_t k = 0; k < n; k += block) {
+            size_t nb = std::min(block, n - k);
+            if (!factor_diagonal_block(matrix, k, nb)) {
+                out.positive_definite = false;
+                break;
+            }
+            if (k + nb == n)
+                break;
+            solve_panel(matrix, k, nb);
+            update_trailing(matrix, k, nb);
+        }
+        clear_upper(matrix);
+        out.l = std::move(matrix);
+        return out;
+    }
+
+    LdltDecomposition ldlt_factor(DenseMatrix a) {
+        check_square(a);
+        size_t n = a.rows();
+        LdltDecomposition out;
+        out.diagonal.assign(n, 0);
+        out.off_diagonal.assign(n, 0);
+        out.permutation.resize(n);
+        std::iota(out.permutation.begin(), out.permutation.end(), 0);
+        // Bound on the growth of the elements, (1 + sqrt(17)) / 8
+        const double alpha = (1 + std::sqrt(17.0)) / 8;
+        // Columns of L of the current step, computed before the trailing matrix is overwritten
+        std::vector<double> w0(n), w1(n);
+        for (size_t k = 0; k < n;) {
+            // Largest element below the diagonal in column k
+            double absakk = std::abs(a(k, k));
+            double colmax = 0;
+            size_t imax = k;
+            for (size_t i = k + 1; i < n; ++i)
+                if (std::abs(a(i, k)) > colmax) {
+                    colmax = std::abs(a(i, k));
+                    imax = i;
+                }
+            if (std::max(absakk, colmax) == 0) {
+                // A zero column: D(k) = 0 and nothing to eliminate
+                out.singular = true;
+                ++k;
+                continue;
+            }
+            size_t step = 1;
+            size_t kp = k;
+            if (absakk < alpha * colmax) {
+                // Largest element off the diagonal in row and column imax of the trailing matrix
+                double rowmax = 0;
+                for (size_t j = k; j < imax; ++j)
+                    rowmax = std::max(rowmax, std::abs(a(imax, j)));
+                for (size_t j = imax + 1; j < n; ++j)
+                    rowmax = std::max(rowmax, std::abs(a(j, imax)));
+                if (absakk * rowmax >= alpha * colmax * colmax) {
+                    kp = k;
+                } else if (std::abs(a(imax, imax)) >= alpha * rowmax) {
+                    kp = imax;
+                } else {
+                    kp = imax;
+                    step = 2;
+                }
+            }
+            // Exchange kp with the last index of the pivot block, in the rows of L computed so
+            // far and symmetrically in the lower triangle of the trailing matrix
+            size_t kk = k + step - 1;
+            if (kp != kk) {
+                std::swap_ranges(a.row(kk), a.row(kk) + k, a.row(kp));
+                for (size_t j = kp + 1; j < n; ++j)
+                    std::swap(a(j, kk), a(j, kp));
+                for (size_t j = kk + 1; j < kp; ++j)
+                    std::swap(a(j, kk), a(kp, j));
+                std::swap(a(kk, kk), a(kp, kp));
+                if (step == 2)
+                    std::swap(a(k + 1, k), a(kp, k));
+                std::swap(out.permutation[kk], out.permutation[kp]);
+            }
+            size_t next = k + step;
+            if (step == 1) {
+                double d = a(k, k);
+                out.diagonal[k] = d;
+                for (size_t j = next; j < n; ++j)
+                    w0[j] = a(j, k) / d;
+            } else {
+                // The 2x2 block [d0 e; e d1] is inverted through its scaled form
+                double d0 = a(k, k), e = a(k + 1, k), d1 = a(k + 1, k + 1);
+                out.diagonal[k] = d0;
+                out.diagonal[k + 1] = d1;
+                out.off_diagonal[k] = e;
+                a(k + 1, k) = 0;
+                double s1 = d1 / e, s0 = d0 / e;
+                double t = 1 / (s1 * s0 - 1) / e;
+                for (size_t j = next; j < n; ++j) {
+                    w0[j] = t * (s1 * a(j, k) - a(j, k + 1));
+                    w1[j] = t * (s0 * a(j, k + 1) - a(j, k));
+                }
+            }
+            // A22 -= A21 * D^-1 * A21^T on and below the diagonal; the rows are independent
+            parallel_for(next, n, (n - next) * step / 2, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    double* row = a.row(i);
+                    double x0 = row[k];
+                    if (step == 1) {
+                        for (size_t j = next; j <= i; ++j)
+                            row[j] -= x0 * w0[j];
+                        row[k] = w0[i];
+                        continue;
+                    }
+                    double x1 = row[k + 1];
+                    for (size_t j = next; j <= i; ++j)
+                        row[j] -= x0 * w0[j] + x1 * w1[j];
+                    row[k] = w0[i];
+                    row[k + 1] = w1[i];
+                }
+            });
+            k = next;
+        }
+        clear_upper(a);
+        for (size_t i = 0; i < n; ++i)
+            a(i, i) = 1;
+        out.l = std::move(a);
+        return out;
+    }
+
+    double determinant(const CholeskyDecomposition& cholesky) {
+        if (!cholesky.positive_definite)
+            throw std::logic_error("matrix is not positive definite");
+        double det = 1;
+        for (size_t i = 0; i < cholesky.l.rows(); ++i)
+            det *= cholesky.l(i, i) * cholesky.l(i, i);
+        return det;
+    }
+
+    DenseMatrix inverse(const CholeskyDecomposition& cholesky) {
+        if (!cholesky.positive_definite)
+            throw std::logic_error("matrix is not positive definite");
+        const DenseMatrix& l = cholesky.l;
+        size_t n = l.rows();
+        // L^-1, lower triangular: a block of its columns is zero above the block, so it only
+        // needs the triangular solve with the trailing part of L
+        DenseMatrix linv = identity(n);
+        for (size_t j0 = 0; j0 < n; j0 += kCholeskyBlockSize) {
+            size_t nb = std::min(kCholeskyBlockSize, n - j0);
+            trsm_lower(n - j0, nb, l.row(j0) + j0, l.stride(), linv.row(j0) + j0, linv.stride());
+        }
+        // A^-1 = L^-T * L^-1 is symmetric: its lower triangle block row by block row, where the
+        // rows of L^-T start at the diagonal, then mirrored
+        DenseMatrix linvt = transpose(linv);
+        DenseMatrix result(n, n);
+        for (size_t i0 = 0; i0 < n; i0 += kCholeskyBlockSize) {
+            size_t rows = std::min(kCholeskyBlockSize, n - i0);
+            gemm(rows, i0 + rows, n - i0, linvt.row(i0) + i0, linvt.stride(), linv.row(i0), linv.stride(),
+                 result.row(i0), result.stride());
+        }
+        for (size_t i = 0; i < n; ++i)
+            for (size_t j = i + 1; j < n; ++j)
+                result(i, j) = result(j, i);
+        return result;
+    }
+
+    DenseMatrix solve(const CholeskyDecomposition& cholesky, DenseMatrix b) {
+        if (!cholesky.positive_definite)
+            throw std::logic_error("matrix is not positive definite");
+        const DenseMatrix& l = cholesky.l;
+        check_rhs(l.rows(), b);
+        // L * Y = B, then L^T * X = Y with L^T made contiguous for the blocked back substitution
+        trsm_lower(l.rows(), b.cols(), l.data(), l.stride(), b.data(), b.stride());
+        DenseMatrix lt = transpose(l);
+        trsm_upper(lt.rows(), b.cols(), lt.data(), lt.stride(), b.data(), b.stride());
+        return b;
+    }
+
+    double determinant(const LdltDecomposition& ldlt) {
+        // P A P^T has the determinant of A, and L is unit triangular
+        double det = 1;
+        for (size_t k = 0; k < ldlt.diagonal.size(); ++k) {
+            if (ldlt.off_diagonal[k] == 0) {
+                det *= ldlt.diagonal[k];
+                continue;
+            }
+            det *= ldlt.diagonal[k] * ldlt.diagonal[k + 1] - ldlt.off_diagonal[k] * ldlt.off_diagonal[k];
+            ++k;
+        }
+        return det;
+    }
+
+    DenseMatrix inverse(const LdltDecomposition& ldlt) {
+        if (ldlt.singular)
+            throw std::logic_error("matrix is singular, cannot be inverted");
+        return solve(ldlt, identity(ldlt.l.rows()));
+    }
+
+    DenseMatrix solve(const LdltDecomposition& ldlt, DenseMatrix b) {
+        if (ldlt.singular)
+            throw std::logic_error("matrix is singular, cannot solve");
+        const DenseMatrix& l = ldlt.l;
+        size_t n = l.rows();
+        check_rhs(n, b);
+        size_t nrhs = b.cols();
+        // A X = B is L D L^T (P X) = P B
+        DenseMatrix y = permute_rows(b, ldlt.permutation, false);
+        trsm_lower(n, nrhs, l.data(), l.stride(), y.data(), y.stride(), true);
+        for (size_t k = 0; k < n; ++k) {
+            double* r0 = y.row(k);
+            double e = ldlt.off_diagonal[k];
+            if (e == 0) {
+                for (size_t c = 0; c < nrhs; ++c)
+                    r0[c] /= ldlt.diagonal[k];
+                continue;
+            }
+            // [d0 e; e d1]^-1 = [d1 -e; -e d0] / (d0 d1 - e^2)
+            double d0 = ldlt.diagonal[k], d1 = ldlt.diagonal[k + 1];
+            double det = d0 * d1 - e * e;
+            double* r1 = y.row(k + 1);
+            for (size_t c = 0; c < nrhs; ++c) {
+                double y0 = r0[c], y1 = r1[c];
+                r0[c] = (d1 * y0 - e * y1) / det;
+                r1[c] = (d0 * y1 - e * y0) / det;
+            }
+            ++k;
+        }
+        DenseMatrix lt = transpose(l);
+        trsm_upper(n, nrhs, lt.data(), lt.stride(), y.data(), y.stride(), true);
+        return permute_rows(y, ldlt.permutation, true);
+    }
+}
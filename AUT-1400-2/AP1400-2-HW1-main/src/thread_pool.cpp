@@ -0,0 +1,155 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+
+namespace algebra {
+    namespace {
+        // Set while the current thread runs a chunk, nested loops then stay on this thread
+        thread_local bool in_parallel_region = false;
+
+        size_t hardware_threads() {
+            return std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+
+        size_t default_threads() {
+            if (const char* env = std::getenv("ALGEBRA_NUM_THREADS")) {
+                char* end = nullptr;
+                unsigned long threads = std::strtoul(env, &end, 10);
+                if (end != env && *end == '\0' && threads > 0)
+                    return threads;
+            }
+            return hardware_threads();
+        }
+
+        std::mutex global_pool_mutex;
+        // Held through shared_ptr so a resize never destroys a pool that is running a loop
+        std::shared_ptr<ThreadPool> global_pool_instance;
+
+        std::shared_ptr<ThreadPool> global_pool() {
+            std::lock_guard<std::mutex> lock(global_pool_mutex);
+            if (!global_pool_instance)
+                global_pool_instance = std::make_shared<ThreadPool>(default_threads());
+            return global_pool_instance;
+        }
+    }
+
+    ThreadPool::ThreadPool(size_t threads) {
+        for (size_t i = 1; i < threads; ++i)
+            workers_.emplace_back([this] { worker_loop(); });
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+    void ThreadPool::run(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body) {
+        if (begin >= end)
+            return;
+        if (workers_.empty() || in_parallel_region) {
+            body(begin, end);
+            return;
+        }
+        std::lock_guard<std::mutex> run_lock(run_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            body_ = &body;
+            begin_ = begin;
+            end_ = end;
+            next_chunk_ = 0;
+            pending_chunks_ = size();
+            error_ = nullptr;
+            ++generation_;
+        }
+        wake_.notify_all();
+        // The calling thread takes chunks too instead of sleeping
+        run_chunks();
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wait_for_condition(done_, lock, [this] { return pending_chunks_ == 0; });
+            body_ = nullptr;
+            std::swap(error, error_);
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void ThreadPool::worker_loop() {
+        size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wait_for_condition(wake_, lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_)
+                    return;
+                seen = generation_;
+            }
+            run_chunks();
+        }
+    }
+
+    void ThreadPool::run_chunks() {
+        for (;;) {
+            const std::function<void(size_t, size_t)>* body;
+            size_t lo, hi;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (body_ == nullptr || next_chunk_ == size())
+                    return;
+                size_t chunk = next_chunk_++;
+                // Chunk boundaries depend only on the range and the thread count
+                size_t n = end_ - begin_;
+                lo = begin_ + n * chunk / size();
+                hi = begin_ + n * (chunk + 1) / size();
+                body = body_;
+            }
+            in_parallel_region = true;
+            try {
+                if (lo < hi)
+                    (*body)(lo, hi);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_)
+                    error_ = std::current_exception();
+            }
+            in_parallel_region = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--pending_chunks_ == 0)
+                    done_.notify_all();
+            }
+        }
+    }
+
+    size_t num_threads() {
+        return global_pool()->size();
+    }
+
+    void set_num_threads(size_t threads) {
+        auto pool = std::make_shared<ThreadPool>(threads == 0 ? hardware_threads() : threads);
+        {
+            std::lock_guard<std::mutex> lock(global_pool_mutex);
+            std::swap(pool, global_pool_instance);
+        }
+        // The old pool joins its workers here, or in the last loop still using it
+    }
+
+    void parallel_for(size_t begin, size_t end, size_t work_per_item,
+                      const std::function<void(size_t, size_t)>& body) {
+        if (begin >= end)
+            return;
+        if (in_parallel_region || (end - begin) * work_per_item < kParallelThreshold) {
+            body(begin, end);
+            return;
+        }
+        global_pool()->run(begin, end, body);
+    }
+}
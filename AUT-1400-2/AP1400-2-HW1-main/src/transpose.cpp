@@ -0,0 +1,116 @@
+#include "transpose.h"
+
+#include <algorithm>
+#include <utility>
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace algebra {
+    namespace {
+        // Register tile of the element type: the kernel of the active tier for double, plain loops
+        // the compiler turns into shuffles for float
+        struct FloatTile {
+            static constexpr size_t size = 8;
+
+            void operator()(const float* a, size_t lda, float* b, size_t ldb) const {
+                float tile[size][size];
+                for (size_t i = 0; i < size; ++i)
+                    for (size_t j = 0; j < size; ++j)
+                        tile[j][i] = a[i * lda + j];
+                for (size_t i = 0; i < size; ++i)
+                    std::copy(tile[i], tile[i] + size, b + i * ldb);
+            }
+        };
+
+        struct DoubleTile {
+            size_t size = kernels().transpose_tile;
+            void (*kernel)(const double*, size_t, double*, size_t) = kernels().transpose_kernel;
+
+            void operator()(const double* a, size_t lda, double* b, size_t ldb) const { kernel(a, lda, b, ldb); }
+        };
+
+        // Rows [i0, i1) and columns [j0, j1) of A into B, by whole tiles and then the ragged edges
+        template <typename T, typename Tile>
+        void transpose_block(size_t i0, size_t i1, size_t j0, size_t j1, const T* a, size_t lda, T* b, size_t ldb,
+                             const Tile& tile) {
+            size_t t = tile.size;
+            size_t i_end = i0 + (i1 - i0) / t * t;
+            size_t j_end = j0 + (j1 - j0) / t * t;
+            for (size_t i = i0; i < i_end; i += t)
+                for (size_t j = j0; j < j_end; j += t)
+                    tile(a + i * lda + j, lda, b + j * ldb + i, ldb);
+            for (size_t i = i0; i < i1; ++i)
+                for (size_t j = i < i_end ? j_end : j0; j < j1; ++j)
+                    b[j * ldb + i] = a[i * lda + j];
+        }
+
+        template <typename T, typename Tile>
+        void transpose_tiled(size_t m, size_t n, const T* a, size_t lda, T* b, size_t ldb, const Tile& tile) {
+            size_t blocks = (n + kTransposeBlock - 1) / kTransposeBlock;
+            // Every thread owns blocks of output rows, i.e. of input columns
+            parallel_for(0, blocks, kTransposeBlock * m, [&](size_t lo, size_t hi) {
+                for (size_t jb = lo; jb < hi; ++jb) {
+                    size_t j0 = jb * kTransposeBlock;
+                    size_t j1 = std::min(n, j0 + kTransposeBlock);
+                    for (size_t i0 = 0; i0 < m; i0 += kTransposeBlock)
+                        transpose_block(i0, std::min(m, i0 + kTransposeBlock), j0, j1, a, lda, b, ldb, tile);
+                }
+            });
+        }
+
+        // Tile (i, j) and tile (j, i) are exchanged through a tile-sized buffer, the diagonal
+        // tiles are transposed onto themselves
+        template <typename T, typename Tile>
+        void transpose_inplace_tiled(size_t n, T* a, size_t lda, const Tile& tile) {
+            size_t t = tile.size;
+            size_t full = n / t * t;
+            size_t blocks = (full + kTransposeBlock - 1) / kTransposeBlock;
+            // A block row of the upper triangle with its mirror block column; no two of them
+            // share a tile. The first rows carry the most tiles but the ranges stay balanced
+            // enough for the memory bound loop.
+            parallel_for(0, blocks, kTransposeBlock * n, [&](size_t lo, size_t hi) {
+                T buffer[8 * 8];
+                for (size_t ib = lo; ib < hi; ++ib) {
+                    size_t i0 = ib * kTransposeBlock;
+                    size_t i1 = std::min(full, i0 + kTransposeBlock);
+                    for (size_t j0 = i0; j0 < full; j0 += kTransposeBlock) {
+                        size_t j1 = std::min(full, j0 + kTransposeBlock);
+                        for (size_t i = i0; i < i1; i += t)
+                            for (size_t j = std::max(j0, i); j < j1; j += t) {
+                                T* upper = a + i * lda + j;
+                                if (i == j) {
+                                    tile(upper, lda, upper, lda);
+                                    continue;
+                                }
+                                T* lower = a + j * lda + i;
+                                tile(upper, lda, buffer, t);
+                                tile(lower, lda, upper, lda);
+                                for (size_t r = 0; r < t; ++r)
+                                    std::copy(buffer + r * t, buffer + r * t + t, lower + r * lda);
+                            }
+                    }
+                }
+            });
+            // The rows and columns past the last whole tile
+            for (size_t i = full; i < n; ++i)
+                for (size_t j = 0; j < i; ++j)
+                    std::swap(a[i * lda + j], a[j * lda + i]);
+        }
+    }
+
+    void transpose(size_t m, size_t n, const double* a, size_t lda, double* b, size_t ldb) {
+        transpose_tiled(m, n, a, lda, b, ldb, DoubleTile());
+    }
+
+    void transpose(size_t m, size_t n, const float* a, size_t lda, float* b, size_t ldb) {
+        transpose_tiled(m, n, a, lda, b, ldb, FloatTile());
+    }
+
+    void transpose_inplace(size_t n, double* a, size_t lda) {
+        transpose_inplace_tiled(n, a, lda, DoubleTile());
+    }
+
+    void transpose_inplace(size_t n, float* a, size_t lda) {
+        transpose_inplace_tiled(n, a, lda, FloatTile());
+    }
+}
@@ -0,0 +1,81 @@
+#include "trsm.h"
+
+#include <algorithm>
+#include "gemm.h"
+#include "thread_pool.h"
+
+namespace algebra {
+    namespace {
+        // B[rows] -= T[rows, cols] * B[cols] for the block of the triangle at (first_row, first_col)
+        void update(size_t first_row, size_t rows, size_t first_col, size_t cols, size_t nrhs,
+                    const double* t, size_t ldt, double* b, size_t ldb) {
+            if (rows == 0)
+                return;
+            if (nrhs >= kTrsmGemmColumns) {
+                gemm(rows, nrhs, cols, -1.0, t + first_row * ldt + first_col, ldt, b + first_col * ldb, ldb,
+                     b + first_row * ldb, ldb);
+                return;
+            }
+            // A gemm would pad the few columns up to a whole register block
+            parallel_for(first_row, first_row + rows, cols * nrhs, [&](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    const double* ti = t + i * ldt;
+                    double* bi = b + i * ldb;
+                    for (size_t p = first_col; p < first_col + cols; ++p) {
+                        const double* bp = b + p * ldb;
+                        for (size_t c = 0; c < nrhs; ++c)
+                            bi[c] -= ti[p] * bp[c];
+                    }
+                }
+            });
+        }
+
+        // Substitution on the rows [first, first + nb) of B, which only depend on each other.
+        // The columns of B are independent and split across threads; every row is updated
+        // along its length, so the inner loop vectorizes.
+        void solve_block(size_t first, size_t nb, size_t nrhs, const double* t, size_t ldt, double* b, size_t ldb,
+                         bool unit_diagonal, bool lower) {
+            parallel_for(0, nrhs, nb * nb / 2, [&](size_t lo, size_t hi) {
+                for (size_t s = 0; s < nb; ++s) {
+                    size_t r = lower ? first + s : first + nb - 1 - s;
+                    const double* tr = t + r * ldt;
+                    double* br = b + r * ldb;
+                    size_t begin = lower ? first : r + 1;
+                    size_t end = lower ? r : first + nb;
+                    for (size_t i = begin; i < end; ++i) {
+                        const double* bi = b + i * ldb;
+                        for (size_t c = lo; c < hi; ++c)
+                            br[c] -= tr[i] * bi[c];
+                    }
+                    if (!unit_diagonal)
+                        for (size_t c = lo; c < hi; ++c)
+                            br[c] /= tr[r];
+                }
+            });
+        }
+    }
+
+    void trsm_lower(size_t n, size_t nrhs, const double* l, size_t ldt, double* b, size_t ldb, bool unit_diagonal) {
+        if (nrhs == 0)
+            return;
+        for (size_t k = 0; k < n; k += kTrsmBlock) {
+            size_t nb = std::min(kTrsmBlock, n - k);
+            solve_block(k, nb, nrhs, l, ldt, b, ldb, unit_diagonal, true);
+            // The rows below no longer depend on this block once its effect is subtracted
+            update(k + nb, n - k - nb, k, nb, nrhs, l, ldt, b, ldb);
+        }
+    }
+
+    void trsm_upper(size_t n, size_t nrhs, const double* u, size_t ldt, double* b, size_t ldb, bool unit_diagonal) {
+        if (nrhs == 0)
+            return;
+        // Blocks from the bottom up, the last one is the partial block
+        for (size_t end = n; end > 0;) {
+            size_t nb = end % kTrsmBlock == 0 ? kTrsmBlock : end % kTrsmBlock;
+            size_t k = end - nb;
+            solve_block(k, nb, nrhs, u, ldt, b, ldb, unit_diagonal, false);
+            update(0, k, k, nb, nrhs, u, ldt, b, ldb);
+            end = k;
+        }
+    }
+}
@@ -1,7 +1,33 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
 
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include "hw1.h"
+#include "block_matrix.h"
+#include "dense_matrix.h"
+#include "expression.h"
+#include "factorization_cache.h"
+#include "fixed_matrix.h"
+#include "format.h"
+#include "gemm.h"
+#include "lu.h"
+#include "matrix_batch.h"
+#include "matrix_file.h"
+#include "matrix_view.h"
+#include "out_of_core.h"
+#include "random.h"
+#include "simd.h"
+#include "solve.h"
+#include "sparse_matrix.h"
+#include "strassen.h"
+#include "structure.h"
+#include "symmetric.h"
+#include "thread_pool.h"
+#include "trsm.h"
 
 
 TEST(HW1Test, ZEROS) {
@@ -361,6 +387,1259 @@ TEST(HW1Test, BONUS) {
     EXPECT_NEAR(res2[2][2], 39/4.0, 0.03);
 }
 
+TEST(DenseMatrixTest, LAYOUT) {
+    Matrix matrix{{1, 2, 3}, {4, 5, 6}};
+    algebra::DenseMatrix dense{matrix};
 
+    // check the size and the alignment of every row
+    EXPECT_EQ(dense.rows(), 2);
+    EXPECT_EQ(dense.cols(), 3);
+    EXPECT_GE(dense.stride(), dense.cols());
+    for (size_t i{}; i < dense.rows(); i++)
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(dense.row(i)) % algebra::DenseMatrix::alignment, 0);
 
+    // check the round trip through the nested-vector layout
+    EXPECT_DOUBLE_EQ(dense(1, 2), 6);
+    EXPECT_TRUE(dense.to_matrix() == matrix);
 
+    // Caution: ragged matrices have no dense layout
+    EXPECT_THROW(algebra::DenseMatrix(Matrix{{1, 2}, {3}}), std::logic_error);
+}
+
+TEST(DenseMatrixTest, OVERLOADS) {
+    Matrix matrix1{{-1, 1.5, -1.75, -2}, {-2, 2.5, -2.75, -3}, {3, 3.5, -3.75, -4}, {4, 4.5, 4.75, -5}};
+    Matrix matrix2{algebra::random(4, 4, -3, 3)};
+    algebra::DenseMatrix dense1{matrix1};
+    algebra::DenseMatrix dense2{matrix2};
+
+    // check that every overload agrees with the Matrix version
+    auto expect_near = [](const algebra::DenseMatrix& dense, const Matrix& matrix) {
+        ASSERT_EQ(dense.rows(), matrix.size());
+        for (size_t i{}; i < matrix.size(); i++)
+            for (size_t j{}; j < matrix[i].size(); j++)
+                EXPECT_NEAR(dense(i, j), matrix[i][j], 1e-9);
+    };
+    expect_near(algebra::multiply(dense1, 2.5), algebra::multiply(matrix1, 2.5));
+    expect_near(algebra::multiply(dense1, dense2), algebra::multiply(matrix1, matrix2));
+    expect_near(algebra::sum(dense1, 1.5), algebra::sum(matrix1, 1.5));
+    expect_near(algebra::sum(dense1, dense2), algebra::sum(matrix1, matrix2));
+    expect_near(algebra::transpose(dense2), algebra::transpose(matrix2));
+    expect_near(algebra::minor(dense1, 1, 2), algebra::minor(matrix1, 1, 2));
+    expect_near(algebra::inverse(dense1), algebra::inverse(matrix1));
+    expect_near(algebra::concatenate(dense1, dense2, 0), algebra::concatenate(matrix1, matrix2, 0));
+    expect_near(algebra::concatenate(dense1, dense2, 1), algebra::concatenate(matrix1, matrix2, 1));
+    expect_near(algebra::ero_swap(dense2, 0, 3), algebra::ero_swap(matrix2, 0, 3));
+    expect_near(algebra::ero_multiply(dense2, 1, 3), algebra::ero_multiply(matrix2, 1, 3));
+    expect_near(algebra::ero_sum(dense2, 0, 2, 3), algebra::ero_sum(matrix2, 0, 2, 3));
+    expect_near(algebra::upper_triangular(dense1), algebra::upper_triangular(matrix1));
+    EXPECT_NEAR(algebra::determinant(dense1), -28.5, 0.03);
+
+    // Caution: the dense overloads throw the same errors
+    EXPECT_THROW(algebra::multiply(dense1, algebra::dense::ones(3, 2)), std::logic_error);
+    EXPECT_THROW(algebra::ero_swap(dense1, 0, 4), std::logic_error);
+}
+
+TEST(GemmTest, BLOCKED) {
+    // sizes that are not multiples of the register or cache blocks, and span several K panels
+    Matrix matrix1{algebra::random(67, 300, -1, 1)};
+    Matrix matrix2{algebra::random(300, 45, -1, 1)};
+    Matrix matrix{algebra::multiply(matrix1, matrix2)};
+
+    // check the size of the matrix
+    EXPECT_EQ(matrix.size(), 67);
+    EXPECT_EQ(matrix[0].size(), 45);
+
+    // check the value of the elements against the textbook dot products
+    for (size_t i{}; i < matrix.size(); i++)
+        for (size_t j{}; j < matrix[i].size(); j++) {
+            double dot{};
+            for (size_t k{}; k < matrix2.size(); k++)
+                dot += matrix1[i][k] * matrix2[k][j];
+            EXPECT_NEAR(matrix[i][j], dot, 1e-9);
+        }
+
+    // gemm accumulates into C
+    algebra::DenseMatrix a{Matrix{{1, 2}, {3, 4}}};
+    algebra::DenseMatrix c{algebra::dense::ones(2, 2)};
+    algebra::gemm(2, 2, 2, a.data(), a.stride(), a.data(), a.stride(), c.data(), c.stride());
+    EXPECT_TRUE(c.to_matrix() == (Matrix{{8, 11}, {16, 23}}));
+}
+
+TEST(SimdTest, TIERS) {
+    Matrix matrix1{algebra::random(67, 90, -2, 2)};
+    Matrix matrix2{algebra::random(90, 50, -2, 2)};
+    Matrix product{algebra::multiply(matrix1, matrix2)};
+    Matrix scaled{algebra::multiply(matrix1, -1.5)};
+    Matrix shifted{algebra::sum(matrix1, 0.25)};
+    Matrix doubled{algebra::sum(matrix1, matrix1)};
+
+    // every tier the CPU supports must agree with the one detected at startup
+    algebra::Isa detected{algebra::detected_isa()};
+    for (algebra::Isa isa : {algebra::Isa::scalar, algebra::Isa::sse2, algebra::Isa::avx2, algebra::Isa::avx512}) {
+        if (isa > detected) {
+            // Caution: tiers above the CPU cannot be forced
+            EXPECT_THROW(algebra::force_isa(isa), std::logic_error);
+            continue;
+        }
+        algebra::force_isa(isa);
+        EXPECT_EQ(algebra::active_isa(), isa);
+        Matrix tier_product{algebra::multiply(matrix1, matrix2)};
+        for (size_t i{}; i < product.size(); i++)
+            for (size_t j{}; j < product[i].size(); j++)
+                EXPECT_NEAR(tier_product[i][j], product[i][j], 1e-9) << algebra::isa_name(isa);
+        EXPECT_TRUE(algebra::multiply(matrix1, -1.5) == scaled) << algebra::isa_name(isa);
+        EXPECT_TRUE(algebra::sum(matrix1, 0.25) == shifted) << algebra::isa_name(isa);
+        EXPECT_TRUE(algebra::sum(matrix1, matrix1) == doubled) << algebra::isa_name(isa);
+    }
+    algebra::force_isa(detected);
+}
+
+TEST(ThreadPoolTest, PARALLEL_FOR) {
+    algebra::ThreadPool pool{4};
+    EXPECT_EQ(pool.size(), 4);
+
+    // every index is visited exactly once, in contiguous chunks
+    std::vector<int> visits(1000);
+    pool.run(0, visits.size(), [&](size_t lo, size_t hi) {
+        for (size_t i{lo}; i < hi; i++)
+            visits[i]++;
+    });
+    for (int count : visits)
+        EXPECT_EQ(count, 1);
+
+    // Caution: exceptions thrown by a chunk reach the caller
+    EXPECT_THROW(pool.run(0, 100, [](size_t lo, size_t) {
+        if (lo == 0)
+            throw std::logic_error("chunk failed");
+    }), std::logic_error);
+
+    // the pool is still usable after an exception
+    size_t total{};
+    pool.run(0, 10, [&](size_t lo, size_t hi) {
+        std::vector<int> nested(hi - lo);
+        // nested loops run on the calling thread
+        algebra::parallel_for(0, nested.size(), algebra::kParallelThreshold, [&](size_t a, size_t b) {
+            for (size_t i{a}; i < b; i++)
+                nested[i] = 1;
+        });
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int value : nested)
+            total += value;
+    });
+    EXPECT_EQ(total, 10);
+}
+
+TEST(ThreadPoolTest, DETERMINISTIC) {
+    Matrix matrix1{algebra::random(300, 200, -1, 1)};
+    Matrix matrix2{algebra::random(200, 500, -1, 1)};
+
+    // results are bit-identical whatever the thread count
+    size_t threads{algebra::num_threads()};
+    algebra::set_num_threads(1);
+    EXPECT_EQ(algebra::num_threads(), 1);
+    Matrix product1{algebra::multiply(matrix1, matrix2)};
+    Matrix transpose1{algebra::transpose(matrix2)};
+    Matrix upper1{algebra::upper_triangular(algebra::multiply(matrix1, algebra::transpose(matrix1)))};
+    algebra::set_num_threads(5);
+    EXPECT_EQ(algebra::num_threads(), 5);
+    EXPECT_TRUE(algebra::multiply(matrix1, matrix2) == product1);
+    EXPECT_TRUE(algebra::transpose(matrix2) == transpose1);
+    EXPECT_TRUE(algebra::upper_triangular(algebra::multiply(matrix1, algebra::transpose(matrix1))) == upper1);
+    algebra::set_num_threads(threads);
+}
+
+TEST(LuTest, DETERMINANT) {
+    // Caution: non-square matrices have no LU factorization
+    EXPECT_THROW(algebra::lu_factor(algebra::dense::ones(2, 3)), std::logic_error);
+
+    // an upper triangular matrix with its rows in reverse order: the determinant is the
+    // product of the diagonal times the sign of the reversal
+    size_t n{300};
+    Matrix matrix{algebra::random(n, n, -1, 1)};
+    double expected{(n * (n - 1) / 2) % 2 == 0 ? 1.0 : -1.0};
+    for (size_t i{}; i < n; i++) {
+        for (size_t j{}; j < i; j++)
+            matrix[i][j] = 0;
+        matrix[i][i] = (i % 2 == 0) ? 1.25 : -0.8;
+        expected *= matrix[i][i];
+    }
+    std::reverse(matrix.begin(), matrix.end());
+    EXPECT_NEAR(algebra::determinant(matrix) / expected, 1, 1e-12);
+
+    // the blocked and unblocked factorizations agree on a general matrix
+    algebra::DenseMatrix dense{algebra::dense::random(n, n, -1, 1)};
+    algebra::LuDecomposition blocked{algebra::lu_factor(dense)};
+    algebra::LuDecomposition unblocked{algebra::lu_factor_unblocked(dense)};
+    EXPECT_EQ(blocked.pivots, unblocked.pivots);
+    EXPECT_EQ(blocked.sign, unblocked.sign);
+    for (size_t i{}; i < n; i++)
+        for (size_t j{}; j < n; j++)
+            EXPECT_NEAR(blocked.lu(i, j), unblocked.lu(i, j), 1e-9);
+
+    // Caution: a zero column makes the matrix singular
+    Matrix singular{algebra::random(5, 5, 1, 2)};
+    for (auto& row : singular)
+        row[3] = 0;
+    EXPECT_TRUE(algebra::lu_factor(algebra::DenseMatrix(singular)).singular);
+    EXPECT_DOUBLE_EQ(algebra::determinant(singular), 0);
+}
+
+TEST(LuTest, INVERSE) {
+    // A * inverse(A) is the identity
+    size_t n{150};
+    Matrix matrix{algebra::random(n, n, -1, 1)};
+    Matrix product{algebra::multiply(matrix, algebra::inverse(matrix))};
+    for (size_t i{}; i < n; i++)
+        for (size_t j{}; j < n; j++)
+            EXPECT_NEAR(product[i][j], i == j ? 1 : 0, 1e-9);
+
+    // a permutation matrix is inverted by its transpose
+    Matrix permutation{{0, 1, 0}, {0, 0, 1}, {1, 0, 0}};
+    EXPECT_TRUE(algebra::inverse(permutation) == algebra::transpose(permutation));
+
+    // Caution: the zero pivot of a singular matrix is reported
+    Matrix singular{{1, 2, 3}, {2, 4, 6}, {1, 0, 1}};
+    EXPECT_THROW(algebra::inverse(singular), std::logic_error);
+    EXPECT_THROW(algebra::inverse(algebra::DenseMatrix(singular)), std::logic_error);
+}
+
+TEST(HW1Test, ERO_INPLACE) {
+    Matrix matrix{algebra::random(4, 3, 0, 4)};
+    Matrix ero{matrix};
+    const double* row_buffer{ero[2].data()};
+
+    // Caution: r1 or r2 inputs are out of range
+    EXPECT_THROW(algebra::ero_swap_inplace(ero, 0, 4), std::logic_error);
+    EXPECT_THROW(algebra::ero_sum_inplace(ero, 4, 1, 0), std::logic_error);
+
+    // the in-place operations agree with the copying ones
+    algebra::ero_swap_inplace(ero, 2, 3);
+    EXPECT_TRUE(ero == algebra::ero_swap(matrix, 2, 3));
+    // swapping exchanges the row buffers instead of copying elements
+    EXPECT_EQ(ero[3].data(), row_buffer);
+    algebra::ero_multiply_inplace(ero, 1, 1.5);
+    algebra::ero_sum_inplace(ero, 0, 2, 3);
+    Matrix expected{algebra::ero_sum(algebra::ero_multiply(algebra::ero_swap(matrix, 2, 3), 1, 1.5), 0, 2, 3)};
+    for (size_t i{}; i < ero.size(); i++)
+        for (size_t j{}; j < ero[i].size(); j++)
+            EXPECT_DOUBLE_EQ(ero[i][j], expected[i][j]);
+
+    // the dense versions work the same way
+    algebra::DenseMatrix dense{matrix};
+    algebra::ero_swap_inplace(dense, 2, 3);
+    algebra::ero_multiply_inplace(dense, 1, 1.5);
+    algebra::ero_sum_inplace(dense, 0, 2, 3);
+    EXPECT_TRUE(dense.to_matrix() == ero);
+}
+
+TEST(ExpressionTest, FUSED) {
+    Matrix matrix1{algebra::random(40, 30, -5, 5)};
+    Matrix matrix2{algebra::random(40, 30, -5, 5)};
+    algebra::DenseMatrix dense1{matrix1};
+    algebra::DenseMatrix dense2{matrix2};
+
+    // one pass gives the same elements as the chain of eager calls
+    algebra::DenseMatrix fused{algebra::evaluate(algebra::lazy(dense1) * 2.0 + algebra::lazy(dense2) * 3.0 - 1.0)};
+    Matrix eager{algebra::sum(algebra::sum(algebra::multiply(matrix1, 2.0), algebra::multiply(matrix2, 3.0)), -1.0)};
+    EXPECT_EQ(fused.rows(), 40);
+    EXPECT_EQ(fused.cols(), 30);
+    for (size_t i{}; i < eager.size(); i++)
+        for (size_t j{}; j < eager[i].size(); j++)
+            EXPECT_NEAR(fused(i, j), eager[i][j], 1e-12);
+
+    // both layouts can be mixed and assigned into a nested-vector matrix
+    Matrix nested;
+    algebra::assign(nested, algebra::lazy(matrix1) - algebra::lazy(dense2));
+    ASSERT_EQ(nested.size(), 40);
+    for (size_t i{}; i < nested.size(); i++)
+        for (size_t j{}; j < nested[i].size(); j++)
+            EXPECT_DOUBLE_EQ(nested[i][j], matrix1[i][j] - matrix2[i][j]);
+
+    // the destination may appear in its own expression
+    algebra::assign(dense1, -algebra::lazy(dense1) + algebra::lazy(dense1) * 0.5);
+    for (size_t i{}; i < matrix1.size(); i++)
+        for (size_t j{}; j < matrix1[i].size(); j++)
+            EXPECT_DOUBLE_EQ(dense1(i, j), -0.5 * matrix1[i][j]);
+
+    // Caution: the operands must have the same dimensions
+    Matrix other{algebra::random(30, 40, -5, 5)};
+    EXPECT_THROW(algebra::lazy(matrix1) + algebra::lazy(other), std::logic_error);
+    try {
+        algebra::lazy(matrix1) - algebra::lazy(other);
+        ADD_FAILURE() << "no exception";
+    } catch (const std::logic_error& error) {
+        EXPECT_STREQ(error.what(), "matrices with different dimensions cannot be subtracted");
+    }
+    // Caution: ragged rows would be read past their end, they are rejected
+    Matrix ragged{{1, 2}, {3}};
+    EXPECT_THROW(algebra::lazy(ragged), std::logic_error);
+    EXPECT_THROW(algebra::sum(ragged, ragged), std::logic_error);
+    EXPECT_THROW(algebra::multiply(ragged, 2.0), std::logic_error);
+    EXPECT_THROW(algebra::sum(Matrix{{1, 2}, {3, 4}}, Matrix{{1, 2}, {3}}), std::logic_error);
+}
+
+TEST(MatrixViewTest, MINOR) {
+    Matrix matrix{algebra::random(6, 6, -5, 5)};
+    algebra::ConstMatrixView full{algebra::view(matrix)};
+    EXPECT_EQ(full.rows(), 6);
+    EXPECT_EQ(full.cols(), 6);
+
+    // a minor view reads the same elements as the copied minor, minors of minors too
+    algebra::ConstMatrixView minor1{algebra::minor(full, 2, 4)};
+    EXPECT_TRUE(minor1.to_matrix() == algebra::minor(matrix, 2, 4));
+    algebra::ConstMatrixView minor2{algebra::minor(minor1, 3, 0)};
+    EXPECT_TRUE(minor2.to_matrix() == algebra::minor(algebra::minor(matrix, 2, 4), 3, 0));
+    EXPECT_NEAR(algebra::determinant(minor2), algebra::determinant(algebra::minor(algebra::minor(matrix, 2, 4), 3, 0)), 1e-9);
+
+    // views do not copy: changes to the matrix show through
+    matrix[0][0] = 42;
+    EXPECT_EQ(minor1(0, 0), 42);
+
+    // Caution: indices out of range
+    EXPECT_THROW(algebra::minor(minor2, 4, 0), std::logic_error);
+}
+
+TEST(MatrixViewTest, SUBMATRIX) {
+    Matrix matrix{algebra::random(8, 10, -5, 5)};
+    algebra::DenseMatrix dense{matrix};
+
+    // every other row of rows 1..5 and columns 2..4
+    algebra::ConstMatrixView sub{algebra::view(dense).submatrix(1, 2, 3, 3, 2, 1)};
+    ASSERT_EQ(sub.rows(), 3);
+    for (size_t i{}; i < 3; i++)
+        for (size_t j{}; j < 3; j++)
+            EXPECT_EQ(sub(i, j), matrix[1 + 2 * i][2 + j]);
+
+    // the read-only functions accept views and agree with the copying path
+    Matrix copy{sub.to_matrix()};
+    EXPECT_TRUE(algebra::transpose(sub) == algebra::transpose(copy));
+    EXPECT_TRUE(algebra::sum(sub, sub) == algebra::sum(copy, copy));
+    EXPECT_TRUE(algebra::multiply(sub, 2) == algebra::multiply(copy, 2));
+    EXPECT_TRUE(algebra::concatenate(sub, sub, 1) == algebra::concatenate(copy, copy, 1));
+    EXPECT_TRUE(algebra::upper_triangular(sub) == algebra::upper_triangular(copy));
+
+    // a submatrix of a minor skips the same row
+    algebra::ConstMatrixView skipped{algebra::minor(algebra::view(matrix), 3, 0).submatrix(2, 0, 3, 2)};
+    EXPECT_EQ(skipped(0, 0), matrix[2][1]);
+    EXPECT_EQ(skipped(1, 0), matrix[4][1]);
+
+    // writable views change the viewed matrix in place
+    algebra::ero_sum_inplace(algebra::view(matrix).submatrix(0, 5, 8, 5), 0, 1, 1);
+    EXPECT_DOUBLE_EQ(matrix[1][5], dense(1, 5) + dense(0, 5));
+    EXPECT_EQ(matrix[1][4], dense(1, 4));
+
+    // Caution: the window does not fit
+    EXPECT_THROW(algebra::view(matrix).submatrix(6, 0, 2, 2, 2, 1), std::logic_error);
+}
+
+TEST(SparseMatrixTest, CONVERSION) {
+    Matrix matrix{{0, 2, 0, 0}, {1, 0, 0, 3}, {0, 0, 0, 0}};
+    algebra::SparseMatrix csr{matrix};
+    EXPECT_EQ(csr.nnz(), 3);
+    EXPECT_EQ(csr.format(), algebra::SparseFormat::csr);
+    EXPECT_EQ(csr.offsets(), (std::vector<size_t>{0, 1, 3, 3}));
+    EXPECT_EQ(csr.indices(), (std::vector<size_t>{1, 0, 3}));
+    EXPECT_EQ(csr(1, 3), 3);
+    EXPECT_EQ(csr(2, 2), 0);
+    EXPECT_TRUE(csr.to_matrix() == matrix);
+
+    // csc stores the same nonzeros column by column
+    algebra::SparseMatrix csc{matrix, algebra::SparseFormat::csc};
+    EXPECT_EQ(csc.offsets(), (std::vector<size_t>{0, 1, 2, 2, 3}));
+    EXPECT_TRUE(csc.to_matrix() == matrix);
+    EXPECT_TRUE(csc == csr);
+    EXPECT_TRUE(csc.convert(algebra::SparseFormat::csr) == csr);
+
+    // duplicate triplets are added up
+    algebra::SparseMatrix built{algebra::SparseMatrix::from_triplets(3, 4, {{1, 3, 1}, {0, 1, 2}, {1, 0, 1}, {1, 3, 2}})};
+    EXPECT_TRUE(built == csr);
+    EXPECT_TRUE(algebra::transpose(csr).to_matrix() == algebra::transpose(matrix));
+
+    // Caution: triplets out of range
+    EXPECT_THROW(algebra::SparseMatrix::from_triplets(3, 4, {{3, 0, 1}}), std::logic_error);
+}
+
+TEST(SparseMatrixTest, PRODUCTS) {
+    // about 5% nonzeros, kept in a dense copy to check against
+    std::vector<algebra::Triplet> triplets1, triplets2;
+    Matrix random1{algebra::random(120, 90, 0, 1)};
+    Matrix random2{algebra::random(90, 70, 0, 1)};
+    for (size_t i{}; i < 120; i++)
+        for (size_t j{}; j < 90; j++)
+            if (random1[i][j] < 0.05)
+                triplets1.push_back({i, j, random1[i][j] - 0.5});
+    for (size_t i{}; i < 90; i++)
+        for (size_t j{}; j < 70; j++)
+            if (random2[i][j] < 0.05)
+                triplets2.push_back({i, j, random2[i][j] + 1});
+    algebra::SparseMatrix sparse1{algebra::SparseMatrix::from_triplets(120, 90, triplets1)};
+    algebra::SparseMatrix sparse2{algebra::SparseMatrix::from_triplets(90, 70, triplets2, algebra::SparseFormat::csc)};
+    Matrix dense1{sparse1.to_matrix()};
+    Matrix dense2{sparse2.to_matrix()};
+    Matrix expected{algebra::multiply(dense1, dense2)};
+
+    auto expect_near = [](const Matrix& actual, const Matrix& expected) {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t i{}; i < actual.size(); i++)
+            for (size_t j{}; j < actual[i].size(); j++)
+                EXPECT_NEAR(actual[i][j], expected[i][j], 1e-12);
+    };
+    expect_near(algebra::multiply(sparse1, sparse2).to_matrix(), expected);
+    expect_near(algebra::multiply(sparse1, dense2), expected);
+
+    // sparse times vector in both layouts
+    Vector vector(90);
+    for (size_t j{}; j < vector.size(); j++)
+        vector[j] = j % 7 - 3.0;
+    Matrix column{algebra::multiply(dense1, algebra::transpose(Matrix{vector}))};
+    Vector product{algebra::multiply(sparse1, vector)};
+    Vector product_csc{algebra::multiply(sparse1.convert(algebra::SparseFormat::csc), vector)};
+    for (size_t i{}; i < product.size(); i++) {
+        EXPECT_NEAR(product[i], column[i][0], 1e-12);
+        EXPECT_NEAR(product_csc[i], column[i][0], 1e-12);
+    }
+
+    // sum merges the nonzeros of operands in different layouts
+    algebra::SparseMatrix twice{algebra::sum(sparse1, sparse1.convert(algebra::SparseFormat::csc))};
+    EXPECT_EQ(twice.nnz(), sparse1.nnz());
+    EXPECT_TRUE(twice == algebra::multiply(sparse1, 2.0));
+    // Caution: values that cancel are dropped like any other zero, not stored
+    algebra::SparseMatrix dense{Matrix{{1, 2}, {3, 4}}};
+    algebra::SparseMatrix cancelled{algebra::sum(dense, algebra::multiply(dense, -1.0))};
+    EXPECT_EQ(cancelled.nnz(), 0);
+    EXPECT_TRUE(cancelled.to_matrix() == algebra::zeros(2, 2));
+    algebra::SparseMatrix partly{algebra::sum(dense, algebra::SparseMatrix{Matrix{{-1, 0}, {0, 1}}})};
+    EXPECT_EQ(partly.nnz(), 3);
+    EXPECT_TRUE(partly.to_matrix() == (Matrix{{0, 2}, {3, 5}}));
+
+    // Caution: dimensions must match
+    EXPECT_THROW(algebra::multiply(sparse2, sparse1), std::logic_error);
+    EXPECT_THROW(algebra::sum(sparse1, sparse2), std::logic_error);
+}
+
+TEST(FixedMatrixTest, CONSTEXPR) {
+    // everything is computed by the compiler
+    constexpr algebra::FixedMatrix<double, 2, 2> small{{4, 7, 2, 6}};
+    static_assert(algebra::determinant(small) == 10, "2x2 determinant");
+    static_assert(algebra::inverse(small)(0, 1) == -0.7, "2x2 inverse");
+    static_assert(algebra::transpose(small)(0, 1) == 2, "transpose");
+    constexpr algebra::FixedMatrix<double, 3, 3> diagonal{{2, 0, 0, 0, 4, 0, 0, 0, 8}};
+    static_assert(algebra::inverse(diagonal)(2, 2) == 0.125, "3x3 inverse");
+    static_assert(algebra::determinant(algebra::FixedMatrix<int, 4, 4>::identity()) == 1, "4x4 determinant");
+    EXPECT_EQ(algebra::determinant(small), 10);
+}
+
+TEST(FixedMatrixTest, DYNAMIC) {
+    // every closed form and the elimination used from 5x5 on agree with the dynamic versions
+    auto check = [](auto fixed) {
+        Matrix matrix{fixed.to_matrix()};
+        EXPECT_NEAR(algebra::determinant(fixed), algebra::determinant(matrix), 1e-9);
+        Matrix inverse{algebra::inverse(fixed).to_matrix()};
+        Matrix expected{algebra::inverse(matrix)};
+        for (size_t i{}; i < matrix.size(); i++)
+            for (size_t j{}; j < matrix.size(); j++)
+                EXPECT_NEAR(inverse[i][j], expected[i][j], 1e-9);
+        EXPECT_TRUE(algebra::multiply(fixed, fixed).to_matrix() == algebra::multiply(matrix, matrix));
+        EXPECT_TRUE(algebra::transpose(fixed).to_matrix() == algebra::transpose(matrix));
+    };
+    check(algebra::to_fixed<2, 2>(algebra::random(2, 2, -5, 5)));
+    check(algebra::to_fixed<3, 3>(algebra::random(3, 3, -5, 5)));
+    check(algebra::to_fixed<4, 4>(algebra::random(4, 4, -5, 5)));
+    check(algebra::to_fixed<6, 6>(algebra::random(6, 6, -5, 5)));
+
+    algebra::FixedMatrix<double, 2, 3> wide{algebra::to_fixed<2, 3>(Matrix{{1, 2, 3}, {4, 5, 6}})};
+    EXPECT_TRUE(algebra::sum(algebra::multiply(wide, 2), 1).to_matrix() == (Matrix{{3, 5, 7}, {9, 11, 13}}));
+
+    // Caution: sizes must match, singular matrices have no inverse
+    EXPECT_THROW((algebra::to_fixed<3, 3>(algebra::zeros(3, 2))), std::logic_error);
+    EXPECT_THROW(algebra::inverse(algebra::FixedMatrix<double, 4, 4>{}), std::logic_error);
+    EXPECT_THROW(algebra::inverse(algebra::FixedMatrix<double, 5, 5>{}), std::logic_error);
+}
+
+TEST(MatrixBatchTest, LAYOUT) {
+    algebra::MatrixBatch batch{10, 2, 3};
+    EXPECT_EQ(batch.size(), 10);
+    EXPECT_EQ(batch.stride() % 8, 0);
+    batch.set(7, Matrix{{1, 2, 3}, {4, 5, 6}});
+    EXPECT_TRUE(batch.get(7) == (Matrix{{1, 2, 3}, {4, 5, 6}}));
+    EXPECT_TRUE(batch.get(6) == algebra::zeros(2, 3));
+    // element (1, 2) of every matrix is one contiguous lane
+    EXPECT_EQ(batch.lane(1, 2)[7], 6);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(batch.lane(1, 0)) % algebra::DenseMatrix::alignment, 0);
+
+    // Caution: index and size are checked
+    EXPECT_THROW(batch.get(10), std::logic_error);
+    EXPECT_THROW(batch.set(0, algebra::zeros(3, 2)), std::logic_error);
+}
+
+TEST(MatrixBatchTest, OPERATIONS) {
+    // every size with a closed form and one going through LU, on a count that is not a multiple of any lane width
+    for (size_t n : {1, 2, 3, 4, 6}) {
+        algebra::MatrixBatch batch1{37, n, n};
+        algebra::MatrixBatch batch2{37, n, n};
+        for (size_t b{}; b < batch1.size(); b++) {
+            batch1.set(b, algebra::random(n, n, -5, 5));
+            batch2.set(b, algebra::random(n, n, -5, 5));
+        }
+        algebra::MatrixBatch products{algebra::batch_multiply(batch1, batch2)};
+        algebra::MatrixBatch inverses{algebra::batch_inverse(batch1)};
+        Vector determinants{algebra::batch_determinant(batch1)};
+        for (size_t b{}; b < batch1.size(); b++) {
+            Matrix matrix{batch1.get(b)};
+            Matrix product{algebra::multiply(matrix, batch2.get(b))};
+            Matrix inverse{algebra::inverse(matrix)};
+            EXPECT_NEAR(determinants[b], algebra::determinant(matrix), 1e-9 * std::max(1.0, std::abs(determinants[b])));
+            for (size_t i{}; i < n; i++)
+                for (size_t j{}; j < n; j++) {
+                    EXPECT_NEAR(products(b, i, j), product[i][j], 1e-9);
+                    EXPECT_NEAR(inverses(b, i, j), inverse[i][j], 1e-6 * std::max(1.0, std::abs(inverse[i][j])));
+                }
+        }
+    }
+
+    // Caution: one singular matrix fails the whole batch, sizes must match
+    algebra::MatrixBatch batch{9, 3, 3};
+    for (size_t b{}; b < batch.size(); b++)
+        batch.set(b, algebra::random(3, 3, -5, 5));
+    batch.set(4, algebra::ones(3, 3));
+    EXPECT_THROW(algebra::batch_inverse(batch), std::logic_error);
+    EXPECT_THROW(algebra::batch_multiply(batch, algebra::MatrixBatch{8, 3, 3}), std::logic_error);
+    EXPECT_THROW(algebra::batch_inverse(algebra::MatrixBatch{8, 3, 2}), std::logic_error);
+}
+
+TEST(PrecisionTest, FLOAT) {
+    algebra::DenseMatrix matrix{algebra::random(150, 130, -1, 1)};
+    algebra::DenseMatrix other{algebra::random(130, 70, -1, 1)};
+    algebra::FloatDenseMatrix single{algebra::matrix_cast<float>(matrix)};
+    algebra::FloatDenseMatrix other_single{algebra::matrix_cast<float>(other)};
+    // float rows hold twice as many elements per cache line
+    EXPECT_EQ(single.stride() % 16, 0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(single.row(1)) % algebra::FloatDenseMatrix::alignment, 0);
+
+    // every tier must agree with the double results to float accuracy, through gemm and the small loops
+    algebra::DenseMatrix product{algebra::multiply(matrix, other)};
+    algebra::DenseMatrix fused{algebra::evaluate(algebra::lazy(matrix) * 2 - algebra::lazy(matrix) + 0.5)};
+    algebra::Isa detected{algebra::detected_isa()};
+    for (algebra::Isa isa : {algebra::Isa::scalar, algebra::Isa::sse2, algebra::Isa::avx2, algebra::Isa::avx512}) {
+        if (isa > detected)
+            continue;
+        algebra::force_isa(isa);
+        algebra::FloatDenseMatrix single_product{algebra::multiply(single, other_single)};
+        algebra::FloatDenseMatrix single_fused{algebra::evaluate(algebra::lazy(single) * 2 - algebra::lazy(single) + 0.5)};
+        algebra::FloatDenseMatrix reduced{algebra::ero_sum(algebra::ero_multiply(single, 3, 2), 3, -0.5, 4)};
+        for (size_t i{}; i < product.rows(); i++)
+            for (size_t j{}; j < product.cols(); j++)
+                EXPECT_NEAR(single_product(i, j), product(i, j), 1e-4);
+        for (size_t j{}; j < matrix.cols(); j++) {
+            EXPECT_NEAR(single_fused(5, j), fused(5, j), 1e-6);
+            EXPECT_FLOAT_EQ(reduced(3, j), 2 * single(3, j));
+            EXPECT_FLOAT_EQ(reduced(4, j), single(4, j) - single(3, j));
+        }
+    }
+    algebra::force_isa(detected);
+
+    // determinant and inverse go through the double LU
+    algebra::FloatDenseMatrix square{BasicMatrix<float>{{2, 1, 0}, {1, 3, 1}, {0, 1, 4}}};
+    EXPECT_FLOAT_EQ(algebra::determinant(square), 18);
+    BasicMatrix<float> inverse{algebra::inverse(square).to_matrix()};
+    Matrix expected{algebra::inverse(Matrix{{2, 1, 0}, {1, 3, 1}, {0, 1, 4}})};
+    for (size_t i{}; i < 3; i++)
+        for (size_t j{}; j < 3; j++)
+            EXPECT_FLOAT_EQ(inverse[i][j], static_cast<float>(expected[i][j]));
+}
+
+TEST(PrecisionTest, MIXED) {
+    // 2^24 + 1 rounds back to 2^24 in float but is exact in double
+    size_t n{200};
+    algebra::FloatDenseMatrix a{n, n, 1};
+    algebra::FloatDenseMatrix b{n, n, 1};
+    a(0, 0) = 1 << 24;
+    algebra::DenseMatrix mixed{algebra::multiply_mixed(a, b)};
+    algebra::FloatDenseMatrix single{algebra::multiply(a, b)};
+    // row 0 sums 2^24 and 199 ones: double keeps every one of them, float drops them
+    EXPECT_EQ(mixed(0, 0), (1 << 24) + 199.0);
+    EXPECT_NE(static_cast<double>(single(0, 0)), (1 << 24) + 199.0);
+    EXPECT_EQ(mixed(1, 0), 200);
+
+    // the gemm overload accumulates into double C with alpha applied
+    algebra::DenseMatrix c{algebra::dense::ones(n, n)};
+    algebra::gemm(n, n, n, 0.5, a.data(), a.stride(), b.data(), b.stride(), c.data(), c.stride());
+    EXPECT_EQ(c(0, 0), 1 + ((1 << 24) + 199.0) / 2);
+
+    // Caution: the dimensions are checked
+    EXPECT_THROW(algebra::multiply_mixed(a, algebra::FloatDenseMatrix{3, 2}), std::logic_error);
+}
+
+TEST(MatrixFileTest, ROUND_TRIP) {
+    std::string path{(std::filesystem::temp_directory_path() / "algebra_round_trip.mat").string()};
+    algebra::DenseMatrix matrix{algebra::dense::random(37, 21, -1, 1)};
+    algebra::save(matrix, path);
+    EXPECT_TRUE(algebra::load(path) == matrix);
+    // the header and the padded rows keep every row of the payload aligned
+    EXPECT_EQ(std::filesystem::file_size(path), sizeof(algebra::MatrixFileHeader) + 37 * matrix.stride() * sizeof(double));
+
+    {
+        // mapping copies nothing, and writes through a writable mapping land in the file
+        algebra::MappedMatrix mapped{path, true};
+        EXPECT_EQ(mapped.rows(), 37);
+        EXPECT_EQ(mapped.dtype(), algebra::DType::float64);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped.data<double>()) % algebra::DenseMatrix::alignment, 0);
+        EXPECT_TRUE(algebra::to_dense(mapped.view()) == matrix);
+        EXPECT_TRUE(algebra::transpose(mapped.view()) == algebra::transpose(matrix).to_matrix());
+        mapped.mutable_view()(3, 4) = 42;
+    }
+    algebra::MappedMatrix shared{path};
+    EXPECT_EQ(shared.view()(3, 4), 42);
+    EXPECT_EQ(algebra::load(path)(3, 4), 42);
+
+    // the writer streams rows of either element type
+    {
+        algebra::MatrixWriter<float> writer{path, 3, 2};
+        for (float row : {1.0f, 2.0f, 3.0f}) {
+            float values[2]{row, -row};
+            writer.write_row(values);
+        }
+        writer.close();
+    }
+    algebra::FloatDenseMatrix single{algebra::load<float>(path)};
+    EXPECT_TRUE(single.to_matrix() == (BasicMatrix<float>{{1, -1}, {2, -2}, {3, -3}}));
+    EXPECT_TRUE(algebra::MappedMatrix{path}.to_dense() == (algebra::DenseMatrix{Matrix{{1, -1}, {2, -2}, {3, -3}}}));
+
+    // Caution: element types must match, row counts are checked and foreign files are rejected
+    EXPECT_THROW(algebra::load<double>(path), std::logic_error);
+    EXPECT_THROW(algebra::MappedMatrix{path}.view(), std::logic_error);
+    EXPECT_THROW(algebra::MappedMatrix{path}.mutable_view(), std::logic_error);
+    algebra::MatrixWriter<double> short_writer{path, 2, 2};
+    double row[2]{};
+    short_writer.write_row(row);
+    EXPECT_THROW(short_writer.close(), std::logic_error);
+    std::ofstream{path} << "not a matrix";
+    EXPECT_THROW(algebra::load(path), std::runtime_error);
+    EXPECT_THROW(algebra::MappedMatrix{path}, std::runtime_error);
+
+    // Caution: a header claiming more rows than the file holds is rejected before anything is
+    // allocated, even when the claimed size overflows
+    algebra::save(matrix, path);
+    algebra::MatrixFileHeader header{algebra::read_header(path)};
+    for (uint64_t rows : {uint64_t{38}, uint64_t{1} << 62}) {
+        header.rows = rows;
+        {
+            std::fstream file{path, std::ios::binary | std::ios::in | std::ios::out};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        EXPECT_THROW(algebra::load(path), std::runtime_error);
+        EXPECT_THROW(algebra::MappedMatrix{path}, std::runtime_error);
+    }
+    std::remove(path.c_str());
+    EXPECT_THROW(algebra::MappedMatrix{path}, std::runtime_error);
+}
+
+TEST(OutOfCoreTest, MULTIPLY) {
+    std::filesystem::path dir{std::filesystem::temp_directory_path()};
+    std::string a_path{(dir / "algebra_a.mat").string()};
+    std::string b_path{(dir / "algebra_b.mat").string()};
+    std::string c_path{(dir / "algebra_c.mat").string()};
+    algebra::DenseMatrix a{algebra::dense::random(150, 130, -1, 1)};
+    algebra::DenseMatrix b{algebra::dense::random(130, 170, -1, 1)};
+    algebra::save(a, a_path);
+    algebra::save(b, b_path);
+
+    // room for six 32 x 32 tiles: a 5 x 6 grid of C tiles, 5 steps along k each, with edge tiles
+    size_t budget{6 * 32 * 32 * sizeof(double)};
+    EXPECT_EQ(algebra::out_of_core_tile(budget), 32);
+    algebra::multiply_files(a_path, b_path, c_path, budget);
+    algebra::DenseMatrix c{algebra::load(c_path)};
+    algebra::DenseMatrix expected{algebra::multiply(a, b)};
+    ASSERT_EQ(c.rows(), 150);
+    ASSERT_EQ(c.cols(), 170);
+    for (size_t i{}; i < c.rows(); i++)
+        for (size_t j{}; j < c.cols(); j++)
+            EXPECT_NEAR(c(i, j), expected(i, j), 1e-12);
+
+    // with the default budget the whole product is one step, the same gemm as the in-memory multiply
+    algebra::multiply_files(a_path, b_path, c_path);
+    EXPECT_TRUE(algebra::load(c_path) == expected);
+
+    // Caution: sizes, element types and the budget are checked
+    EXPECT_THROW(algebra::multiply_files(a_path, a_path, c_path), std::logic_error);
+    EXPECT_THROW(algebra::multiply_files(a_path, b_path, c_path, 100), std::logic_error);
+    // Caution: the result is never written over an operand, the operand would be truncated first
+    EXPECT_THROW(algebra::multiply_files(a_path, b_path, a_path), std::logic_error);
+    EXPECT_THROW(algebra::multiply_files(a_path, b_path, (dir / "." / "algebra_b.mat").string()), std::logic_error);
+    EXPECT_TRUE(algebra::load(a_path) == a);
+    EXPECT_TRUE(algebra::load(b_path) == b);
+    algebra::save(algebra::matrix_cast<float>(b), b_path);
+    EXPECT_THROW(algebra::multiply_files(a_path, b_path, c_path), std::logic_error);
+    std::remove(b_path.c_str());
+    EXPECT_THROW(algebra::multiply_files(a_path, b_path, c_path), std::runtime_error);
+    std::remove(a_path.c_str());
+    std::remove(c_path.c_str());
+}
+
+TEST(RandomTest, PHILOX) {
+    // known answers of the reference implementation
+    EXPECT_EQ(algebra::philox4x32({0, 0, 0, 0}, {0, 0}),
+              (algebra::PhiloxCounter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    EXPECT_EQ(algebra::philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}),
+              (algebra::PhiloxCounter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    EXPECT_EQ(algebra::philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+              (algebra::PhiloxCounter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+
+    // every tier fills the same numbers, and any piece of a fill equals the same positions of the whole
+    std::vector<double> full(1000);
+    std::vector<float> full_float(1000);
+    algebra::Isa detected{algebra::detected_isa()};
+    algebra::force_isa(algebra::Isa::scalar);
+    algebra::uniform_fill(full.data(), full.size(), 0, -2, 3, 42);
+    algebra::uniform_fill(full_float.data(), full_float.size(), 0, -2, 3, 42);
+    for (algebra::Isa isa : {algebra::Isa::sse2, algebra::Isa::avx2, algebra::Isa::avx512}) {
+        if (isa > detected)
+            continue;
+        algebra::force_isa(isa);
+        std::vector<double> piece(997);
+        std::vector<float> piece_float(997);
+        algebra::uniform_fill(piece.data(), piece.size(), 3, -2, 3, 42);
+        algebra::uniform_fill(piece_float.data(), piece_float.size(), 3, -2, 3, 42);
+        EXPECT_TRUE(std::equal(piece.begin(), piece.end(), full.begin() + 3)) << algebra::isa_name(isa);
+        EXPECT_TRUE(std::equal(piece_float.begin(), piece_float.end(), full_float.begin() + 3)) << algebra::isa_name(isa);
+    }
+    algebra::force_isa(detected);
+    EXPECT_TRUE(std::all_of(full.begin(), full.end(), [](double x) { return x >= -2 && x < 3; }));
+    EXPECT_TRUE(std::all_of(full_float.begin(), full_float.end(), [](float x) { return x >= -2 && x < 3; }));
+}
+
+TEST(RandomTest, SEEDED) {
+    // a seed gives the same matrix whatever the thread count, in both layers
+    size_t threads{algebra::num_threads()};
+    algebra::set_num_threads(1);
+    Matrix matrix{algebra::random(70, 130, -1, 1, 7)};
+    algebra::set_num_threads(4);
+    EXPECT_TRUE(algebra::random(70, 130, -1, 1, 7) == matrix);
+    algebra::set_num_threads(threads);
+    EXPECT_TRUE(algebra::dense::random(70, 130, -1, 1, 7).to_matrix() == matrix);
+    EXPECT_FALSE(algebra::random(70, 130, -1, 1, 8) == matrix);
+
+    // Caution: without a seed every call differs
+    EXPECT_FALSE(algebra::random(4, 4, -1, 1) == algebra::random(4, 4, -1, 1));
+}
+
+// The text algebra::show printed with one ostringstream per row
+template <typename T>
+std::string stream_text(const BasicMatrix<T>& matrix) {
+    if (matrix.empty())
+        return "\n";
+    std::string text;
+    for (const auto& row : matrix) {
+        std::ostringstream oss;
+        for (size_t i{}; i < row.size(); i++) {
+            if (i != 0) oss << ' ';
+            oss << std::fixed << std::setprecision(3) << row[i];
+        }
+        text += oss.str() + '\n';
+    }
+    return text;
+}
+
+TEST(FormatTest, BYTE_IDENTICAL) {
+    // rounding ties, negative zeros, huge, tiny and special numbers, and rows of different lengths
+    double inf{std::numeric_limits<double>::infinity()};
+    Matrix matrix{{0.0005, 0.0015, -0.0004, -0.0, 2.5e-4, 1.0005, 0.0625, 0.1875, -2.0625, 4503599627370495.5},
+                  {9007199254740991.0, 9007199254740993.0, 1e300, -1.7976931348623157e308, 4.9e-324},
+                  {inf, -inf, std::nan(""), -std::nan("")}, {}, {123456.78951, -999.9995}};
+    std::string text;
+    algebra::print(matrix, algebra::string_sink(text));
+    EXPECT_EQ(text, stream_text(matrix));
+    text.clear();
+    algebra::print(Matrix{}, algebra::string_sink(text));
+    EXPECT_EQ(text, "\n");
+
+    // large matrices are formatted in parallel blocks, the text stays the same
+    size_t threads{algebra::num_threads()};
+    algebra::set_num_threads(4);
+    Matrix large{algebra::random(300, 500, -1e4, 1e4, 3)};
+    text.clear();
+    algebra::print(large, algebra::string_sink(text));
+    EXPECT_EQ(text, stream_text(large));
+    text.clear();
+    algebra::print(algebra::DenseMatrix{large}, algebra::string_sink(text));
+    EXPECT_EQ(text, stream_text(large));
+    algebra::FloatDenseMatrix single{algebra::dense::random<float>(40, 70, -1, 1, 3)};
+    text.clear();
+    algebra::print(single, algebra::string_sink(text));
+    EXPECT_EQ(text, stream_text(single.to_matrix()));
+    algebra::ConstMatrixView view{algebra::view(large).submatrix(10, 20, 140, 240, 2, 2).minor(3, 5)};
+    text.clear();
+    algebra::print(view, algebra::string_sink(text));
+    EXPECT_EQ(text, stream_text(view.to_matrix()));
+    algebra::set_num_threads(threads);
+
+    // every sink gets the same bytes, and show prints them
+    text.clear();
+    algebra::print(matrix, algebra::string_sink(text));
+    std::ostringstream stream;
+    algebra::print(matrix, algebra::stream_sink(stream));
+    EXPECT_EQ(stream.str(), text);
+    std::FILE* file{std::tmpfile()};
+    algebra::print(matrix, algebra::file_sink(file));
+    std::fflush(file);
+    algebra::print(matrix, algebra::fd_sink(fileno(file)));
+    std::string written(2 * text.size(), '\0');
+    std::rewind(file);
+    EXPECT_EQ(std::fread(written.data(), 1, written.size() + 1, file), written.size());
+    EXPECT_EQ(written, text + text);
+    std::fclose(file);
+    testing::internal::CaptureStdout();
+    algebra::show(matrix);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), text);
+
+    // Caution: a sink that cannot write throws
+    EXPECT_THROW(algebra::print(matrix, algebra::fd_sink(-1)), std::runtime_error);
+}
+
+TEST(StrassenTest, MULTIPLY) {
+    // a small cutoff recurses several levels and peels odd rows, columns and depths on the way
+    size_t threads{algebra::num_threads()};
+    algebra::set_num_threads(1);
+    for (auto [m, n, k] : {std::array<size_t, 3>{64, 64, 64}, {101, 99, 203}, {37, 53, 41}, {16, 15, 17}}) {
+        algebra::DenseMatrix a{algebra::dense::random(m, k, -1, 1, 1)};
+        algebra::DenseMatrix b{algebra::dense::random(k, n, -1, 1, 2)};
+        algebra::DenseMatrix expected{algebra::multiply(a, b)};
+        algebra::DenseMatrix product{algebra::multiply_strassen(a, b, 8)};
+        ASSERT_EQ(product.rows(), m);
+        ASSERT_EQ(product.cols(), n);
+        for (size_t i{}; i < m; i++)
+            for (size_t j{}; j < n; j++)
+                EXPECT_NEAR(product(i, j), expected(i, j), 1e-11);
+
+        // the seven products as parallel tasks give the same bits
+        algebra::set_num_threads(4);
+        EXPECT_TRUE(algebra::multiply_strassen(a, b, 8) == product);
+        algebra::set_num_threads(1);
+
+        algebra::FloatDenseMatrix single{algebra::multiply_strassen(algebra::matrix_cast<float>(a), algebra::matrix_cast<float>(b), 8)};
+        for (size_t i{}; i < m; i++)
+            for (size_t j{}; j < n; j++)
+                EXPECT_NEAR(single(i, j), expected(i, j), 1e-3);
+    }
+    algebra::set_num_threads(threads);
+
+    // below the cutoff it is the blocked gemm, with no scratch space
+    algebra::DenseMatrix a{algebra::dense::random(100, 100, -1, 1, 3)};
+    EXPECT_TRUE(algebra::multiply_strassen(a, a) == algebra::multiply(a, a));
+    EXPECT_EQ(algebra::strassen_workspace(100, 100, 100, false), 0);
+    EXPECT_LT(algebra::strassen_workspace(4096, 4096, 4096, false), algebra::strassen_workspace(4096, 4096, 4096, true));
+
+    // Caution: the inner dimensions must match
+    EXPECT_THROW(algebra::multiply_strassen(a, algebra::DenseMatrix{3, 4}), std::logic_error);
+}
+
+TEST(SolveTest, SOLVE) {
+    // diagonally dominant, so well conditioned; large enough for several blocks of every kernel
+    size_t n{300};
+    algebra::DenseMatrix a{algebra::dense::random(n, n, -1, 1, 1)};
+    for (size_t i{}; i < n; i++)
+        a(i, i) += n;
+    algebra::DenseMatrix b{algebra::dense::random(n, 40, -1, 1, 2)};
+    algebra::Factorization factorization{a};
+    EXPECT_EQ(factorization.size(), n);
+    EXPECT_FALSE(factorization.singular());
+    algebra::DenseMatrix x{factorization.solve(b)};
+    algebra::DenseMatrix residual{algebra::multiply(a, x)};
+    for (size_t i{}; i < n; i++)
+        for (size_t j{}; j < b.cols(); j++)
+            EXPECT_NEAR(residual(i, j), b(i, j), 1e-10);
+
+    // the same factorization serves vectors and nested matrices, column by column the same answer
+    Vector column(n);
+    for (size_t i{}; i < n; i++)
+        column[i] = b(i, 7);
+    Vector y{factorization.solve(column)};
+    for (size_t i{}; i < n; i++)
+        EXPECT_NEAR(y[i], x(i, 7), 1e-12);
+    EXPECT_TRUE(algebra::solve(a.to_matrix(), column) == y);
+    Matrix nested{algebra::solve(a.to_matrix(), b.to_matrix())};
+    EXPECT_TRUE(nested == x.to_matrix());
+
+    // small systems with pivoting, against the inverse
+    Matrix small{{0, 2, 1}, {1, 1, 1}, {2, 1, 0}};
+    Vector rhs{{3, 3, 3}};
+    Vector solution{algebra::solve(small, rhs)};
+    Matrix expected{algebra::multiply(algebra::inverse(small), Matrix{{3}, {3}, {3}})};
+    for (size_t i{}; i < 3; i++)
+        EXPECT_NEAR(solution[i], expected[i][0], 1e-12);
+    EXPECT_NEAR(algebra::Factorization{small}.determinant(), algebra::determinant(small), 1e-12);
+
+    // Caution: singular and non-square matrices, and right-hand sides of the wrong size
+    EXPECT_THROW(algebra::solve(Matrix{{1, 2}, {2, 4}}, Vector{{1, 1}}), std::logic_error);
+    EXPECT_THROW(algebra::solve(Matrix{{1, 2, 3}, {2, 4, 5}}, Vector{{1, 1}}), std::logic_error);
+    EXPECT_THROW(factorization.solve(Vector(n - 1)), std::logic_error);
+    EXPECT_THROW(factorization.solve(algebra::DenseMatrix{n + 1, 2}), std::logic_error);
+}
+
+TEST(SolveTest, TRIANGULAR) {
+    // blocked substitutions with one and many right-hand sides against the plain loops
+    size_t n{150};
+    algebra::DenseMatrix t{algebra::dense::random(n, n, -1, 1, 3)};
+    for (size_t i{}; i < n; i++)
+        t(i, i) = 2 + t(i, i);
+    for (size_t nrhs : {size_t{1}, size_t{3}, size_t{20}}) {
+        algebra::DenseMatrix b{algebra::dense::random(n, nrhs, -1, 1, 4)};
+        algebra::DenseMatrix lower{b}, upper{b}, unit{b};
+        algebra::trsm_lower(n, nrhs, t.data(), t.stride(), lower.data(), lower.stride());
+        algebra::trsm_upper(n, nrhs, t.data(), t.stride(), upper.data(), upper.stride());
+        algebra::trsm_lower(n, nrhs, t.data(), t.stride(), unit.data(), unit.stride(), true);
+        for (size_t c{}; c < nrhs; c++) {
+            std::vector<double> x(n), y(n), z(n);
+            for (size_t i{}; i < n; i++) {
+                double sum{b(i, c)}, unit_sum{b(i, c)};
+                for (size_t k{}; k < i; k++) {
+                    sum -= t(i, k) * x[k];
+                    unit_sum -= t(i, k) * z[k];
+                }
+                x[i] = sum / t(i, i);
+                z[i] = unit_sum;
+            }
+            for (size_t i{n}; i-- > 0;) {
+                double sum{b(i, c)};
+                for (size_t k{i + 1}; k < n; k++)
+                    sum -= t(i, k) * y[k];
+                y[i] = sum / t(i, i);
+            }
+            for (size_t i{}; i < n; i++) {
+                EXPECT_NEAR(lower(i, c), x[i], 1e-9 * std::max(1.0, std::abs(x[i])));
+                EXPECT_NEAR(upper(i, c), y[i], 1e-9 * std::max(1.0, std::abs(y[i])));
+                EXPECT_NEAR(unit(i, c), z[i], 1e-9 * std::max(1.0, std::abs(z[i])));
+            }
+        }
+    }
+}
+
+TEST(FactorizationCacheTest, HITS) {
+    algebra::FactorizationCache cache;
+    Matrix matrix{algebra::random(50, 50, -1, 1, 5)};
+    double det{algebra::determinant(matrix)};
+    Matrix inv{algebra::inverse(matrix)};
+
+    // the first query factors, the next ones find the factorization and then the inverse too
+    EXPECT_EQ(cache.determinant(matrix), det);
+    EXPECT_EQ(cache.determinant(matrix), det);
+    EXPECT_TRUE(cache.inverse(matrix) == inv);
+    EXPECT_TRUE(cache.inverse(matrix) == inv);
+    algebra::FactorizationCache::Stats stats{cache.stats()};
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.hits, 3);
+    EXPECT_EQ(stats.entries, 1);
+    EXPECT_GT(stats.bytes, 50 * 50 * 3 * sizeof(double));
+
+    // any change to the contents is a new matrix
+    Matrix changed{matrix};
+    changed[10][20] += 1e-12;
+    EXPECT_EQ(cache.determinant(changed), algebra::determinant(changed));
+    EXPECT_EQ(cache.stats().misses, 2);
+    EXPECT_EQ(cache.stats().entries, 2);
+
+    // a caller-kept version replaces the entry of its id without reading the contents
+    algebra::DenseMatrix dense{matrix};
+    auto first{cache.factorization(dense, 7, 1)};
+    EXPECT_EQ(cache.factorization(dense, 7, 1), first);
+    EXPECT_NE(cache.factorization(algebra::DenseMatrix{changed}, 7, 2), first);
+    EXPECT_EQ(cache.stats().entries, 3);
+
+    // the least recently used entries leave to make room, here for two entries of 60x60
+    algebra::FactorizationCache small{5 * 60 * 64 * sizeof(double)};
+    Matrix a{algebra::random(60, 60, -1, 1, 6)}, b{algebra::random(60, 60, -1, 1, 7)};
+    Matrix c{algebra::random(60, 60, -1, 1, 8)};
+    small.determinant(a);
+    small.determinant(b);
+    small.determinant(a);
+    small.determinant(c);
+    EXPECT_EQ(small.stats().evictions, 1);
+    EXPECT_EQ(small.stats().entries, 2);
+    EXPECT_LE(small.stats().bytes, small.memory_budget());
+    small.determinant(a);
+    EXPECT_EQ(small.stats().hits, 2);
+    small.determinant(b);
+    EXPECT_EQ(small.stats().misses, 4);
+    small.clear();
+    EXPECT_EQ(small.stats().entries, 0);
+    EXPECT_EQ(small.stats().bytes, 0);
+
+    // Caution: the same errors as algebra::determinant and algebra::inverse
+    EXPECT_THROW(cache.determinant(Matrix{{1, 2, 3}, {4, 5, 6}}), std::logic_error);
+    EXPECT_THROW(cache.inverse(Matrix{{1, 2, 3}, {2, 4, 6}, {0, 0, 1}}), std::logic_error);
+    EXPECT_EQ(cache.determinant(Matrix{{1, 2, 3}, {2, 4, 6}, {0, 0, 1}}), 0);
+}
+
+TEST(BlockMatrixTest, CONCATENATE) {
+    Matrix a{algebra::random(70, 40, -1, 1, 11)};
+    Matrix b{algebra::random(70, 30, -1, 1, 12)};
+    algebra::DenseMatrix c{algebra::random(50, 70, -1, 1, 13)};
+    Matrix d{algebra::random(120, 120, -1, 1, 14)};
+
+    // [[a b]; c] next to a strided view of d, nothing copied until asked for
+    algebra::BlockMatrix top{algebra::concatenate(algebra::BlockMatrix{a}, algebra::BlockMatrix{b}, 1)};
+    algebra::BlockMatrix left{algebra::concatenate(top, algebra::BlockMatrix{c}, 0)};
+    algebra::ConstMatrixView strided{algebra::view(d).submatrix(0, 1, 120, 60, 1, 2)};
+    algebra::BlockMatrix block{algebra::concatenate(left, algebra::BlockMatrix{strided}, 1)};
+    EXPECT_EQ(block.rows(), 120);
+    EXPECT_EQ(block.cols(), 130);
+    EXPECT_EQ(block.blocks().size(), 4);
+    EXPECT_EQ(block.blocks()[2].row, 70);
+    EXPECT_EQ(block.blocks()[3].col, 70);
+
+    Matrix expected{algebra::concatenate(algebra::concatenate(algebra::concatenate(a, b, 1), c.to_matrix(), 0),
+                                         strided.to_matrix(), 1)};
+    EXPECT_TRUE(block.to_matrix() == expected);
+    EXPECT_TRUE(block.to_dense() == algebra::DenseMatrix{expected});
+    EXPECT_EQ(block(69, 45), b[69][5]);
+    EXPECT_EQ(block(100, 20), c(30, 20));
+    EXPECT_EQ(block(7, 129), d[7][119]);
+
+    // Caution: the same checks as algebra::concatenate
+    EXPECT_THROW(algebra::concatenate(top, block, 0), std::logic_error);
+    EXPECT_THROW(algebra::concatenate(top, block, 1), std::logic_error);
+    EXPECT_TRUE(algebra::concatenate(top, top, 2).empty());
+    EXPECT_THROW(block(120, 0), std::out_of_range);
+}
+
+TEST(BlockMatrixTest, KERNELS) {
+    Matrix a{algebra::random(100, 60, -1, 1, 15)};
+    algebra::DenseMatrix b{algebra::random(100, 50, -1, 1, 16)};
+    Matrix c{algebra::random(60, 80, -1, 1, 17)};
+    algebra::DenseMatrix d{algebra::random(50, 80, -1, 1, 18)};
+
+    // [a b] * [c; d], the inner blocks split at the same place or not
+    algebra::BlockMatrix left{algebra::concatenate(algebra::BlockMatrix{a}, algebra::BlockMatrix{b}, 1)};
+    algebra::BlockMatrix right{algebra::concatenate(algebra::BlockMatrix{c}, algebra::BlockMatrix{d}, 0)};
+    Matrix product{algebra::multiply(left.to_matrix(), right.to_matrix())};
+    algebra::DenseMatrix blocked{algebra::multiply(left, right)};
+    Matrix split{right.to_matrix()};
+    algebra::BlockMatrix other{algebra::concatenate(algebra::BlockMatrix{algebra::view(split).submatrix(0, 0, 35, 80)},
+                                                    algebra::BlockMatrix{algebra::view(split).submatrix(35, 0, 75, 80)}, 0)};
+    algebra::DenseMatrix shifted{algebra::multiply(left, other)};
+    for (size_t i = 0; i < 100; ++i)
+        for (size_t j = 0; j < 80; ++j) {
+            EXPECT_NEAR(blocked(i, j), product[i][j], 1e-12);
+            EXPECT_NEAR(shifted(i, j), product[i][j], 1e-12);
+        }
+    EXPECT_TRUE(algebra::transpose(left) == algebra::DenseMatrix{algebra::transpose(left.to_matrix())});
+
+    // Caution: the same checks as algebra::multiply
+    EXPECT_THROW(algebra::multiply(left, left), std::logic_error);
+}
+
+TEST(TransposeTest, TILED) {
+    // sizes around the register tiles and the blocks, on every tier
+    algebra::Isa detected{algebra::detected_isa()};
+    for (algebra::Isa isa : {algebra::Isa::scalar, algebra::Isa::sse2, algebra::Isa::avx2, algebra::Isa::avx512}) {
+        if (isa > detected)
+            continue;
+        algebra::force_isa(isa);
+        for (size_t n : {1, 7, 8, 33, 70}) {
+            Matrix matrix{algebra::random(n, n + 5, -1, 1, n)};
+            Matrix expected(n + 5, Vector(n));
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = 0; j < n + 5; ++j)
+                    expected[j][i] = matrix[i][j];
+            EXPECT_TRUE(algebra::transpose(matrix) == expected) << algebra::isa_name(isa) << " " << n;
+            algebra::DenseMatrix dense{matrix};
+            EXPECT_TRUE(algebra::transpose(dense) == algebra::DenseMatrix{expected}) << algebra::isa_name(isa) << " " << n;
+            algebra::FloatDenseMatrix single{algebra::matrix_cast<float>(dense)};
+            EXPECT_TRUE(algebra::transpose(single) == algebra::matrix_cast<float>(algebra::DenseMatrix{expected}));
+
+            // square, in place
+            Matrix square{algebra::random(n, n, -1, 1, n)};
+            Matrix transposed{algebra::transpose(square)};
+            algebra::DenseMatrix dense_square{square};
+            algebra::transpose_inplace(dense_square);
+            EXPECT_TRUE(dense_square == algebra::DenseMatrix{transposed}) << algebra::isa_name(isa) << " " << n;
+            algebra::transpose_inplace(square);
+            EXPECT_TRUE(square == transposed);
+        }
+    }
+    algebra::force_isa(detected);
+
+    // Caution: only square matrices can be transposed in place
+    Matrix wide{algebra::random(3, 4, -1, 1, 1)};
+    algebra::DenseMatrix dense_wide{wide};
+    EXPECT_THROW(algebra::transpose_inplace(wide), std::logic_error);
+    EXPECT_THROW(algebra::transpose_inplace(dense_wide), std::logic_error);
+    Matrix empty;
+    algebra::transpose_inplace(empty);
+    EXPECT_TRUE(empty.empty());
+}
+
+TEST(LuTest, PIVOTING) {
+    // the largest magnitude as pivot instead of the first non-zero element
+    Matrix matrix1{{0, 2, 3}, {4, 7, 5}, {6, 1, 3}};
+    Matrix res1{algebra::upper_triangular(matrix1, algebra::Pivoting::partial)};
+    EXPECT_DOUBLE_EQ(res1[0][0], 6);
+    EXPECT_NEAR(res1[1][0], 0, 1e-12);
+    EXPECT_NEAR(res1[2][1], 0, 1e-12);
+    EXPECT_NEAR(res1[0][0] * res1[1][1] * res1[2][2], -algebra::determinant(matrix1), 1e-12);
+
+    // Caution: a tiny first non-zero pivot loses the rest of the row, partial pivoting does not
+    Matrix tiny{{1e-20, 1}, {1, 1}};
+    EXPECT_NEAR(algebra::upper_triangular(tiny)[1][1], -1e20, 1e5);
+    EXPECT_DOUBLE_EQ(algebra::upper_triangular(tiny, algebra::Pivoting::partial)[1][1], 1);
+
+    // the blocked elimination agrees with the unblocked one for either rule. Without partial
+    // pivoting the elements can grow and the rounding with them, unless the diagonal dominates.
+    size_t n{300};
+    algebra::DenseMatrix dense{algebra::dense::random(n, n, -1, 1, 21)};
+    algebra::DenseMatrix dominant{dense};
+    for (size_t i{}; i < n; i++)
+        dominant(i, i) += n;
+    for (algebra::Pivoting pivoting : {algebra::Pivoting::first_nonzero, algebra::Pivoting::partial}) {
+        const algebra::DenseMatrix& input{pivoting == algebra::Pivoting::partial ? dense : dominant};
+        algebra::DenseMatrix upper{algebra::upper_triangular(input, pivoting)};
+        algebra::DenseMatrix expected{algebra::upper(algebra::lu_factor_unblocked(input, pivoting))};
+        for (size_t i{}; i < n; i++)
+            for (size_t j{}; j < n; j++)
+                EXPECT_NEAR(upper(i, j), expected(i, j), 1e-9);
+        EXPECT_TRUE(algebra::DenseMatrix{algebra::upper_triangular(input.to_matrix(), pivoting)} == upper);
+    }
+
+    // look-ahead hands out the trailing update by thread count, the results stay bit-identical
+    size_t threads{algebra::num_threads()};
+    algebra::set_num_threads(1);
+    algebra::LuDecomposition sequential{algebra::lu_factor(dense)};
+    algebra::set_num_threads(4);
+    algebra::LuDecomposition parallel{algebra::lu_factor(dense)};
+    algebra::set_num_threads(threads);
+    EXPECT_EQ(parallel.pivots, sequential.pivots);
+    EXPECT_TRUE(parallel.lu == sequential.lu);
+}
+
+TEST(SymmetricTest, CHOLESKY_LDLT) {
+    // a covariance-like positive definite matrix, below and above the blocking threshold
+    for (size_t n : {50, 300}) {
+        algebra::DenseMatrix b{algebra::dense::random(n, n, -1, 1, 25)};
+        algebra::DenseMatrix spd{algebra::multiply(b, algebra::transpose(b))};
+        // scaled so the determinant stays finite
+        for (size_t i{}; i < n; i++) {
+            for (size_t j{}; j < n; j++)
+                spd(i, j) /= n;
+            spd(i, i) += 1;
+        }
+        algebra::CholeskyDecomposition cholesky{algebra::cholesky_factor(spd)};
+        ASSERT_TRUE(cholesky.positive_definite);
+        EXPECT_EQ(cholesky.l(0, 1), 0);
+        algebra::DenseMatrix product{algebra::multiply(cholesky.l, algebra::transpose(cholesky.l))};
+        for (size_t i{}; i < n; i++)
+            for (size_t j{}; j < n; j++)
+                EXPECT_NEAR(product(i, j), spd(i, j), 1e-9);
+        double det{algebra::determinant(algebra::lu_factor(spd))};
+        EXPECT_NEAR(algebra::determinant(cholesky) / det, 1, 1e-9);
+        algebra::DenseMatrix inverse{algebra::inverse(cholesky)};
+        algebra::DenseMatrix expected{algebra::inverse(algebra::lu_factor(spd))};
+        for (size_t i{}; i < n; i++)
+            for (size_t j{}; j < n; j++)
+                EXPECT_NEAR(inverse(i, j), expected(i, j), 1e-12);
+        algebra::DenseMatrix x{algebra::solve(cholesky, b)};
+        algebra::DenseMatrix residual{algebra::multiply(spd, x)};
+        for (size_t i{}; i < n; i++)
+            for (size_t j{}; j < n; j++)
+                EXPECT_NEAR(residual(i, j), b(i, j), 1e-9);
+    }
+
+    // symmetric indefinite: P A P^T = L D L^T, with 2x2 blocks in D
+    size_t n{120};
+    algebra::DenseMatrix r{algebra::dense::random(n, n, -1, 1, 26)};
+    algebra::DenseMatrix indefinite{algebra::sum(r, algebra::transpose(r))};
+    EXPECT_FALSE(algebra::cholesky_factor(indefinite).positive_definite);
+    algebra::LdltDecomposition ldlt{algebra::ldlt_factor(indefinite)};
+    algebra::DenseMatrix d(n, n);
+    for (size_t k{}; k < n; k++) {
+        d(k, k) = ldlt.diagonal[k];
+        if (k + 1 < n && ldlt.off_diagonal[k] != 0)
+            d(k, k + 1) = d(k + 1, k) = ldlt.off_diagonal[k];
+    }
+    EXPECT_TRUE(std::any_of(ldlt.off_diagonal.begin(), ldlt.off_diagonal.end(), [](double e) { return e != 0; }));
+    algebra::DenseMatrix ldl{algebra::multiply(algebra::multiply(ldlt.l, d), algebra::transpose(ldlt.l))};
+    for (size_t i{}; i < n; i++)
+        for (size_t j{}; j < n; j++)
+            EXPECT_NEAR(ldl(i, j), indefinite(ldlt.permutation[i], ldlt.permutation[j]), 1e-9);
+    EXPECT_NEAR(algebra::determinant(ldlt) / algebra::determinant(algebra::lu_factor(indefinite)), 1, 1e-9);
+    algebra::DenseMatrix inverse{algebra::inverse(ldlt)};
+    algebra::DenseMatrix identity{algebra::multiply(indefinite, inverse)};
+    for (size_t i{}; i < n; i++)
+        for (size_t j{}; j < n; j++)
+            EXPECT_NEAR(identity(i, j), i == j ? 1 : 0, 1e-9);
+
+    // Caution: a zero diagonal needs a 2x2 pivot, a zero matrix has none
+    algebra::LdltDecomposition swap{algebra::ldlt_factor(algebra::DenseMatrix{Matrix{{0, 1}, {1, 0}}})};
+    EXPECT_DOUBLE_EQ(algebra::determinant(swap), -1);
+    EXPECT_TRUE(algebra::inverse(swap) == algebra::DenseMatrix(Matrix{{0, 1}, {1, 0}}));
+    algebra::LdltDecomposition zero{algebra::ldlt_factor(algebra::DenseMatrix(2, 2))};
+    EXPECT_TRUE(zero.singular);
+    EXPECT_EQ(algebra::determinant(zero), 0);
+    EXPECT_THROW(algebra::inverse(zero), std::logic_error);
+    EXPECT_THROW(algebra::determinant(algebra::cholesky_factor(algebra::DenseMatrix(2, 2))), std::logic_error);
+    EXPECT_THROW(algebra::cholesky_factor(algebra::DenseMatrix(2, 3)), std::logic_error);
+}
+
+TEST(StructureTest, PROBE) {
+    size_t n{64};
+    Matrix general{algebra::random(n, n, -1, 1, 27)};
+    Matrix diagonal(n, std::vector<double>(n)), lower(n, std::vector<double>(n)), tridiagonal(n, std::vector<double>(n));
+    Matrix symmetric{general};
+    for (size_t i{}; i < n; i++) {
+        diagonal[i][i] = 2 + general[i][i];
+        for (size_t j{}; j <= i; j++)
+            lower[i][j] = general[i][j] + (i == j ? 2 : 0);
+        for (size_t j{i > 0 ? i - 1 : 0}; j < std::min(n, i + 2); j++)
+            tridiagonal[i][j] = general[i][j] + (i == j ? 4 : 0);
+        for (size_t j{}; j < i; j++)
+            symmetric[i][j] = symmetric[j][i];
+    }
+
+    algebra::Structure structure{algebra::probe(diagonal)};
+    EXPECT_TRUE(structure.diagonal());
+    EXPECT_TRUE(structure.symmetric);
+    structure = algebra::probe(lower);
+    EXPECT_TRUE(structure.lower_triangular());
+    EXPECT_FALSE(structure.upper_triangular());
+    structure = algebra::probe(tridiagonal);
+    EXPECT_EQ(structure.lower_bandwidth, 1);
+    EXPECT_EQ(structure.upper_bandwidth, 1);
+    EXPECT_TRUE(structure.banded());
+    structure = algebra::probe(symmetric);
+    EXPECT_TRUE(structure.symmetric);
+    EXPECT_FALSE(structure.banded());
+    structure = algebra::probe(general);
+    EXPECT_FALSE(structure.symmetric);
+    EXPECT_EQ(structure.lower_bandwidth, n - 1);
+
+    // every route gives the results of the dense LU
+    Matrix rhs{algebra::random(n, 3, -1, 1, 28)};
+    for (const Matrix* matrix : {&diagonal, &lower, &tridiagonal, &symmetric, &general}) {
+        algebra::Structure found{algebra::probe(*matrix)};
+        double det{algebra::determinant(*matrix)};
+        EXPECT_NEAR(algebra::determinant(*matrix, found) / det, 1, 1e-9);
+        Matrix inverse{algebra::inverse(*matrix, found)};
+        Matrix expected{algebra::inverse(*matrix)};
+        Matrix x{algebra::solve(*matrix, rhs, found)};
+        Matrix expected_x{algebra::solve(*matrix, rhs)};
+        for (size_t i{}; i < n; i++) {
+            for (size_t j{}; j < n; j++)
+                EXPECT_NEAR(inverse[i][j], expected[i][j], 1e-9);
+            for (size_t j{}; j < 3; j++)
+                EXPECT_NEAR(x[i][j], expected_x[i][j], 1e-9);
+        }
+    }
+
+    // Caution: a zero on the diagonal of a triangular matrix is singular, and the structure
+    // must belong to a matrix of the same size
+    lower[5][5] = 0;
+    EXPECT_EQ(algebra::determinant(lower, algebra::probe(lower)), 0);
+    EXPECT_THROW(algebra::inverse(lower, algebra::probe(lower)), std::logic_error);
+    EXPECT_THROW(algebra::determinant(general, algebra::probe(Matrix{{1}})),
+                 std::logic_error);
+    EXPECT_THROW(algebra::probe(Matrix{{1, 2}}), std::logic_error);
+    // Caution: a ragged matrix is not square even when its first row is as long as the matrix
+    EXPECT_THROW(algebra::probe(Matrix{{1, 2}, {3}}), std::logic_error);
+    EXPECT_THROW(algebra::probe(Matrix{{1, 2, 3}, {4, 5, 6}, {7, 8}}), std::logic_error);
+    EXPECT_DOUBLE_EQ(algebra::determinant(Matrix{}, algebra::probe(Matrix{})), 1);
+}